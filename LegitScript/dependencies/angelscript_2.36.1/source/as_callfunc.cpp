@@ -531,6 +531,9 @@ int PrepareSystemFunction(asCScriptFunction *func, asSSystemFunctionInterface *i
 
 int CallSystemFunction(int id, asCContext *context)
 {
+#if LEGIT_SCRIPT_VM_STATS
+	ls::CountVmCall(id);
+#endif
 	asCScriptEngine *engine = context->m_engine;
 	asCScriptFunction *func = engine->scriptFunctions[id];
 	asSSystemFunctionInterface *sysFunc = func->sysFuncIntf;
@@ -570,6 +573,9 @@ asQWORD CallSystemFunctionNative(asCContext *context, asCScriptFunction *descr,
 
 int CallSystemFunction(int id, asCContext *context)
 {
+#if LEGIT_SCRIPT_VM_STATS
+	ls::CountVmCall(id);
+#endif
 	asCScriptEngine            *engine  = context->m_engine;
 	asCScriptFunction          *descr   = engine->scriptFunctions[id];
 	asSSystemFunctionInterface *sysFunc = descr->sysFuncIntf;
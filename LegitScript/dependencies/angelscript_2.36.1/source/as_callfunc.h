@@ -41,6 +41,15 @@
 
 #include "as_array.h"
 
+#if LEGIT_SCRIPT_VM_STATS
+// LegitScript: counters of the instrumented VM build, defined in LegitScript/source/VmStats.cpp
+namespace ls
+{
+	extern thread_local unsigned long long vmOpcodeCounts[256];
+	void CountVmCall(int funcId);
+}
+#endif
+
 BEGIN_AS_NAMESPACE
 
 class asCContext;
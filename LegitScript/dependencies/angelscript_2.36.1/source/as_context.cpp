@@ -1644,6 +1644,10 @@ void asCContext::SetProgramPointer()
 
 		// Set up the internal registers for executing the script function
 		PrepareScriptFunction();
+
+#if LEGIT_SCRIPT_VM_STATS
+		ls::CountVmCall(m_currentFunction->id);
+#endif
 	}
 	else if( m_currentFunction->funcType == asFUNC_SYSTEM )
 	{
@@ -2029,6 +2033,10 @@ void asCContext::CallScriptFunction(asCScriptFunction *func)
 	if (PushCallState() < 0)
 		return;
 
+#if LEGIT_SCRIPT_VM_STATS
+	ls::CountVmCall(func->id);
+#endif
+
 	// Update the current function and program position before increasing the stack
 	// so the exception handler will know what to do if there is a stack overflow
 	m_currentFunction = func;
@@ -2159,6 +2167,10 @@ void asCContext::ExecuteNext()
 	for(;;)
 	{
 
+#if LEGIT_SCRIPT_VM_STATS
+	ls::vmOpcodeCounts[*(asBYTE*)l_bc]++;
+#endif
+
 #ifdef AS_DEBUG
 	// Gather statistics on executed bytecode
 	stats.Instr(*(asBYTE*)l_bc);
@@ -4,6 +4,8 @@
 #include <memory>
 #include "LegitScriptEvents.h"
 #include "LegitScriptInputs.h"
+#include "LegitScriptTracing.h"
+#include "LegitScriptOptions.h"
 #include "LegitExceptions.h"
 
 namespace ls
@@ -14,6 +16,10 @@ namespace ls
     ~LegitScript();
     ls::ScriptContents LoadScript(const std::string &script_source);
     ls::ScriptEvents RunScript(const std::vector<ContextInput> &context_inputs);
+    void SetOptions(const ls::ScriptOptions &options);
+    //c++ translation unit with the loaded render graph compiled ahead of time. linking it into an application registers
+    //the render graph, see LegitScriptAot.h
+    std::string GenerateAotSource();
   private:
     struct Impl;
     std::unique_ptr<Impl> impl;
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+struct asSVMRegisters;
+
+namespace ls
+{
+  //c++ translation of a render graph function. the interpreter enters it at JitEntry instructions, entry selects which one
+  using AotFunctionPtr = void(*)(asSVMRegisters *registers, size_t entry);
+  struct AotFunction
+  {
+    //angelscript declaration with the object type and namespace
+    const char *decl;
+    //byte code length the function was translated from, functions that don't match it stay interpreted
+    size_t byte_code_length;
+    AotFunctionPtr ptr;
+  };
+  //render graph compiled ahead of time by LegitScript::GenerateAotSource()
+  struct AotRenderGraph
+  {
+    //hash of the assembled render graph source
+    uint64_t source_hash;
+    //saved angelscript module
+    const unsigned char *byte_code;
+    size_t byte_code_size;
+    const AotFunction *functions;
+    size_t functions_count;
+  };
+
+  //LegitScript::LoadScript() loads registered render graphs from their byte code instead of compiling them.
+  //the data has to stay valid for as long as scripts can be loaded
+  void RegisterAotRenderGraph(const AotRenderGraph &render_graph);
+  //generated translation units register their render graph from a static initializer
+  struct AotRegistration
+  {
+    AotRegistration(const AotRenderGraph &render_graph)
+    {
+      RegisterAotRenderGraph(render_graph);
+    }
+  };
+  //used by generated functions to call the registered function of the CALLSYS instruction at instr.
+  //returns false when the generated function has to give control back to the interpreter
+  bool AotCallSystem(asSVMRegisters *registers, void *instr);
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <functional>
 #include <variant>
+#include <optional>
 #include <cstdint>
 #include "PodTypes.h"
 
@@ -14,6 +15,19 @@ namespace ls
     sampler2D,
     sampler3D
   };
+
+  enum struct ImageTypes : int
+  {
+    image1D,
+    image2D,
+    image3D
+  };
+  enum struct AccessQualifiers : int
+  {
+    readonly,
+    writeonly,
+    readwrite
+  };
   
   enum struct PixelFormats : int
   {
@@ -37,6 +51,13 @@ namespace ls
     multiplicative
   };
 
+  enum struct PassTypes : int
+  {
+    fullscreen,
+    compute,
+    instanced
+  };
+
   struct BlockBody
   {
     std::string text;
@@ -61,6 +82,8 @@ namespace ls
     {
       std::string type;
       std::string name;
+      PixelFormats pixel_format;
+      AccessQualifiers access_qualifier;
     };
     std::vector<Image> images;
     
@@ -74,6 +97,19 @@ namespace ls
     
     BlendModes blend_mode;
     std::string name;
+    PassTypes pass_type = PassTypes::fullscreen;
+    //from the [numthreads(x, y, z)] section of compute passes
+    uvec3 workgroup_size = {1, 1, 1};
+    //from the [instanced(vertices_count, attributes...)] section of instanced passes
+    unsigned int vertices_per_instance = 0;
+    struct InstanceAttribute
+    {
+      std::string type;
+      std::string name;
+      size_t offset;
+    };
+    std::vector<InstanceAttribute> instance_attributes;
+    size_t instance_stride = 0;
     
     std::vector<std::string> includes;
     BlockBody body;
@@ -89,6 +125,32 @@ namespace ls
   {
     ShaderDescs shader_descs;
     Declarations declarations;
+    //the render graph never reads sliders, time, context values or persistent images, so its events only depend on the swapchain size
+    bool is_static_render_graph = false;
+    //render graph functions running natively, 0 unless ScriptOptions::jit_compile is on and the platform is supported
+    size_t jit_compiled_functions_count = 0;
+    //constructor calls, copies and function calls rewritten by ScriptOptions::optimize_byte_code
+    size_t byte_code_rewrites_count = 0;
+    //the render graph was loaded from a registered ahead-of-time compiled one instead of being compiled
+    bool is_aot_render_graph = false;
+  };
+
+  enum struct LoadOps : int
+  {
+    load,
+    //the invocation overwrites the whole attachment
+    dont_care
+  };
+  enum struct StoreOps : int
+  {
+    store,
+    //nothing reads the result later in the frame and the image is not an output
+    dont_care
+  };
+  struct AttachmentOps
+  {
+    LoadOps load_op;
+    StoreOps store_op;
   };
 
   struct ShaderInvocation
@@ -96,6 +158,25 @@ namespace ls
     std::string shader_name;
     std::vector<ls::Image> image_sampler_bindings;
     std::vector<ls::Image> color_attachments;
+    struct StorageImageBinding
+    {
+      //always a single mip
+      ls::Image image;
+      AccessQualifiers access_qualifier;
+    };
+    std::vector<StorageImageBinding> storage_image_bindings;
+    //parallel to color_attachments, only filled when ScriptOptions::infer_attachment_ops is set
+    std::vector<AttachmentOps> color_attachment_ops;
+    //workgroups to dispatch, only set for compute passes
+    std::optional<uvec3> groups_count;
+    //only used by instanced passes: instances_count * ShaderDesc::instance_stride bytes of tightly packed attributes
+    unsigned int instances_count = 0;
+    std::vector<uint8_t> instance_data;
+    //filled when ScriptOptions::track_invocation_reuse is set. the hash covers the shader, uniform bytes, attachments and
+    //the contents of everything the invocation reads. a reusable invocation would write exactly what its attachments
+    //already contain since the previous frame, so the backend can skip it
+    uint64_t inputs_hash = 0;
+    bool is_reusable = false;
 
     struct UniformValue
     {
@@ -118,17 +199,54 @@ namespace ls
     std::vector<uint8_t> uniform_data;
   };
 
+  //how the image is used during the frame, CachedImageRequest::usage is only set when ScriptOptions::infer_attachment_ops is
+  struct ImageUsage
+  {
+    bool is_sampled = false;
+    bool is_render_target = false;
+    //sampled through a mip range other than the base mip alone, so the backend needs views of the mip chain
+    bool is_mip_sampled = false;
+    //bound as an image2D<format> argument
+    bool is_storage = false;
+  };
+
   struct CachedImageRequest
   {
     ls::PixelFormats pixel_format;
     uvec2 size;
+    size_t mips_count;
     Image::Id id;
+    std::optional<ImageUsage> usage;
     bool operator < (const CachedImageRequest &other) const
     {
-      return std::tie(pixel_format, size.x, size.y, id) < std::tie(other.pixel_format, other.size.x, other.size.y, other.id);
+      return std::tie(pixel_format, size.x, size.y, mips_count, id) < std::tie(other.pixel_format, other.size.x, other.size.y, other.mips_count, other.id);
     }
   };
 
+  //an image whose contents are kept between frames. it's identified by name and its ids stay the same across frames.
+  //once the script asks for its history, the image alternates between two copies every frame and both are reported under the same name
+  struct PersistentImageRequest
+  {
+    std::string name;
+    ls::PixelFormats pixel_format;
+    uvec2 size;
+    Image::Id id;
+    //the copy holding what the image contained in the previous frame it was used in
+    bool is_history;
+    //number of the frame whose invocations wrote the copy's contents, 0 if it was never written.
+    //backends keeping per-frame-in-flight copies can key them on (id, version)
+    size_t version;
+  };
+
+  //a cached or persistent image id that was requested with a different size or format than in the previous frame.
+  //the id is kept, the backend is expected to drop the old allocation and create one matching the new request
+  struct ImageInvalidation
+  {
+    Image::Id id;
+    uvec2 prev_size;
+    ls::PixelFormats prev_pixel_format;
+  };
+
   struct LoadedImageRequest
   {
     std::string filename;
@@ -160,11 +278,206 @@ namespace ls
   {
     std::string text;
   };
-  using ContextRequest = std::variant<FloatRequest, IntRequest, ColorRequest, BoolRequest, TextRequest, LoadedImageRequest, CachedImageRequest>;
+  using ContextRequest = std::variant<FloatRequest, IntRequest, ColorRequest, BoolRequest, TextRequest, LoadedImageRequest, CachedImageRequest, PersistentImageRequest>;
+
+  struct ScriptStats
+  {
+    double total_time_ms = 0.0;
+    //time spent interpreting script code, excluding native bindings
+    double vm_time_ms = 0.0;
+    double binding_time_ms = 0.0;
+    size_t binding_calls_count = 0;
+
+    size_t pass_invocations_count = 0;
+    size_t float_requests_count = 0;
+    size_t int_requests_count = 0;
+    size_t color_requests_count = 0;
+    size_t bool_requests_count = 0;
+    size_t text_requests_count = 0;
+    size_t loaded_image_requests_count = 0;
+    size_t cached_image_requests_count = 0;
+    size_t persistent_image_requests_count = 0;
+    size_t uniform_bytes_count = 0;
+
+    //heap allocations made by the script engine during the frame
+    size_t script_allocations_count = 0;
+    size_t script_allocated_bytes = 0;
+    //allocations served by the frame arena instead, see ScriptOptions::use_frame_arena
+    size_t arena_allocations_count = 0;
+    size_t arena_allocated_bytes = 0;
+    //bytes of arena blocks kept alive only by allocations in them, like the ones that outlived earlier frames. over all threads
+    size_t arena_pinned_bytes = 0;
+
+    //garbage collection at the end of the frame, see ScriptOptions::gc_time_budget_ms
+    double gc_time_ms = 0.0;
+    size_t gc_steps_count = 0;
+    bool is_gc_full_cycle = false;
+    size_t gc_destroyed_objects_count = 0;
+    //objects still held by the collector after the frame
+    size_t gc_objects_count = 0;
+
+    //only filled when the library is built with LEGIT_SCRIPT_VM_STATS, each list is sorted by count. instructions run
+    //as jit or aot native code don't go through the interpreter and aren't counted
+    struct VmCount
+    {
+      std::string name;
+      size_t count;
+    };
+    std::vector<VmCount> opcode_counts;
+    //registered functions by declaration
+    std::vector<VmCount> registered_call_counts;
+    //script function entries by declaration
+    std::vector<VmCount> script_call_counts;
+  };
   
+  struct ScriptProfile
+  {
+    struct Line
+    {
+      size_t line;
+      size_t hits_count;
+      //time from entering the line until the next line was entered, callees excluded
+      double time_ms;
+    };
+    std::vector<Line> lines;
+    struct Function
+    {
+      std::string decl;
+      size_t entries_count;
+    };
+    std::vector<Function> functions;
+  };
+  
+  //frame span of a cached image: the first and the last invocation (index into ScriptEvents::script_shader_invocations) that use it
+  struct ImageLifetime
+  {
+    Image::Id id;
+    size_t first_invocation;
+    size_t last_invocation;
+    //whole mip chain
+    size_t size_bytes;
+    size_t slot_idx;
+  };
+  //a chunk of memory shared by cached images whose lifetimes don't overlap
+  struct AliasingSlot
+  {
+    size_t size_bytes;
+    //in order of use
+    std::vector<Image::Id> image_ids;
+  };
+  //cached images that are not used by any invocation need no memory during the frame and get no slot.
+  //swapchain, loaded and persistent images and external outputs never take part in aliasing
+  struct ImageAliasingPlan
+  {
+    std::vector<ImageLifetime> image_lifetimes;
+    std::vector<AliasingSlot> slots;
+    //memory needed when every used cached image gets its own allocation
+    size_t unaliased_bytes = 0;
+    size_t aliased_bytes = 0;
+  };
+
+  enum struct HazardTypes : int
+  {
+    read_after_write,
+    write_after_read,
+    write_after_write
+  };
+  //has to be placed before dst_invocation. one barrier is emitted per change of access to a mip, readers that follow the same write share it
+  struct ImageBarrier
+  {
+    size_t src_invocation;
+    size_t dst_invocation;
+    Image::Id image_id;
+    int mip;
+    HazardTypes hazard_type;
+  };
+  struct FrameDependencyGraph
+  {
+    //indexed by invocation: invocations that have to finish before it can start
+    std::vector<std::vector<size_t>> dependencies;
+    std::vector<ImageBarrier> barriers;
+    //invocations of one level don't depend on each other and can be recorded concurrently once the previous levels are done
+    std::vector<std::vector<size_t>> levels;
+    //invocations count along the longest dependency chain
+    size_t critical_path_length = 0;
+  };
+
+  //what the culling stage dropped from the events
+  struct CullingReport
+  {
+    //indices into the invocations as the script issued them
+    std::vector<size_t> removed_invocations;
+    std::vector<Image::Id> removed_image_ids;
+  };
+
+  //consecutive invocations that render to the same color attachments
+  struct RenderPass
+  {
+    size_t first_invocation;
+    size_t invocations_count;
+  };
+  struct RenderPassSchedule
+  {
+    //indexed by the invocation's new position: its position before scheduling
+    std::vector<size_t> original_indices;
+    std::vector<RenderPass> render_passes;
+    //render passes the invocations would form in the order the script issued them
+    size_t unscheduled_render_passes_count = 0;
+  };
+
+  //content generation of an image, bumped every frame the image ends up with different contents
+  struct ImageContentVersion
+  {
+    Image::Id id;
+    size_t version;
+  };
+  struct InvocationReuseReport
+  {
+    std::vector<ImageContentVersion> image_content_versions;
+    size_t reusable_invocations_count = 0;
+  };
+
+  //consecutive invocations of one shader that don't depend on each other, so a backend can issue them with a single
+  //pipeline bind and one uniform upload, in item order
+  struct InvocationBatch
+  {
+    std::string shader_name;
+    size_t first_invocation;
+    size_t invocations_count;
+    //uniforms of all items back to back, invocations_count * uniform_stride bytes
+    size_t uniform_stride = 0;
+    std::vector<uint8_t> uniform_data;
+    //indexed by item
+    std::vector<std::vector<ls::Image>> color_attachments;
+    std::vector<std::vector<ls::Image>> image_sampler_bindings;
+    std::vector<std::vector<ShaderInvocation::StorageImageBinding>> storage_image_bindings;
+    //only filled for compute passes
+    std::vector<uvec3> groups_counts;
+    //only filled for instanced passes, every item draws its own instance buffer
+    std::vector<unsigned int> instances_counts;
+    std::vector<std::vector<uint8_t>> instance_data;
+  };
+
   struct ScriptEvents
   {
     std::vector<ContextRequest> context_requests;
     std::vector<ShaderInvocation> script_shader_invocations;
+    //the render graph was not executed, the events repeat the last executed frame because none of the inputs it read changed
+    bool is_memoized = false;
+    //number of the executed frame the events come from, memoized frames repeat an earlier one
+    size_t executed_frame_idx = 0;
+    std::vector<ImageInvalidation> image_invalidations;
+    //cached image ids that weren't requested for a while. the backend can drop their allocations, the ids are handed out to new images later
+    std::vector<Image::Id> released_image_ids;
+    //images passed to MarkExternalOutput(), they are kept by culling along with the swapchain and persistent images
+    std::vector<Image::Id> external_output_ids;
+    std::optional<ScriptStats> stats;
+    std::optional<ScriptProfile> profile;
+    std::optional<ImageAliasingPlan> aliasing_plan;
+    std::optional<FrameDependencyGraph> dependency_graph;
+    std::optional<CullingReport> culling;
+    std::optional<RenderPassSchedule> render_pass_schedule;
+    std::optional<InvocationReuseReport> invocation_reuse;
+    std::optional<std::vector<InvocationBatch>> invocation_batches;
   };
 }
\ No newline at end of file
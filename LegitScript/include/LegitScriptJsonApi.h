@@ -1,8 +1,10 @@
 #include "LegitScriptEvents.h"
 #include "LegitScriptInputs.h"
+#include "LegitScriptTracing.h"
 
 namespace ls
 {
   std::string LoadScript(const std::string &script_source);
   std::string RunScript(const std::string &context_inputs);
+  std::string SetOptions(const std::string &options);
 }
\ No newline at end of file
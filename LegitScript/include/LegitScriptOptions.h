@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+
+namespace ls
+{
+  struct ScriptOptions
+  {
+    //fills ScriptEvents::stats every frame. costs two clock reads per native binding call when enabled
+    bool collect_stats = false;
+    //fills ScriptEvents::profile with per-line hit counts and timings of the render graph code
+    bool profile_lines = false;
+    //fills ScriptEvents::aliasing_plan with the lifetimes of cached images and the memory slots they can share
+    bool build_aliasing_plan = false;
+    //fills ScriptEvents::dependency_graph with per-mip hazards between invocations, the barriers and the levels of independent invocations
+    bool build_dependency_graph = false;
+    //drops invocations that contribute nothing to the swapchain or to external outputs, and cached images nobody uses.
+    //runs before the other frame graph stages, so their invocation indices refer to the culled list
+    bool cull_unused = false;
+    //reorders independent invocations so that the ones rendering to the same attachments end up next to each other,
+    //and fills ScriptEvents::render_pass_schedule with the resulting render pass boundaries. runs after culling
+    bool schedule_render_passes = false;
+    //fills ShaderInvocation::color_attachment_ops and CachedImageRequest::usage from the final invocation order
+    bool infer_attachment_ops = false;
+    //tracks content versions of images across frames and marks invocations whose outputs would not change.
+    //skipping them needs the image contents from the previous frame, so while it's on every written image is treated
+    //as a frame output: its stores are kept and it's left out of the aliasing plan
+    bool track_invocation_reuse = false;
+    //remembers which context values (sliders, GetTime(), Context*() and the swapchain size) the render graph read.
+    //while none of them change, RunScript() repeats the previous events without executing the script.
+    //scripts with global variables or persistent images are always executed
+    bool memoize_frames = false;
+    //keeps the events of up to 16 memoizable frames keyed on the values of the inputs they read, and serves them as
+    //memoized frames when those values come back. the least recently served one is dropped first. for static render
+    //graphs (see ScriptContents::is_static_render_graph) the key is just the swapchain size. frames reading GetTime()
+    //aren't kept
+    bool cache_frames_by_inputs = false;
+    //fills ScriptEvents::invocation_batches with runs of same-shader invocations that can be issued together.
+    //runs last, so the batches refer to the final invocation order
+    bool batch_invocations = false;
+    //compiles the render graph functions to native code on load (x86-64 Linux only, ignored elsewhere).
+    //instructions the jit doesn't cover still run in the interpreter. takes effect on the next LoadScript()
+    bool jit_compile = false;
+    //rewrites the render graph byte code on load: folds vector constructors called with literals, constructs value types
+    //straight into the variables they're assigned to and inlines functions that compute a single arithmetic expression
+    //of their arguments. inlined functions don't show up in the line profile. takes effect on the next LoadScript()
+    bool optimize_byte_code = false;
+    //loads render graphs registered with RegisterAotRenderGraph() (see LegitScriptAot.h) from their precompiled byte code
+    //and runs their generated c++ functions instead of compiling the source. takes effect on the next LoadScript()
+    bool load_aot_render_graphs = true;
+    //the script engine's garbage collector only runs at the end of RunScript(), in incremental steps until this much
+    //time has passed or it runs out of work. at least one step runs every frame
+    double gc_time_budget_ms = 0.5;
+    //a full collection cycle runs instead of the steps once the collector holds this many objects. a full cycle also
+    //runs after every LoadScript()
+    size_t gc_full_cycle_objects_count = 10000;
+    //serves the script engine's allocations during RunScript() from a per-thread arena that is rewound after the frame.
+    //memory that outlives the frame keeps its part of the arena alive until it's freed
+    bool use_frame_arena = false;
+    //loads the render graph as a module of a script engine shared by every instance with this on, instead of an engine of
+    //its own with all the types and functions registered again. the jit, optimize_byte_code and aot render graphs are
+    //not used for shared modules. instances sharing the engine must not run on different threads at the same time.
+    //takes effect on the next LoadScript()
+    bool share_script_engine = false;
+  };
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+namespace ls
+{
+  //trace events are only recorded when the library is built with LEGIT_SCRIPT_TRACING and recording is enabled.
+  //the recorder is shared by all script instances and keeps the most recent events of every thread in a ring buffer per thread
+  void SetTracingEnabled(bool is_enabled);
+  //chrome trace-event json, can be opened in chrome://tracing or perfetto
+  std::string DumpTrace();
+  void ClearTrace();
+}
@@ -3,9 +3,13 @@
 #include <memory>
 #include <angelscript.h>
 #include <string>
+#include <vector>
+#include <cstring>
 #include <stdexcept>
+#include <chrono>
 #include <scriptstdstring/scriptstdstring.h>
 #include <scriptmath/scriptmath.h>
+#include <scriptarray/scriptarray.h>
 
 namespace as
 {
@@ -26,9 +30,11 @@ namespace as
     {
       ptr->ShutDownAndRelease();
     }
-    asIScriptModule * LoadScript(std::string script)
+    //a module that already has the name is discarded. the user data is set before the global variables are initialized
+    asIScriptModule * LoadScript(std::string script, const char *module_name = 0, void *user_data = nullptr)
     {
-      asIScriptModule *mod = ptr->GetModule(0, asGM_ALWAYS_CREATE);
+      asIScriptModule *mod = ptr->GetModule(module_name, asGM_ALWAYS_CREATE);
+      mod->SetUserData(user_data);
       
       int res = mod->AddScriptSection("script", script.data(), script.length());
       if(res < 0) throw std::runtime_error("Failed to add script section");
@@ -36,6 +42,40 @@ namespace as
       if( res < 0 ) throw std::runtime_error("Failed to build the script");
       return mod;
     }
+    struct ByteCodeStream : public asIBinaryStream
+    {
+      int Write(const void *ptr, asUINT size) override
+      {
+        data.insert(data.end(), (const unsigned char*)ptr, (const unsigned char*)ptr + size);
+        return 0;
+      }
+      int Read(void *ptr, asUINT size) override
+      {
+        if(read_pos + size > data.size()) return -1;
+        memcpy(ptr, data.data() + read_pos, size);
+        read_pos += size;
+        return 0;
+      }
+      std::vector<unsigned char> data;
+      size_t read_pos = 0;
+    };
+    std::vector<unsigned char> SaveByteCode(asIScriptModule *mod)
+    {
+      ByteCodeStream stream;
+      int res = mod->SaveByteCode(&stream);
+      if(res < 0) throw std::runtime_error("Failed to save the byte code");
+      return stream.data;
+    }
+    asIScriptModule * LoadByteCode(const unsigned char *data, size_t size, const char *module_name = 0, void *user_data = nullptr)
+    {
+      asIScriptModule *mod = ptr->GetModule(module_name, asGM_ALWAYS_CREATE);
+      mod->SetUserData(user_data);
+      ByteCodeStream stream;
+      stream.data.assign(data, data + size);
+      int res = mod->LoadByteCode(&stream);
+      if(res < 0) throw std::runtime_error("Failed to load the byte code");
+      return mod;
+    }
     
     struct RuntimeException
     {
@@ -43,9 +83,22 @@ namespace as
       std::string func_decl;
       std::string exception_str;
     };
-    std::optional<RuntimeException> RunScript(asIScriptFunction *func)
+    struct LineCallbackBinding
+    {
+      using FuncType = std::function<void(asIScriptContext *ctx)>;
+      LineCallbackBinding(FuncType func) : func(func) {}
+      FuncType func;
+    };
+    std::optional<RuntimeException> RunScript(asIScriptFunction *func, LineCallbackBinding::FuncType line_func = nullptr)
     {
       auto context = this->CreateContext();
+      std::unique_ptr<LineCallbackBinding> line_callback_binding;
+      if(line_func)
+      {
+        line_callback_binding = std::unique_ptr<LineCallbackBinding>(new LineCallbackBinding(line_func));
+        int res = context->ptr->SetLineCallback(asFUNCTION(LineCallbackDispatcher), line_callback_binding.get(), asCALL_CDECL);
+        if(res < 0) throw std::runtime_error("Failed to set a line callback");
+      }
       context->ptr->Prepare(func);
       //ctx->SetArgFloat(1, 2.71828182846f);
       int res = context->ptr->Execute();
@@ -72,13 +125,25 @@ namespace as
     struct GlobalFunctionBinding
     {
       using FuncType = std::function<void(asIScriptGeneric *gen)>;
-      GlobalFunctionBinding(FuncType func) : func(func){}
+      GlobalFunctionBinding(FuncType func, ScriptEngine *engine) : func(func), engine(engine){}
       FuncType func;
+      ScriptEngine *engine;
     };
+    struct BindingStats
+    {
+      size_t calls_count = 0;
+      double time = 0.0;
+    };
+    //when set, every call into a registered binding is timed and counted here
+    BindingStats *binding_stats = nullptr;
     template<typename T>
     void RegisterType(std::string type_name)
     {
-      int res = this->ptr->RegisterObjectType(type_name.data(), sizeof(T), asOBJ_VALUE | asOBJ_POD);
+      RegisterType(type_name, sizeof(T));
+    }
+    void RegisterType(std::string type_name, size_t size)
+    {
+      int res = this->ptr->RegisterObjectType(type_name.data(), int(size), asOBJ_VALUE | asOBJ_POD);
       if(res < 0) throw std::runtime_error("Failed to register a type");
     }
     void RegisterEnum(std::string enum_name, const std::vector<std::pair<std::string, int>> &enum_values)
@@ -92,13 +157,13 @@ namespace as
 
     void RegisterGlobalFunction(std::string func_decl, GlobalFunctionBinding::FuncType func)
     {
-      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func)));
+      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func, this)));
       int res = this->ptr->RegisterGlobalFunction(func_decl.c_str(), asFUNCTION(GlobalFunctionBindingDispatcher), asCALL_GENERIC, global_func_bindings.back().get());
       if(res < 0) throw std::runtime_error("Failed to register a global function");
     }
     void RegisterMethod(std::string obj_type_name, std::string method_decl, GlobalFunctionBinding::FuncType func)
     {
-      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func)));
+      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func, this)));
       int res = this->ptr->RegisterObjectMethod(obj_type_name.c_str(), method_decl.c_str(), asFUNCTION(GlobalFunctionBindingDispatcher), asCALL_GENERIC, global_func_bindings.back().get());
       if(res < 0) throw std::runtime_error("Failed to register a global function");
     }
@@ -107,15 +172,17 @@ namespace as
       int res = this->ptr->RegisterObjectProperty(obj_type_name.c_str(), member_decl.c_str(), offset);
       if(res < 0) throw std::runtime_error("Failed to register a member");
     }
-    void RegisterConstructor(std::string obj_type_name, std::string constr_decl, GlobalFunctionBinding::FuncType func)
+    //returns the function id of the constructor
+    int RegisterConstructor(std::string obj_type_name, std::string constr_decl, GlobalFunctionBinding::FuncType func)
     {
-      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func)));
+      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func, this)));
       int res = this->ptr->RegisterObjectBehaviour(obj_type_name.c_str(), asBEHAVE_CONSTRUCT, constr_decl.c_str(), asFUNCTION(GlobalFunctionBindingDispatcher), asCALL_GENERIC, global_func_bindings.back().get());
       if(res < 0) throw std::runtime_error("Failed to register a constructor");
+      return res;
     }
     void RegisterDestructor(std::string obj_type_name, GlobalFunctionBinding::FuncType func)
     {
-      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func)));
+      global_func_bindings.emplace_back(std::unique_ptr<GlobalFunctionBinding>(new GlobalFunctionBinding(func, this)));
       int res = this->ptr->RegisterObjectBehaviour(obj_type_name.c_str(), asBEHAVE_DESTRUCT, "void f()", asFUNCTION(GlobalFunctionBindingDispatcher), asCALL_GENERIC, global_func_bindings.back().get());
       if(res < 0) throw std::runtime_error("Failed to register a destructor");
     }
@@ -123,13 +190,29 @@ namespace as
     static void GlobalFunctionBindingDispatcher(asIScriptGeneric *gen)
     {
       auto binding = (GlobalFunctionBinding*)gen->GetAuxiliary();
-      binding->func(gen);
+      auto *stats = binding->engine->binding_stats;
+      if(stats)
+      {
+        auto start_time = std::chrono::steady_clock::now();
+        binding->func(gen);
+        stats->time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        stats->calls_count++;
+      }
+      else
+      {
+        binding->func(gen);
+      }
     }
     static void MessageCallbackDispatcher(const asSMessageInfo *msg, void *param)
     {
       auto binding = (MessageCallbackBinding*)param;
       binding->func(msg);
     }
+    static void LineCallbackDispatcher(asIScriptContext *ctx, void *param)
+    {
+      auto binding = (LineCallbackBinding*)param;
+      binding->func(ctx);
+    }
     static void ExceptionCallbackDispatcher(asIScriptContext *ctx, void *param)
     {
       try
@@ -170,6 +253,7 @@ namespace as
     ScriptEngine(MessageCallbackBinding::FuncType message_func)
     {
       ptr = asCreateScriptEngine();
+      RegisterScriptArray(ptr, true);
       RegisterStdString(ptr);
       RegisterScriptMath_Generic(ptr);
       if(!ptr) throw std::runtime_error("Failed to start as engine");
@@ -0,0 +1,63 @@
+#include "FrameGraph.h"
+#include <set>
+
+namespace ls
+{
+  void InferAttachmentOps(ScriptEvents &script_events, const FrameAccesses &frame_accesses, bool is_reuse_tracked)
+  {
+    std::set<Image::Id> output_ids = GetOutputImageIds(script_events, is_reuse_tracked);
+
+    //walking backwards, a mip is needed when a later invocation reads it before fully overwriting it
+    std::set<std::pair<Image::Id, int>> needed_mips;
+    auto &invocations = script_events.script_shader_invocations;
+    for(size_t invocation_idx = invocations.size(); invocation_idx-- > 0;)
+    {
+      auto &invocation = invocations[invocation_idx];
+      const auto &accesses = frame_accesses[invocation_idx];
+      invocation.color_attachment_ops.clear();
+      for(size_t attachment_idx = 0; attachment_idx < invocation.color_attachments.size(); attachment_idx++)
+      {
+        const auto &access = accesses[attachment_idx];
+        bool is_stored = output_ids.count(access.id) || needed_mips.count({access.id, access.mip});
+        invocation.color_attachment_ops.push_back({
+          access.is_read ? LoadOps::load : LoadOps::dont_care,
+          is_stored ? StoreOps::store : StoreOps::dont_care
+        });
+      }
+      for(const auto &access : accesses)
+      {
+        if(access.is_write && access.is_full_overwrite)
+          needed_mips.erase({access.id, access.mip});
+      }
+      for(const auto &access : accesses)
+      {
+        if(access.is_read)
+          needed_mips.insert({access.id, access.mip});
+      }
+    }
+
+    std::map<Image::Id, ImageUsage> image_usages;
+    for(const auto &invocation : invocations)
+    {
+      for(const auto &attachment : invocation.color_attachments)
+        image_usages[attachment.id].is_render_target = true;
+      for(const auto &sampler_binding : invocation.image_sampler_bindings)
+      {
+        auto &usage = image_usages[sampler_binding.id];
+        usage.is_sampled = true;
+        if(sampler_binding.mip_range.x != 0 || sampler_binding.mip_range.y > 1)
+          usage.is_mip_sampled = true;
+      }
+      for(const auto &storage_binding : invocation.storage_image_bindings)
+        image_usages[storage_binding.image.id].is_storage = true;
+    }
+    for(auto &request : script_events.context_requests)
+    {
+      if(std::holds_alternative<CachedImageRequest>(request))
+      {
+        auto &image_request = std::get<CachedImageRequest>(request);
+        image_request.usage = image_usages[image_request.id];
+      }
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#include "FrameGraph.h"
+#include <set>
+
+namespace ls
+{
+  std::vector<InvocationBatch> BatchInvocations(const ScriptEvents &script_events, const FrameAccesses &frame_accesses, const ShaderDescsMap &shader_descs)
+  {
+    const auto &invocations = script_events.script_shader_invocations;
+    std::vector<InvocationBatch> batches;
+    size_t run_start = 0;
+    while(run_start < invocations.size())
+    {
+      //extend the run while the items don't touch anything an earlier item of the run writes, and don't write anything
+      //it reads. items of a batch are then free of hazards between each other and issuing them together keeps the order
+      const auto &first_invocation = invocations[run_start];
+      std::set<std::pair<Image::Id, int>> read_mips;
+      std::set<std::pair<Image::Id, int>> written_mips;
+      size_t run_end = run_start;
+      for(; run_end < invocations.size(); run_end++)
+      {
+        const auto &invocation = invocations[run_end];
+        if(invocation.shader_name != first_invocation.shader_name || invocation.uniform_data.size() != first_invocation.uniform_data.size())
+          break;
+        bool has_hazard = false;
+        for(const auto &access : frame_accesses[run_end])
+        {
+          std::pair<Image::Id, int> mip = {access.id, access.mip};
+          if(written_mips.count(mip) || (access.is_write && read_mips.count(mip)))
+            has_hazard = true;
+        }
+        if(has_hazard)
+          break;
+        for(const auto &access : frame_accesses[run_end])
+        {
+          if(access.is_read)
+            read_mips.insert({access.id, access.mip});
+          if(access.is_write)
+            written_mips.insert({access.id, access.mip});
+        }
+      }
+
+      if(run_end - run_start > 1)
+      {
+        auto desc_it = shader_descs.find(first_invocation.shader_name);
+        bool is_instanced = desc_it != shader_descs.end() && desc_it->second.pass_type == PassTypes::instanced;
+        InvocationBatch batch;
+        batch.shader_name = first_invocation.shader_name;
+        batch.first_invocation = run_start;
+        batch.invocations_count = run_end - run_start;
+        batch.uniform_stride = first_invocation.uniform_data.size();
+        for(size_t invocation_idx = run_start; invocation_idx < run_end; invocation_idx++)
+        {
+          const auto &invocation = invocations[invocation_idx];
+          batch.uniform_data.insert(batch.uniform_data.end(), invocation.uniform_data.begin(), invocation.uniform_data.end());
+          batch.color_attachments.push_back(invocation.color_attachments);
+          batch.image_sampler_bindings.push_back(invocation.image_sampler_bindings);
+          batch.storage_image_bindings.push_back(invocation.storage_image_bindings);
+          if(invocation.groups_count)
+            batch.groups_counts.push_back(invocation.groups_count.value());
+          if(is_instanced)
+          {
+            batch.instances_counts.push_back(invocation.instances_count);
+            batch.instance_data.push_back(invocation.instance_data);
+          }
+        }
+        batches.push_back(std::move(batch));
+      }
+      run_start = run_end;
+    }
+    return batches;
+  }
+}
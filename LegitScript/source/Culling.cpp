@@ -0,0 +1,81 @@
+#include "FrameGraph.h"
+#include <set>
+
+namespace ls
+{
+  CullingReport CullUnused(ScriptEvents &script_events, FrameAccesses &frame_accesses, bool is_reuse_tracked)
+  {
+    std::set<Image::Id> root_ids = GetOutputImageIds(script_events, is_reuse_tracked);
+
+    //mips whose current contents are still read by a later live invocation
+    std::set<std::pair<Image::Id, int>> needed_mips;
+    //mips of root images that a later live invocation fully overwrites, earlier writes to them are dead
+    std::set<std::pair<Image::Id, int>> overwritten_root_mips;
+    std::vector<bool> is_live(frame_accesses.size(), false);
+    for(size_t invocation_idx = frame_accesses.size(); invocation_idx-- > 0;)
+    {
+      const auto &accesses = frame_accesses[invocation_idx];
+      for(const auto &access : accesses)
+      {
+        if(!access.is_write)
+          continue;
+        std::pair<Image::Id, int> mip = {access.id, access.mip};
+        bool is_root_mip = root_ids.count(access.id) && !overwritten_root_mips.count(mip);
+        if(is_root_mip || needed_mips.count(mip))
+          is_live[invocation_idx] = true;
+      }
+      if(!is_live[invocation_idx])
+        continue;
+      for(const auto &access : accesses)
+      {
+        if(!access.is_write || !access.is_full_overwrite)
+          continue;
+        needed_mips.erase({access.id, access.mip});
+        if(root_ids.count(access.id))
+          overwritten_root_mips.insert({access.id, access.mip});
+      }
+      for(const auto &access : accesses)
+      {
+        if(access.is_read)
+          needed_mips.insert({access.id, access.mip});
+      }
+    }
+
+    CullingReport report;
+    std::vector<ShaderInvocation> live_invocations;
+    FrameAccesses live_accesses;
+    std::set<Image::Id> used_ids = root_ids;
+    for(size_t invocation_idx = 0; invocation_idx < frame_accesses.size(); invocation_idx++)
+    {
+      if(!is_live[invocation_idx])
+      {
+        report.removed_invocations.push_back(invocation_idx);
+        continue;
+      }
+      for(const auto &access : frame_accesses[invocation_idx])
+        used_ids.insert(access.id);
+      live_invocations.push_back(std::move(script_events.script_shader_invocations[invocation_idx]));
+      live_accesses.push_back(std::move(frame_accesses[invocation_idx]));
+    }
+    script_events.script_shader_invocations = std::move(live_invocations);
+    frame_accesses = std::move(live_accesses);
+
+    //image invalidations are left in place: the backend still has to drop the stale allocation before the id is requested again
+    std::vector<ContextRequest> live_requests;
+    for(auto &request : script_events.context_requests)
+    {
+      if(std::holds_alternative<CachedImageRequest>(request))
+      {
+        Image::Id id = std::get<CachedImageRequest>(request).id;
+        if(!used_ids.count(id))
+        {
+          report.removed_image_ids.push_back(id);
+          continue;
+        }
+      }
+      live_requests.push_back(std::move(request));
+    }
+    script_events.context_requests = std::move(live_requests);
+    return report;
+  }
+}
@@ -0,0 +1,97 @@
+#include "FrameGraph.h"
+#include <algorithm>
+
+namespace ls
+{
+  //accesses to one mip since its last write
+  struct MipState
+  {
+    std::optional<size_t> last_writer;
+    std::vector<size_t> readers;
+    bool is_read_barrier_placed = false;
+  };
+
+  void AddDependency(FrameDependencyGraph &graph, size_t src_invocation, size_t dst_invocation)
+  {
+    if(src_invocation == dst_invocation)
+      return;
+    auto &dependencies = graph.dependencies[dst_invocation];
+    if(std::find(dependencies.begin(), dependencies.end(), src_invocation) == dependencies.end())
+      dependencies.push_back(src_invocation);
+  }
+
+  FrameDependencyGraph BuildDependencyGraph(const FrameAccesses &frame_accesses)
+  {
+    FrameDependencyGraph graph;
+    graph.dependencies.resize(frame_accesses.size());
+    std::map<std::pair<Image::Id, int>, MipState> mip_states;
+
+    for(size_t invocation_idx = 0; invocation_idx < frame_accesses.size(); invocation_idx++)
+    {
+      //reads are resolved before writes so that blending against an attachment depends on its previous writer
+      for(const auto &access : frame_accesses[invocation_idx])
+      {
+        if(!access.is_read)
+          continue;
+        auto &state = mip_states[{access.id, access.mip}];
+        if(state.last_writer && state.last_writer.value() != invocation_idx)
+        {
+          AddDependency(graph, state.last_writer.value(), invocation_idx);
+          if(!state.is_read_barrier_placed)
+          {
+            graph.barriers.push_back({state.last_writer.value(), invocation_idx, access.id, access.mip, HazardTypes::read_after_write});
+            state.is_read_barrier_placed = true;
+          }
+        }
+        if(std::find(state.readers.begin(), state.readers.end(), invocation_idx) == state.readers.end())
+          state.readers.push_back(invocation_idx);
+      }
+      for(const auto &access : frame_accesses[invocation_idx])
+      {
+        if(!access.is_write)
+          continue;
+        auto &state = mip_states[{access.id, access.mip}];
+        std::optional<size_t> last_reader;
+        bool is_read_by_self = false;
+        for(size_t reader : state.readers)
+        {
+          if(reader == invocation_idx)
+          {
+            is_read_by_self = true;
+            continue;
+          }
+          AddDependency(graph, reader, invocation_idx);
+          last_reader = std::max(last_reader.value_or(reader), reader);
+        }
+        if(last_reader)
+        {
+          graph.barriers.push_back({last_reader.value(), invocation_idx, access.id, access.mip, HazardTypes::write_after_read});
+        }else
+        if(state.last_writer && state.last_writer.value() != invocation_idx && !is_read_by_self)
+        {
+          AddDependency(graph, state.last_writer.value(), invocation_idx);
+          graph.barriers.push_back({state.last_writer.value(), invocation_idx, access.id, access.mip, HazardTypes::write_after_write});
+        }
+        state.last_writer = invocation_idx;
+        state.readers.clear();
+        state.is_read_barrier_placed = false;
+      }
+    }
+
+    //dependencies always point to earlier invocations, so levels can be assigned in a single pass
+    std::vector<size_t> invocation_levels(frame_accesses.size(), 0);
+    for(size_t invocation_idx = 0; invocation_idx < frame_accesses.size(); invocation_idx++)
+    {
+      auto &dependencies = graph.dependencies[invocation_idx];
+      std::sort(dependencies.begin(), dependencies.end());
+      for(size_t dependency : dependencies)
+        invocation_levels[invocation_idx] = std::max(invocation_levels[invocation_idx], invocation_levels[dependency] + 1);
+      size_t level = invocation_levels[invocation_idx];
+      if(graph.levels.size() <= level)
+        graph.levels.resize(level + 1);
+      graph.levels[level].push_back(invocation_idx);
+    }
+    graph.critical_path_length = graph.levels.size();
+    return graph;
+  }
+}
@@ -0,0 +1,78 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ls
+{
+  InvocationAccesses GetInvocationAccesses(const ShaderInvocation &invocation, const ShaderDescsMap &shader_descs)
+  {
+    auto desc_it = shader_descs.find(invocation.shader_name);
+    bool is_blended = desc_it != shader_descs.end() && desc_it->second.blend_mode != BlendModes::opaque;
+    //instanced geometry only covers part of its render targets
+    bool is_instanced = desc_it != shader_descs.end() && desc_it->second.pass_type == PassTypes::instanced;
+
+    InvocationAccesses accesses;
+    for(const auto &attachment : invocation.color_attachments)
+    {
+      accesses.push_back({attachment.id, attachment.mip_range.x, is_blended || is_instanced, true, !is_blended && !is_instanced});
+    }
+    for(const auto &sampler_binding : invocation.image_sampler_bindings)
+    {
+      for(int mip = sampler_binding.mip_range.x; mip < sampler_binding.mip_range.y; mip++)
+        accesses.push_back({sampler_binding.id, mip, true, false, false});
+    }
+    //nothing guarantees that a storage image gets written everywhere, so even writeonly bindings keep the previous contents
+    for(const auto &storage_binding : invocation.storage_image_bindings)
+    {
+      bool is_read = storage_binding.access_qualifier != AccessQualifiers::writeonly;
+      bool is_write = storage_binding.access_qualifier != AccessQualifiers::readonly;
+      accesses.push_back({storage_binding.image.id, storage_binding.image.mip_range.x, is_read, is_write, false});
+    }
+    return accesses;
+  }
+
+  FrameAccesses GetFrameAccesses(const ScriptEvents &script_events, const ShaderDescsMap &shader_descs)
+  {
+    FrameAccesses frame_accesses;
+    for(const auto &invocation : script_events.script_shader_invocations)
+      frame_accesses.push_back(GetInvocationAccesses(invocation, shader_descs));
+    return frame_accesses;
+  }
+
+  std::set<Image::Id> GetOutputImageIds(const ScriptEvents &script_events, bool is_reuse_tracked)
+  {
+    std::set<Image::Id> output_ids = {swapchain_img_id};
+    output_ids.insert(script_events.external_output_ids.begin(), script_events.external_output_ids.end());
+    for(const auto &request : script_events.context_requests)
+    {
+      if(std::holds_alternative<PersistentImageRequest>(request) && !std::get<PersistentImageRequest>(request).is_history)
+        output_ids.insert(std::get<PersistentImageRequest>(request).id);
+      if(std::holds_alternative<CachedImageRequest>(request) && is_reuse_tracked)
+        output_ids.insert(std::get<CachedImageRequest>(request).id);
+    }
+    return output_ids;
+  }
+
+  size_t GetPixelFormatBytes(ls::PixelFormats pixel_format)
+  {
+    switch(pixel_format)
+    {
+      case ls::PixelFormats::rgba8: return 4; break;
+      case ls::PixelFormats::rgba16f: return 8; break;
+      case ls::PixelFormats::rgba32f: return 16; break;
+    }
+    throw std::runtime_error("Unknown pixel format");
+  }
+
+  size_t GetImageBytes(const CachedImageRequest &image_request)
+  {
+    size_t image_bytes = 0;
+    uvec2 mip_size = image_request.size;
+    for(size_t mip = 0; mip < image_request.mips_count; mip++)
+    {
+      image_bytes += size_t(std::max(mip_size.x, 1u)) * std::max(mip_size.y, 1u) * GetPixelFormatBytes(image_request.pixel_format);
+      mip_size = uvec2{mip_size.x / 2, mip_size.y / 2};
+    }
+    return image_bytes;
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "../include/LegitScriptEvents.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ls
+{
+  const Image::Id swapchain_img_id = 0;
+  using ShaderDescsMap = std::map<std::string, ls::ShaderDesc>;
+
+  //how an invocation touches a single mip of an image
+  struct ImageAccess
+  {
+    Image::Id id;
+    int mip;
+    bool is_read;
+    bool is_write;
+    //the invocation does not depend on the previous contents of the mip: fullscreen opaque render targets
+    bool is_full_overwrite;
+  };
+  //color attachments come first, in the order of ShaderInvocation::color_attachments
+  using InvocationAccesses = std::vector<ImageAccess>;
+  //accesses of every invocation of the frame, in invocation order
+  using FrameAccesses = std::vector<InvocationAccesses>;
+
+  //images whose contents are needed after the frame: the swapchain, external outputs and current copies of persistent images.
+  //cached images too when is_reuse_tracked is set, invocation reuse tracking carries their contents into the next frame
+  std::set<Image::Id> GetOutputImageIds(const ScriptEvents &script_events, bool is_reuse_tracked);
+  FrameAccesses GetFrameAccesses(const ScriptEvents &script_events, const ShaderDescsMap &shader_descs);
+  size_t GetPixelFormatBytes(ls::PixelFormats pixel_format);
+  //memory taken by the whole mip chain of the image
+  size_t GetImageBytes(const CachedImageRequest &image_request);
+
+  //removes dead invocations and unused cached image requests from script_events, frame_accesses is updated to match
+  CullingReport CullUnused(ScriptEvents &script_events, FrameAccesses &frame_accesses, bool is_reuse_tracked);
+  //reorders invocations of script_events and frame_accesses without breaking any of their hazards
+  RenderPassSchedule ScheduleRenderPasses(ScriptEvents &script_events, FrameAccesses &frame_accesses);
+  void InferAttachmentOps(ScriptEvents &script_events, const FrameAccesses &frame_accesses, bool is_reuse_tracked);
+  ImageAliasingPlan BuildImageAliasingPlan(const ScriptEvents &script_events, const FrameAccesses &frame_accesses, bool is_reuse_tracked);
+  FrameDependencyGraph BuildDependencyGraph(const FrameAccesses &frame_accesses);
+  //finds runs of consecutive invocations of one shader without hazards between them, the invocations themselves are kept
+  std::vector<InvocationBatch> BatchInvocations(const ScriptEvents &script_events, const FrameAccesses &frame_accesses, const ShaderDescsMap &shader_descs);
+
+  inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+  {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+  }
+
+  //keeps content signatures of image mips between frames
+  class InvocationReuseTracker
+  {
+  public:
+    InvocationReuseReport Process(ScriptEvents &script_events, const FrameAccesses &frame_accesses);
+    void Reset();
+  private:
+    using Mip = std::pair<Image::Id, int>;
+    //signature of the contents every mip had at the end of the last frame that wrote it
+    std::map<Mip, uint64_t> stored_signatures;
+    std::map<Image::Id, size_t> content_versions;
+  };
+}
@@ -0,0 +1,104 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <set>
+
+namespace ls
+{
+  bool IsSameImageDesc(const CachedImageRequest &left, const CachedImageRequest &right)
+  {
+    return left.pixel_format == right.pixel_format && left.size.x == right.size.x && left.size.y == right.size.y && left.mips_count == right.mips_count;
+  }
+
+  ImageAliasingPlan BuildImageAliasingPlan(const ScriptEvents &script_events, const FrameAccesses &frame_accesses, bool is_reuse_tracked)
+  {
+    //outputs have to survive the end of the frame, so they can't share memory
+    auto output_ids = GetOutputImageIds(script_events, is_reuse_tracked);
+    std::map<Image::Id, CachedImageRequest> image_requests;
+    for(const auto &request : script_events.context_requests)
+    {
+      if(std::holds_alternative<CachedImageRequest>(request))
+      {
+        const auto &image_request = std::get<CachedImageRequest>(request);
+        if(!output_ids.count(image_request.id))
+          image_requests[image_request.id] = image_request;
+      }
+    }
+
+    //an image read before the frame writes it uses what the previous frame left in it, so its memory can't be shared either
+    std::set<std::pair<Image::Id, int>> written_mips;
+    for(const auto &accesses : frame_accesses)
+    {
+      for(const auto &access : accesses)
+      {
+        if(access.is_read && !written_mips.count({access.id, access.mip}))
+          image_requests.erase(access.id);
+      }
+      for(const auto &access : accesses)
+      {
+        if(access.is_write)
+          written_mips.insert({access.id, access.mip});
+      }
+    }
+
+    std::map<Image::Id, ImageLifetime> lifetimes;
+    for(size_t invocation_idx = 0; invocation_idx < frame_accesses.size(); invocation_idx++)
+    {
+      for(const auto &access : frame_accesses[invocation_idx])
+      {
+        auto request_it = image_requests.find(access.id);
+        if(request_it == image_requests.end())
+          continue;
+        auto lifetime_it = lifetimes.find(access.id);
+        if(lifetime_it == lifetimes.end())
+          lifetimes[access.id] = {access.id, invocation_idx, invocation_idx, GetImageBytes(request_it->second), 0};
+        else
+          lifetime_it->second.last_invocation = invocation_idx;
+      }
+    }
+
+    ImageAliasingPlan plan;
+    for(const auto &lifetime : lifetimes)
+      plan.image_lifetimes.push_back(lifetime.second);
+    std::stable_sort(plan.image_lifetimes.begin(), plan.image_lifetimes.end(), [](const ImageLifetime &left, const ImageLifetime &right){
+      return left.first_invocation < right.first_invocation;
+    });
+
+    //greedy interval assignment: a slot is free once the last invocation of its previous image is done.
+    //among free slots an identical image desc is preferred, then the smallest slot that fits, then the largest slot which grows
+    std::vector<size_t> slot_free_after;
+    for(auto &lifetime : plan.image_lifetimes)
+    {
+      const auto &image_request = image_requests[lifetime.id];
+      std::optional<size_t> best_slot_idx;
+      auto get_rank = [&](size_t slot_idx){
+        const auto &slot = plan.slots[slot_idx];
+        bool is_same_desc = IsSameImageDesc(image_requests[slot.image_ids.back()], image_request);
+        bool is_fitting = slot.size_bytes >= lifetime.size_bytes;
+        return std::make_tuple(!is_same_desc, !is_fitting, is_fitting ? slot.size_bytes : size_t(-1) - slot.size_bytes);
+      };
+      for(size_t slot_idx = 0; slot_idx < plan.slots.size(); slot_idx++)
+      {
+        if(slot_free_after[slot_idx] >= lifetime.first_invocation)
+          continue;
+        if(!best_slot_idx || get_rank(slot_idx) < get_rank(best_slot_idx.value()))
+          best_slot_idx = slot_idx;
+      }
+      if(!best_slot_idx)
+      {
+        best_slot_idx = plan.slots.size();
+        plan.slots.push_back({0, {}});
+        slot_free_after.push_back(0);
+      }
+      auto &slot = plan.slots[best_slot_idx.value()];
+      slot.size_bytes = std::max(slot.size_bytes, lifetime.size_bytes);
+      slot.image_ids.push_back(lifetime.id);
+      slot_free_after[best_slot_idx.value()] = lifetime.last_invocation;
+      lifetime.slot_idx = best_slot_idx.value();
+
+      plan.unaliased_bytes += lifetime.size_bytes;
+    }
+    for(const auto &slot : plan.slots)
+      plan.aliased_bytes += slot.size_bytes;
+    return plan;
+  }
+}
@@ -11,7 +11,7 @@ namespace ls
   };
   using Graph = std::vector<GraphNode>;
   
-  void FlattenNode(const Graph& graph, GraphNode &dst_node, NodeIdx curr_idx, size_t depth)
+  inline void FlattenNode(const Graph& graph, GraphNode &dst_node, NodeIdx curr_idx, size_t depth)
   {
     if(depth > 1024)
       throw std::runtime_error("Can't flatten graph");
@@ -24,7 +24,7 @@ namespace ls
       dst_node.adjacent_nodes.push_back(curr_idx);
   }
   
-  Graph FlattenGraph(Graph graph)
+  inline Graph FlattenGraph(Graph graph)
   {
     Graph res_graph;
     for(NodeIdx node_idx = 0; node_idx < graph.size(); node_idx++)
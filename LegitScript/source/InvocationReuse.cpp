@@ -0,0 +1,155 @@
+#include "FrameGraph.h"
+#include <functional>
+
+namespace ls
+{
+  InvocationReuseReport InvocationReuseTracker::Process(ScriptEvents &script_events, const FrameAccesses &frame_accesses)
+  {
+    //contents of resized images are gone
+    for(const auto &invalidation : script_events.image_invalidations)
+    {
+      for(auto it = stored_signatures.lower_bound({invalidation.id, 0}); it != stored_signatures.end() && it->first.first == invalidation.id;)
+        it = stored_signatures.erase(it);
+    }
+    //released ids are handed out to other images later
+    for(Image::Id id : script_events.released_image_ids)
+    {
+      for(auto it = stored_signatures.lower_bound({id, 0}); it != stored_signatures.end() && it->first.first == id;)
+        it = stored_signatures.erase(it);
+      content_versions.erase(id);
+    }
+
+    auto &invocations = script_events.script_shader_invocations;
+    //a read of a mip version written earlier in the frame, or of the contents left from the previous frames if writer_idx is empty
+    struct MipRead
+    {
+      size_t reader_idx;
+      Mip mip;
+      std::optional<size_t> writer_idx;
+    };
+    std::vector<MipRead> mip_reads;
+    std::map<Mip, uint64_t> frame_signatures;
+    std::map<Mip, std::vector<size_t>> mip_writers;
+    for(size_t invocation_idx = 0; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      auto &invocation = invocations[invocation_idx];
+      uint64_t inputs_hash = std::hash<std::string>()(invocation.shader_name);
+      for(uint8_t byte : invocation.uniform_data)
+        inputs_hash = HashCombine(inputs_hash, byte);
+      inputs_hash = HashCombine(inputs_hash, invocation.instances_count);
+      for(uint8_t byte : invocation.instance_data)
+        inputs_hash = HashCombine(inputs_hash, byte);
+      if(invocation.groups_count)
+        inputs_hash = HashCombine(HashCombine(HashCombine(inputs_hash, invocation.groups_count->x), invocation.groups_count->y), invocation.groups_count->z);
+      for(const auto &access : frame_accesses[invocation_idx])
+      {
+        Mip mip = {access.id, access.mip};
+        inputs_hash = HashCombine(HashCombine(HashCombine(inputs_hash, access.id), access.mip), access.is_write);
+        if(!access.is_read)
+          continue;
+        auto frame_it = frame_signatures.find(mip);
+        auto stored_it = stored_signatures.find(mip);
+        uint64_t signature = frame_it != frame_signatures.end() ? frame_it->second : (stored_it != stored_signatures.end() ? stored_it->second : 0);
+        inputs_hash = HashCombine(inputs_hash, signature);
+
+        auto writers_it = mip_writers.find(mip);
+        std::optional<size_t> writer_idx;
+        if(writers_it != mip_writers.end())
+          writer_idx = writers_it->second.back();
+        mip_reads.push_back({invocation_idx, mip, writer_idx});
+      }
+      for(const auto &access : frame_accesses[invocation_idx])
+      {
+        if(!access.is_write)
+          continue;
+        Mip mip = {access.id, access.mip};
+        frame_signatures[mip] = HashCombine(inputs_hash, access.mip);
+        auto &writers = mip_writers[mip];
+        if(writers.empty() || writers.back() != invocation_idx)
+          writers.push_back(invocation_idx);
+      }
+      invocation.inputs_hash = inputs_hash;
+    }
+
+    //an invocation is reusable when every mip it writes ends the frame the same as in the previous one.
+    //the swapchain is presented every frame, so its contents are never kept
+    std::set<Mip> changed_mips;
+    for(const auto &frame_signature : frame_signatures)
+    {
+      auto stored_it = stored_signatures.find(frame_signature.first);
+      if(frame_signature.first.first == swapchain_img_id || stored_it == stored_signatures.end() || stored_it->second != frame_signature.second)
+        changed_mips.insert(frame_signature.first);
+    }
+    std::vector<bool> is_reusable(invocations.size(), false);
+    for(size_t invocation_idx = 0; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      bool is_writing = false;
+      bool is_changed = false;
+      for(const auto &access : frame_accesses[invocation_idx])
+      {
+        if(!access.is_write)
+          continue;
+        is_writing = true;
+        is_changed |= changed_mips.count({access.id, access.mip}) > 0;
+      }
+      is_reusable[invocation_idx] = is_writing && !is_changed;
+    }
+
+    //skipped writers leave the final contents of the previous frame in place. an invocation that runs and reads an
+    //intermediate version of a mip needs that version's writer to run too, and then every later writer of that mip
+    //has to run so that its contents are overwritten in the original order
+    for(bool is_changed = true; is_changed;)
+    {
+      is_changed = false;
+      for(const auto &mip_read : mip_reads)
+      {
+        if(is_reusable[mip_read.reader_idx] || !mip_read.writer_idx)
+          continue;
+        const auto &writers = mip_writers[mip_read.mip];
+        bool is_final_version = writers.back() == mip_read.writer_idx.value();
+        if(!is_final_version && is_reusable[mip_read.writer_idx.value()])
+        {
+          is_reusable[mip_read.writer_idx.value()] = false;
+          is_changed = true;
+        }
+      }
+      for(const auto &writers : mip_writers)
+      {
+        bool is_running = false;
+        for(size_t writer_idx : writers.second)
+        {
+          is_running |= !is_reusable[writer_idx];
+          if(is_running && is_reusable[writer_idx])
+          {
+            is_reusable[writer_idx] = false;
+            is_changed = true;
+          }
+        }
+      }
+    }
+
+    InvocationReuseReport report;
+    for(size_t invocation_idx = 0; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      invocations[invocation_idx].is_reusable = is_reusable[invocation_idx];
+      report.reusable_invocations_count += is_reusable[invocation_idx] ? 1 : 0;
+    }
+
+    std::set<Image::Id> changed_ids;
+    for(const auto &mip : changed_mips)
+      changed_ids.insert(mip.first);
+    for(Image::Id id : changed_ids)
+      content_versions[id]++;
+    for(const auto &frame_signature : frame_signatures)
+      stored_signatures[frame_signature.first] = frame_signature.second;
+    for(const auto &content_version : content_versions)
+      report.image_content_versions.push_back({content_version.first, content_version.second});
+    return report;
+  }
+
+  void InvocationReuseTracker::Reset()
+  {
+    stored_signatures.clear();
+    content_versions.clear();
+  }
+}
@@ -5,6 +5,8 @@
 #include <map>
 #include "IncludeGraph.h"
 #include "../include/SourceAssembler.h"
+#include "Tracing.h"
+#include "FrameGraph.h"
 namespace ls
 {
   void AddShaderDescArg(ls::ShaderDesc &desc, const ls::DecoratedPodType &dec_pod_type, std::string name)
@@ -26,6 +28,8 @@ namespace ls
   }
   void AddShaderDescArg(ls::ShaderDesc &desc, const ls::DecoratedImageType &dec_image_type, std::string name)
   {
+    auto access_qualifier = dec_image_type.access_qualifiers.value_or(ls::AccessQualifiers::readwrite);
+    desc.images.push_back({ImageTypeToString(dec_image_type.image_type), name, dec_image_type.pixel_format, access_qualifier});
   }
   
   ls::ShaderDesc CreateShaderDesc(const ls::PassDecl &decl, std::vector<std::string> flattened_includes, const ls::Preamble &preamble, ls::BlockBody body)
@@ -42,6 +46,19 @@ namespace ls
         desc.blend_mode = std::get<ls::BlendModes>(p);
       }
     }
+    if(decl.type == ls::PassDecl::Types::ComputePass)
+    {
+      desc.pass_type = ls::PassTypes::compute;
+      desc.workgroup_size = ls::uvec3{(unsigned int)decl.numthreads.x, (unsigned int)decl.numthreads.y, (unsigned int)decl.numthreads.z};
+    }
+    if(decl.type == ls::PassDecl::Types::InstancedPass)
+    {
+      desc.pass_type = ls::PassTypes::instanced;
+      desc.vertices_per_instance = (unsigned int)decl.instanced.vertices_count;
+      for(const auto &attribute : decl.instanced.attributes)
+        desc.instance_attributes.push_back({PodTypeToString(attribute.type), attribute.name, attribute.offset});
+      desc.instance_stride = decl.instanced.stride;
+    }
     
     for(const auto &arg : decl.arg_descs)
     {
@@ -80,6 +97,30 @@ namespace ls
     return includes;
   }
   
+  std::optional<ls::NumthreadsSection> FindPreambleNumthreads(const ls::Preamble &preamble)
+  {
+    for(auto p : preamble)
+    {
+      if(std::holds_alternative<ls::NumthreadsSection>(p))
+      {
+        return std::get<ls::NumthreadsSection>(p);
+      }
+    }
+    return std::nullopt;
+  }
+  
+  std::optional<ls::InstancedSection> FindPreambleInstanced(const ls::Preamble &preamble)
+  {
+    for(auto p : preamble)
+    {
+      if(std::holds_alternative<ls::InstancedSection>(p))
+      {
+        return std::get<ls::InstancedSection>(p);
+      }
+    }
+    return std::nullopt;
+  }
+  
   bool FindPreambleIsRendergraph(const ls::Preamble &preamble)
   {
     for(auto p : preamble)
@@ -129,10 +170,12 @@ namespace ls
     ~Impl(){}
     ls::ScriptContents LoadScript(std::string script_source)
     {
+      LS_TRACE_SCOPE("LoadScript");
       ls::ScriptContents script_contents;
       ls::ParsedScript parsed_script;
       try
       {
+        LS_TRACE_SCOPE("ParseScript");
         parsed_script = script_parser.Parse(script_source);
       }catch(const ls::ScriptParserException &e)
       {
@@ -143,19 +186,60 @@ namespace ls
           e.desc
         );
       }
-      auto direct_include_graph = BuildBlockDirectGraph(parsed_script.blocks);
-      auto flattened_include_graph = ls::FlattenGraph(direct_include_graph);
+      ls::Graph flattened_include_graph;
+      {
+        LS_TRACE_SCOPE("FlattenIncludeGraph");
+        auto direct_include_graph = BuildBlockDirectGraph(parsed_script.blocks);
+        flattened_include_graph = ls::FlattenGraph(direct_include_graph);
+      }
 
       std::vector<PassDecl> pass_decls;
       
       for(size_t block_idx = 0; block_idx < parsed_script.blocks.size(); block_idx++)
       {
+        LS_TRACE_SCOPE("CreateShaderDesc");
         const auto &block = parsed_script.blocks[block_idx];
         if(!FindPreambleIsRendergraph(block.preamble))
         {
           if(block.decl.has_value())
           {
             auto pass_decl = block.decl.value();
+            auto opt_numthreads = FindPreambleNumthreads(block.preamble);
+            if(opt_numthreads)
+            {
+              auto numthreads = opt_numthreads.value();
+              if(numthreads.x <= 0 || numthreads.y <= 0 || numthreads.z <= 0)
+                throw ls::ScriptException(block.body.start, 0, "", "Pass " + pass_decl.name + " has to have at least 1 thread along each axis");
+              for(const auto &arg_desc : pass_decl.arg_descs)
+              {
+                if(
+                  std::holds_alternative<ls::DecoratedPodType>(arg_desc.type) &&
+                  std::get<ls::DecoratedPodType>(arg_desc.type).access_qalifier == ls::DecoratedPodType::AccessQualifiers::out)
+                {
+                  throw ls::ScriptException(block.body.start, 0, "", "Compute pass " + pass_decl.name + " can't have render targets");
+                }
+              }
+              pass_decl.type = ls::PassDecl::Types::ComputePass;
+              pass_decl.numthreads = numthreads;
+            }
+            auto opt_instanced = FindPreambleInstanced(block.preamble);
+            if(opt_instanced)
+            {
+              auto instanced = opt_instanced.value();
+              if(opt_numthreads)
+                throw ls::ScriptException(block.body.start, 0, "", "Pass " + pass_decl.name + " can't be both compute and instanced");
+              if(instanced.vertices_count <= 0)
+                throw ls::ScriptException(block.body.start, 0, "", "Instanced pass " + pass_decl.name + " has to have at least 1 vertex per instance");
+              for(auto &attribute : instanced.attributes)
+              {
+                if(attribute.type == ls::DecoratedPodType::PodTypes::void_)
+                  throw ls::ScriptException(block.body.start, 0, "", "Instance attribute " + attribute.name + " can't be void");
+                attribute.offset = instanced.stride;
+                instanced.stride += GetPodTypeSize(attribute.type);
+              }
+              pass_decl.type = ls::PassDecl::Types::InstancedPass;
+              pass_decl.instanced = instanced;
+            }
             pass_decls.push_back(pass_decl);
             std::vector<std::string> includes;
             for(auto included_idx : flattened_include_graph[block_idx].adjacent_nodes)
@@ -201,7 +285,12 @@ namespace ls
           source_assembler->AddNonSourceBlock("}\n");
           try
           {
+            LS_TRACE_SCOPE("LoadRenderGraph");
             render_graph_script.LoadScript(source_assembler->GetSource(), pass_decls);
+            script_contents.is_static_render_graph = render_graph_script.IsStaticGraph();
+            script_contents.jit_compiled_functions_count = render_graph_script.GetJitCompiledFunctionsCount();
+            script_contents.byte_code_rewrites_count = render_graph_script.GetByteCodeRewritesCount();
+            script_contents.is_aot_render_graph = render_graph_script.IsAotModule();
           }
           catch(const ls::RenderGraphBuildException &e)
           {
@@ -216,13 +305,22 @@ namespace ls
         }
       }
 
+      invocation_reuse_tracker.Reset();
+      shader_descs.clear();
+      for(const auto &shader_desc : script_contents.shader_descs)
+        shader_descs[shader_desc.name] = shader_desc;
       return script_contents;
     }
     ls::ScriptEvents RunScript(const std::vector<ContextInput> &context_inputs)
     {
+      LS_TRACE_SCOPE("RunScript");
       try
       {
-        return render_graph_script.RunScript(context_inputs);
+        auto script_events = render_graph_script.RunScript(context_inputs);
+        if(script_events.profile)
+          script_events.profile = MapProfileLines(script_events.profile.value());
+        AnalyzeFrameGraph(script_events);
+        return script_events;
       }
       catch(const ls::RenderGraphRuntimeException &e)
       {
@@ -235,10 +333,64 @@ namespace ls
         );
       }
     }
+    void SetOptions(const ls::ScriptOptions &options)
+    {
+      this->options = options;
+      render_graph_script.SetOptions(options);
+    }
+    std::string GenerateAotSource()
+    {
+      return render_graph_script.GenerateAotSource();
+    }
   private:
+    //analyses of the recorded invocations that don't need the script itself
+    void AnalyzeFrameGraph(ls::ScriptEvents &script_events)
+    {
+      if(!options.cull_unused && !options.schedule_render_passes && !options.track_invocation_reuse && !options.infer_attachment_ops && !options.build_aliasing_plan && !options.build_dependency_graph && !options.batch_invocations)
+        return;
+      LS_TRACE_SCOPE("AnalyzeFrameGraph");
+      auto frame_accesses = GetFrameAccesses(script_events, shader_descs);
+      if(options.cull_unused)
+        script_events.culling = CullUnused(script_events, frame_accesses, options.track_invocation_reuse);
+      if(options.schedule_render_passes)
+        script_events.render_pass_schedule = ScheduleRenderPasses(script_events, frame_accesses);
+      if(options.track_invocation_reuse)
+        script_events.invocation_reuse = invocation_reuse_tracker.Process(script_events, frame_accesses);
+      if(options.infer_attachment_ops)
+        InferAttachmentOps(script_events, frame_accesses, options.track_invocation_reuse);
+      if(options.build_aliasing_plan)
+        script_events.aliasing_plan = BuildImageAliasingPlan(script_events, frame_accesses, options.track_invocation_reuse);
+      if(options.build_dependency_graph)
+        script_events.dependency_graph = BuildDependencyGraph(frame_accesses);
+      if(options.batch_invocations)
+        script_events.invocation_batches = BatchInvocations(script_events, frame_accesses, shader_descs);
+    }
+    //converts lines of the assembled render graph source to the lines of the original script
+    ls::ScriptProfile MapProfileLines(const ls::ScriptProfile &src_profile)
+    {
+      std::map<size_t, ls::ScriptProfile::Line> source_lines;
+      for(const auto &line : src_profile.lines)
+      {
+        auto opt_line = source_assembler->GetSourceLine(line.line);
+        if(!opt_line)
+          continue;
+        auto &dst_line = source_lines[opt_line.value()];
+        dst_line.line = opt_line.value();
+        dst_line.hits_count += line.hits_count;
+        dst_line.time_ms += line.time_ms;
+      }
+      ls::ScriptProfile dst_profile;
+      dst_profile.functions = src_profile.functions;
+      for(const auto &source_line : source_lines)
+        dst_profile.lines.push_back(source_line.second);
+      return dst_profile;
+    }
     ls::RenderGraphScript render_graph_script;
     std::unique_ptr<ls::SourceAssembler> source_assembler;
     ls::ScriptParser script_parser;
+    ls::ShaderDescsMap shader_descs;
+    ls::ScriptOptions options;
+    ls::InvocationReuseTracker invocation_reuse_tracker;
   };
   
   ls::ScriptEvents LegitScript::RunScript(const std::vector<ContextInput> &context_inputs)
@@ -250,6 +402,16 @@ namespace ls
   {
     return impl->LoadScript(script_source);
   }
+
+  void LegitScript::SetOptions(const ls::ScriptOptions &options)
+  {
+    impl->SetOptions(options);
+  }
+
+  std::string LegitScript::GenerateAotSource()
+  {
+    return impl->GenerateAotSource();
+  }
   
   LegitScript::LegitScript()
   {
@@ -1,5 +1,6 @@
 #include "../include/LegitScriptJsonApi.h"
 #include "../include/LegitScript.h"
+#include "Tracing.h"
 #include <assert.h>
 #include <json.hpp>
 namespace ls
@@ -7,6 +8,9 @@ namespace ls
   using json = nlohmann::json;
   std::unique_ptr<ls::LegitScript> instance;
   ls::ScriptContents script_contents;
+  ls::ScriptOptions script_options;
+  //json of the last memoized frame and the executed frame it repeats
+  std::optional<std::pair<size_t, std::string>> memoized_json;
   
   
   json SerializeSamplers(const std::vector<ls::ShaderDesc::Sampler> samplers)
@@ -28,6 +32,42 @@ namespace ls
       case ls::BlendModes::multiplicative: return "multiplicative"; break;
     }
   }
+  std::string PixelFormatToStr(ls::PixelFormats format)
+  {
+    switch(format)
+    {
+      case ls::PixelFormats::rgba8: return "rgba8"; break;
+      case ls::PixelFormats::rgba16f: return "rgba16f"; break;
+      case ls::PixelFormats::rgba32f: return "rgba32f"; break;
+    }
+    assert(0);
+    return "<unknown>";
+  }
+  std::string GetAccessQualifierStr(ls::AccessQualifiers access_qualifier)
+  {
+    switch(access_qualifier)
+    {
+      case ls::AccessQualifiers::readonly: return "readonly"; break;
+      case ls::AccessQualifiers::writeonly: return "writeonly"; break;
+      case ls::AccessQualifiers::readwrite: return "readwrite"; break;
+    }
+    assert(0);
+    return "<unknown>";
+  }
+  json SerializeImages(const std::vector<ls::ShaderDesc::Image> images)
+  {
+    auto arr = json::array();
+    for(auto image : images)
+    {
+      arr.push_back(json::object({
+        {"type", image.type},
+        {"name", image.name},
+        {"pixel_format", PixelFormatToStr(image.pixel_format)},
+        {"access", GetAccessQualifierStr(image.access_qualifier)}
+      }));
+    }
+    return arr;
+  }
   json SerializeUniforms(const std::vector<ls::ShaderDesc::Uniform> uniforms)
   {
     auto arr = json::array();
@@ -53,6 +93,26 @@ namespace ls
       {"text", body.text}
     });
   }
+  std::string GetPassTypeStr(ls::PassTypes pass_type)
+  {
+    switch(pass_type)
+    {
+      case ls::PassTypes::fullscreen: return "fullscreen"; break;
+      case ls::PassTypes::compute: return "compute"; break;
+      case ls::PassTypes::instanced: return "instanced"; break;
+    }
+    assert(0);
+    return "<unknown>";
+  }
+  json SerializeInstanceAttributes(const std::vector<ls::ShaderDesc::InstanceAttribute> &attributes)
+  {
+    auto arr = json::array();
+    for(const auto &attribute : attributes)
+    {
+      arr.push_back(json::object({{"type", attribute.type}, {"name", attribute.name}, {"offset", attribute.offset}}));
+    }
+    return arr;
+  }
   json SerializeShaderDescs(const ls::ShaderDescs &descs)
   {
     auto arr = json::array();
@@ -65,7 +125,17 @@ namespace ls
       json_desc["includes"] = desc.includes;
       json_desc["samplers"] = SerializeSamplers(desc.samplers);
       json_desc["uniforms"] = SerializeUniforms(desc.uniforms);
+      json_desc["images"] = SerializeImages(desc.images);
       json_desc["outs"] = SerializeInouts(desc.outs);
+      json_desc["pass_type"] = GetPassTypeStr(desc.pass_type);
+      if(desc.pass_type == ls::PassTypes::compute)
+        json_desc["workgroup_size"] = json::object({{"x", desc.workgroup_size.x}, {"y", desc.workgroup_size.y}, {"z", desc.workgroup_size.z}});
+      if(desc.pass_type == ls::PassTypes::instanced)
+      {
+        json_desc["vertices_per_instance"] = desc.vertices_per_instance;
+        json_desc["instance_attributes"] = SerializeInstanceAttributes(desc.instance_attributes);
+        json_desc["instance_stride"] = desc.instance_stride;
+      }
       arr.push_back(json_desc);
     }
 
@@ -106,15 +176,22 @@ namespace ls
     if(!instance)
     {
       instance.reset(new ls::LegitScript());
+      instance->SetOptions(script_options);
     }
     assert(instance);
+    memoized_json.reset();
     json res_obj;
     try
     {
       script_contents = instance->LoadScript(script_source);
+      LS_TRACE_SCOPE("SerializeShaderDescs");
       res_obj = json::object({
         {"shader_descs", SerializeShaderDescs(script_contents.shader_descs)},
-        {"declarations", SerializeDeclarations(script_contents.declarations)}
+        {"declarations", SerializeDeclarations(script_contents.declarations)},
+        {"is_static_render_graph", script_contents.is_static_render_graph},
+        {"jit_compiled_functions_count", script_contents.jit_compiled_functions_count},
+        {"byte_code_rewrites_count", script_contents.byte_code_rewrites_count},
+        {"is_aot_render_graph", script_contents.is_aot_render_graph}
         });
     }
     catch(const ls::ScriptException &e)
@@ -125,19 +202,10 @@ namespace ls
     {
       res_obj = SerializeGenericException(e.what());
     }
+    LS_TRACE_SCOPE("DumpJson");
     return res_obj.dump(2);
   }
   
-  std::string PixelFormatToStr(ls::PixelFormats format)
-  {
-    switch(format)
-    {
-      case ls::PixelFormats::rgba8: return "rgba8"; break;
-      case ls::PixelFormats::rgba16f: return "rgba16f"; break;
-      case ls::PixelFormats::rgba32f: return "rgba32f"; break;
-    }
-    assert(0);
-  }
   json SerializeVec2(vec2 val)
   {
     return json::object({{"x", val.x}, {"y", val.y}});
@@ -226,6 +294,48 @@ namespace ls
     }
     return arr;
   }
+  json SerializeStorageImageBindings(const std::vector<ls::ShaderInvocation::StorageImageBinding> &storage_bindings)
+  {
+    auto arr = json::array();
+    for(const auto &binding : storage_bindings)
+    {
+      arr.push_back(json::object({
+        {"id", binding.image.id},
+        {"mip", binding.image.mip_range.x},
+        {"access", GetAccessQualifierStr(binding.access_qualifier)}
+      }));
+    }
+    return arr;
+  }
+  json SerializeAttachmentOps(const std::vector<ls::AttachmentOps> &attachment_ops)
+  {
+    auto arr = json::array();
+    for(const auto &ops : attachment_ops)
+    {
+      arr.push_back(json::object({
+        {"load_op", ops.load_op == ls::LoadOps::load ? "load" : "dont_care"},
+        {"store_op", ops.store_op == ls::StoreOps::store ? "store" : "dont_care"}
+      }));
+    }
+    return arr;
+  }
+  json SerializeInstances(const ls::ShaderInvocation &inv, const ls::ShaderDesc &shader_desc)
+  {
+    auto arr = json::array();
+    for(size_t instance_idx = 0; instance_idx < inv.instances_count && shader_desc.instance_stride > 0; instance_idx++)
+    {
+      auto json_instance = json::object();
+      auto *instance_ptr = inv.instance_data.data() + instance_idx * shader_desc.instance_stride;
+      for(size_t attribute_idx = 0; attribute_idx < shader_desc.instance_attributes.size(); attribute_idx++)
+      {
+        const auto &attribute = shader_desc.instance_attributes[attribute_idx];
+        size_t next_offset = attribute_idx + 1 < shader_desc.instance_attributes.size() ? shader_desc.instance_attributes[attribute_idx + 1].offset : shader_desc.instance_stride;
+        json_instance[attribute.name] = SerializeUniformVal((void*)(instance_ptr + attribute.offset), next_offset - attribute.offset, attribute.type);
+      }
+      arr.push_back(json_instance);
+    }
+    return arr;
+  }
   json SerializeShaderInvocations(const std::vector<ls::ShaderInvocation> &shader_invocations, const ls::ShaderDescs &shader_descs)
   {
     auto arr = json::array();
@@ -245,12 +355,20 @@ namespace ls
       {
         std::runtime_error("Can't find invoked shader" + inv.shader_name);
       }
-      arr.push_back(json::object({
+      auto json_inv = json::object({
         {"shader_name", inv.shader_name},
         {"color_attachments", SerializeImageArray(inv.color_attachments)},
         {"image_sampler_bindings", SerializeImageArray(inv.image_sampler_bindings)},
+        {"storage_image_bindings", SerializeStorageImageBindings(inv.storage_image_bindings)},
         {"uniforms", SerializeUniforms(inv.uniform_data, inv.uniform_values, matching_shader_desc.uniforms)}
-      }));
+      });
+      if(!inv.color_attachment_ops.empty())
+        json_inv["color_attachment_ops"] = SerializeAttachmentOps(inv.color_attachment_ops);
+      if(inv.groups_count)
+        json_inv["groups_count"] = SerializeUVec3(inv.groups_count.value());
+      if(matching_shader_desc.pass_type == ls::PassTypes::instanced)
+        json_inv["instances"] = SerializeInstances(inv, matching_shader_desc);
+      arr.push_back(json_inv);
     }
     return arr;
   }
@@ -277,12 +395,35 @@ namespace ls
   }
   json SerializeRequest(ls::CachedImageRequest req)
   {
-    return json::object({
+    auto res = json::object({
       {"type", "CachedImageRequest"},
       {"size", SerializeUVec2(req.size)},
       {"pixel_format", PixelFormatToStr(req.pixel_format)},
+      {"mips_count", req.mips_count},
       {"id", req.id}
     });
+    if(req.usage)
+    {
+      res["usage"] = json::object({
+        {"is_sampled", req.usage->is_sampled},
+        {"is_render_target", req.usage->is_render_target},
+        {"is_mip_sampled", req.usage->is_mip_sampled},
+        {"is_storage", req.usage->is_storage}
+      });
+    }
+    return res;
+  }
+  json SerializeRequest(ls::PersistentImageRequest req)
+  {
+    return json::object({
+      {"type", "PersistentImageRequest"},
+      {"name", req.name},
+      {"size", SerializeUVec2(req.size)},
+      {"pixel_format", PixelFormatToStr(req.pixel_format)},
+      {"id", req.id},
+      {"is_history", req.is_history},
+      {"version", req.version}
+    });
   }
   json SerializeRequest(ls::ColorRequest req)
   {
@@ -302,12 +443,241 @@ namespace ls
     }
     return arr;
   }
-  json SerializeScriptEvents(const ls::ScriptEvents &script_events, const ls::ShaderDescs &shader_descs)
+  json SerializeImageInvalidations(const std::vector<ls::ImageInvalidation> &image_invalidations)
   {
+    auto arr = json::array();
+    for(const auto &invalidation : image_invalidations)
+    {
+      arr.push_back(json::object({
+        {"id", invalidation.id},
+        {"prev_size", SerializeUVec2(invalidation.prev_size)},
+        {"prev_pixel_format", PixelFormatToStr(invalidation.prev_pixel_format)}
+      }));
+    }
+    return arr;
+  }
+  json SerializeVmCounts(const std::vector<ls::ScriptStats::VmCount> &counts)
+  {
+    auto arr = json::array();
+    for(const auto &count : counts)
+    {
+      arr.push_back(json::object({{"name", count.name}, {"count", count.count}}));
+    }
+    return arr;
+  }
+  json SerializeStats(const ls::ScriptStats &stats)
+  {
+    return json::object({
+      {"total_time_ms", stats.total_time_ms},
+      {"vm_time_ms", stats.vm_time_ms},
+      {"binding_time_ms", stats.binding_time_ms},
+      {"binding_calls_count", stats.binding_calls_count},
+      {"pass_invocations_count", stats.pass_invocations_count},
+      {"context_requests_count", json::object({
+        {"FloatRequest", stats.float_requests_count},
+        {"IntRequest", stats.int_requests_count},
+        {"ColorRequest", stats.color_requests_count},
+        {"BoolRequest", stats.bool_requests_count},
+        {"TextRequest", stats.text_requests_count},
+        {"LoadedImageRequest", stats.loaded_image_requests_count},
+        {"CachedImageRequest", stats.cached_image_requests_count},
+        {"PersistentImageRequest", stats.persistent_image_requests_count}
+      })},
+      {"uniform_bytes_count", stats.uniform_bytes_count},
+      {"script_allocations_count", stats.script_allocations_count},
+      {"script_allocated_bytes", stats.script_allocated_bytes},
+      {"arena_allocations_count", stats.arena_allocations_count},
+      {"arena_allocated_bytes", stats.arena_allocated_bytes},
+      {"arena_pinned_bytes", stats.arena_pinned_bytes},
+      {"gc_time_ms", stats.gc_time_ms},
+      {"gc_steps_count", stats.gc_steps_count},
+      {"is_gc_full_cycle", stats.is_gc_full_cycle},
+      {"gc_destroyed_objects_count", stats.gc_destroyed_objects_count},
+      {"gc_objects_count", stats.gc_objects_count},
+      {"opcode_counts", SerializeVmCounts(stats.opcode_counts)},
+      {"registered_call_counts", SerializeVmCounts(stats.registered_call_counts)},
+      {"script_call_counts", SerializeVmCounts(stats.script_call_counts)}
+    });
+  }
+  json SerializeProfile(const ls::ScriptProfile &profile)
+  {
+    auto lines = json::array();
+    for(const auto &line : profile.lines)
+    {
+      lines.push_back(json::object({{"line", line.line}, {"hits_count", line.hits_count}, {"time_ms", line.time_ms}}));
+    }
+    auto functions = json::array();
+    for(const auto &func : profile.functions)
+    {
+      functions.push_back(json::object({{"decl", func.decl}, {"entries_count", func.entries_count}}));
+    }
+    return json::object({{"lines", lines}, {"functions", functions}});
+  }
+  json SerializeAliasingPlan(const ls::ImageAliasingPlan &aliasing_plan)
+  {
+    auto image_lifetimes = json::array();
+    for(const auto &lifetime : aliasing_plan.image_lifetimes)
+    {
+      image_lifetimes.push_back(json::object({
+        {"id", lifetime.id},
+        {"first_invocation", lifetime.first_invocation},
+        {"last_invocation", lifetime.last_invocation},
+        {"size_bytes", lifetime.size_bytes},
+        {"slot_idx", lifetime.slot_idx}
+      }));
+    }
+    auto slots = json::array();
+    for(const auto &slot : aliasing_plan.slots)
+    {
+      slots.push_back(json::object({{"size_bytes", slot.size_bytes}, {"image_ids", slot.image_ids}}));
+    }
+    return json::object({
+      {"image_lifetimes", image_lifetimes},
+      {"slots", slots},
+      {"unaliased_bytes", aliasing_plan.unaliased_bytes},
+      {"aliased_bytes", aliasing_plan.aliased_bytes}
+    });
+  }
+  std::string HazardTypeToStr(ls::HazardTypes hazard_type)
+  {
+    switch(hazard_type)
+    {
+      case ls::HazardTypes::read_after_write: return "read_after_write"; break;
+      case ls::HazardTypes::write_after_read: return "write_after_read"; break;
+      case ls::HazardTypes::write_after_write: return "write_after_write"; break;
+    }
+    return "<unknown>";
+  }
+  json SerializeDependencyGraph(const ls::FrameDependencyGraph &dependency_graph)
+  {
+    auto barriers = json::array();
+    for(const auto &barrier : dependency_graph.barriers)
+    {
+      barriers.push_back(json::object({
+        {"src_invocation", barrier.src_invocation},
+        {"dst_invocation", barrier.dst_invocation},
+        {"image_id", barrier.image_id},
+        {"mip", barrier.mip},
+        {"hazard_type", HazardTypeToStr(barrier.hazard_type)}
+      }));
+    }
+    return json::object({
+      {"dependencies", dependency_graph.dependencies},
+      {"barriers", barriers},
+      {"levels", dependency_graph.levels},
+      {"critical_path_length", dependency_graph.critical_path_length}
+    });
+  }
+  json SerializeCullingReport(const ls::CullingReport &culling)
+  {
+    return json::object({
+      {"removed_invocations", culling.removed_invocations},
+      {"removed_image_ids", culling.removed_image_ids}
+    });
+  }
+  json SerializeRenderPassSchedule(const ls::RenderPassSchedule &schedule)
+  {
+    auto render_passes = json::array();
+    for(const auto &render_pass : schedule.render_passes)
+    {
+      render_passes.push_back(json::object({{"first_invocation", render_pass.first_invocation}, {"invocations_count", render_pass.invocations_count}}));
+    }
     return json::object({
+      {"original_indices", schedule.original_indices},
+      {"render_passes", render_passes},
+      {"unscheduled_render_passes_count", schedule.unscheduled_render_passes_count}
+    });
+  }
+  json SerializeInvocationReuse(const ls::InvocationReuseReport &invocation_reuse)
+  {
+    auto image_content_versions = json::array();
+    for(const auto &content_version : invocation_reuse.image_content_versions)
+    {
+      image_content_versions.push_back(json::object({{"id", content_version.id}, {"version", content_version.version}}));
+    }
+    return json::object({
+      {"image_content_versions", image_content_versions},
+      {"reusable_invocations_count", invocation_reuse.reusable_invocations_count}
+    });
+  }
+  json SerializeInvocationBatches(const std::vector<ls::InvocationBatch> &batches)
+  {
+    auto arr = json::array();
+    for(const auto &batch : batches)
+    {
+      auto color_attachments = json::array();
+      auto image_sampler_bindings = json::array();
+      auto storage_image_bindings = json::array();
+      for(size_t item_idx = 0; item_idx < batch.invocations_count; item_idx++)
+      {
+        color_attachments.push_back(SerializeImageArray(batch.color_attachments[item_idx]));
+        image_sampler_bindings.push_back(SerializeImageArray(batch.image_sampler_bindings[item_idx]));
+        storage_image_bindings.push_back(SerializeStorageImageBindings(batch.storage_image_bindings[item_idx]));
+      }
+      //packed uniforms go out as raw bytes, ready for a single upload
+      auto json_batch = json::object({
+        {"shader_name", batch.shader_name},
+        {"first_invocation", batch.first_invocation},
+        {"invocations_count", batch.invocations_count},
+        {"uniform_stride", batch.uniform_stride},
+        {"uniform_data", batch.uniform_data},
+        {"color_attachments", color_attachments},
+        {"image_sampler_bindings", image_sampler_bindings},
+        {"storage_image_bindings", storage_image_bindings}
+      });
+      if(!batch.groups_counts.empty())
+      {
+        auto groups_counts = json::array();
+        for(const auto &groups_count : batch.groups_counts)
+          groups_counts.push_back(SerializeUVec3(groups_count));
+        json_batch["groups_counts"] = groups_counts;
+      }
+      if(!batch.instances_counts.empty())
+      {
+        json_batch["instances_counts"] = batch.instances_counts;
+        json_batch["instance_data"] = batch.instance_data;
+      }
+      arr.push_back(json_batch);
+    }
+    return arr;
+  }
+  json SerializeScriptEvents(const ls::ScriptEvents &script_events, const ls::ShaderDescs &shader_descs)
+  {
+    auto res = json::object({
       {"context_requests", SerializeContextRequests(script_events.context_requests)},
-      {"shader_invocations", SerializeShaderInvocations(script_events.script_shader_invocations, shader_descs)}
+      {"shader_invocations", SerializeShaderInvocations(script_events.script_shader_invocations, shader_descs)},
+      {"image_invalidations", SerializeImageInvalidations(script_events.image_invalidations)},
+      {"released_image_ids", script_events.released_image_ids},
+      {"external_output_ids", script_events.external_output_ids},
+      {"is_memoized", script_events.is_memoized}
     });
+    if(script_events.stats)
+      res["stats"] = SerializeStats(script_events.stats.value());
+    if(script_events.profile)
+      res["profile"] = SerializeProfile(script_events.profile.value());
+    if(script_events.aliasing_plan)
+      res["aliasing_plan"] = SerializeAliasingPlan(script_events.aliasing_plan.value());
+    if(script_events.culling)
+      res["culling"] = SerializeCullingReport(script_events.culling.value());
+    if(script_events.invocation_reuse)
+    {
+      auto &json_invocations = res["shader_invocations"];
+      for(size_t invocation_idx = 0; invocation_idx < script_events.script_shader_invocations.size(); invocation_idx++)
+      {
+        const auto &invocation = script_events.script_shader_invocations[invocation_idx];
+        //a decimal string, JS numbers only hold 53 bits
+        json_invocations[invocation_idx]["inputs_hash"] = std::to_string(invocation.inputs_hash);
+        json_invocations[invocation_idx]["is_reusable"] = invocation.is_reusable;
+      }
+      res["invocation_reuse"] = SerializeInvocationReuse(script_events.invocation_reuse.value());
+    }
+    if(script_events.render_pass_schedule)
+      res["render_pass_schedule"] = SerializeRenderPassSchedule(script_events.render_pass_schedule.value());
+    if(script_events.dependency_graph)
+      res["dependency_graph"] = SerializeDependencyGraph(script_events.dependency_graph.value());
+    if(script_events.invocation_batches)
+      res["invocation_batches"] = SerializeInvocationBatches(script_events.invocation_batches.value());
+    return res;
   }
 
   ls::ContextInput ParseContextInput(json json_input)
@@ -351,7 +721,19 @@ namespace ls
     {
       auto context_inputs = ParseContextInputs(context_inputs_json);
       auto script_events = instance->RunScript(context_inputs);
+      //stats and reuse flags differ between memoized frames, so their json can't be repeated
+      bool is_json_repeatable = script_events.is_memoized && script_events.image_invalidations.empty() && !script_options.collect_stats && !script_options.track_invocation_reuse;
+      if(is_json_repeatable && memoized_json && memoized_json->first == script_events.executed_frame_idx)
+        return memoized_json->second;
+      memoized_json.reset();
+      LS_TRACE_SCOPE("SerializeScriptEvents");
       res_obj = SerializeScriptEvents(script_events, script_contents.shader_descs);
+      if(is_json_repeatable)
+      {
+        LS_TRACE_SCOPE("DumpJson");
+        memoized_json = {script_events.executed_frame_idx, res_obj.dump(2)};
+        return memoized_json->second;
+      }
     }
     catch(const ls::ScriptException &e)
     {
@@ -361,6 +743,50 @@ namespace ls
     {
       res_obj = SerializeGenericException(e.what());
     }
+    LS_TRACE_SCOPE("DumpJson");
+    return res_obj.dump(2);
+  }
+
+  ls::ScriptOptions ParseScriptOptions(json json_options, ls::ScriptOptions options)
+  {
+    if(json_options.contains("collect_stats")) options.collect_stats = bool(json_options["collect_stats"]);
+    if(json_options.contains("profile_lines")) options.profile_lines = bool(json_options["profile_lines"]);
+    if(json_options.contains("build_aliasing_plan")) options.build_aliasing_plan = bool(json_options["build_aliasing_plan"]);
+    if(json_options.contains("build_dependency_graph")) options.build_dependency_graph = bool(json_options["build_dependency_graph"]);
+    if(json_options.contains("cull_unused")) options.cull_unused = bool(json_options["cull_unused"]);
+    if(json_options.contains("schedule_render_passes")) options.schedule_render_passes = bool(json_options["schedule_render_passes"]);
+    if(json_options.contains("infer_attachment_ops")) options.infer_attachment_ops = bool(json_options["infer_attachment_ops"]);
+    if(json_options.contains("track_invocation_reuse")) options.track_invocation_reuse = bool(json_options["track_invocation_reuse"]);
+    if(json_options.contains("memoize_frames")) options.memoize_frames = bool(json_options["memoize_frames"]);
+    if(json_options.contains("cache_frames_by_inputs")) options.cache_frames_by_inputs = bool(json_options["cache_frames_by_inputs"]);
+    if(json_options.contains("batch_invocations")) options.batch_invocations = bool(json_options["batch_invocations"]);
+    if(json_options.contains("jit_compile")) options.jit_compile = bool(json_options["jit_compile"]);
+    if(json_options.contains("optimize_byte_code")) options.optimize_byte_code = bool(json_options["optimize_byte_code"]);
+    if(json_options.contains("load_aot_render_graphs")) options.load_aot_render_graphs = bool(json_options["load_aot_render_graphs"]);
+    if(json_options.contains("gc_time_budget_ms")) options.gc_time_budget_ms = double(json_options["gc_time_budget_ms"]);
+    if(json_options.contains("gc_full_cycle_objects_count")) options.gc_full_cycle_objects_count = size_t(json_options["gc_full_cycle_objects_count"]);
+    if(json_options.contains("use_frame_arena")) options.use_frame_arena = bool(json_options["use_frame_arena"]);
+    if(json_options.contains("share_script_engine")) options.share_script_engine = bool(json_options["share_script_engine"]);
+    return options;
+  }
+
+  std::string SetOptions(const std::string &options_json)
+  {
+    json res_obj = json::object();
+    try
+    {
+      auto json_options = json::parse(options_json);
+      script_options = ParseScriptOptions(json_options, script_options);
+      memoized_json.reset();
+      if(json_options.contains("tracing"))
+        ls::SetTracingEnabled(bool(json_options["tracing"]));
+      if(instance)
+        instance->SetOptions(script_options);
+    }
+    catch(const std::exception &e)
+    {
+      res_obj = SerializeGenericException(e.what());
+    }
     return res_obj.dump(2);
   }
 }
\ No newline at end of file
@@ -1,9 +1,22 @@
 #include <map>
+#include <array>
 #include "RenderGraphScript.h"
 #include <stdexcept>
 #include <algorithm>
 #include "AngelscriptWrapper/angelscript-cpp.h"
+#include "ScriptMemory.h"
+#include "ScriptProfiler.h"
+#include "Tracing.h"
+#include "FrameGraph.h"
+#include "ScriptAnalysis.h"
+#include "ScriptJit.h"
+#include "ScriptAot.h"
+#include "ScriptOptimizer.h"
+#include "VmStats.h"
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <mutex>
 #include <assert.h>
 
 namespace ls
@@ -26,6 +39,17 @@ std::string ArgTypeToAsTypeSpecific(ls::SamplerTypes sampler_type)
     return "Image";
 }
 
+std::string PixelFormatToString(ls::PixelFormats pixel_format)
+{
+  switch(pixel_format)
+  {
+    case ls::PixelFormats::rgba8: return "rgba8"; break;
+    case ls::PixelFormats::rgba16f: return "rgba16f"; break;
+    case ls::PixelFormats::rgba32f: return "rgba32f"; break;
+  }
+  return "<unknown>";
+}
+
 std::string ArgTypeToAsType(ls::ArgDesc::ArgType arg_type)
 {
   return std::visit([](auto arg){
@@ -34,7 +58,7 @@ std::string ArgTypeToAsType(ls::ArgDesc::ArgType arg_type)
 }
 
 
-std::string CreateAsPassFuncDeclaration(const ls::PassDecl &decl)
+std::string CreateAsPassFuncDeclaration(const ls::PassDecl &decl, std::string extra_args)
 {
   std::string as_func_decl;
   as_func_decl += PodTypeToString(decl.return_type) + " ";
@@ -49,10 +73,49 @@ std::string CreateAsPassFuncDeclaration(const ls::PassDecl &decl)
     as_func_decl += arg_desc.name;
     is_first_arg = false;
   }
+  if(!extra_args.empty())
+    as_func_decl += std::string(is_first_arg ? "" : ", ") + extra_args;
   as_func_decl += ")";
   return as_func_decl;
 }
-const Image::Id swapchain_img_id = 0;
+
+std::string ArgTypeToSignatureSpecific(ls::DecoratedPodType dec_pod_type)
+{
+  return "pod " + std::to_string(int(dec_pod_type.type)) + " " + std::to_string(int(dec_pod_type.access_qalifier.value_or(ls::DecoratedPodType::AccessQualifiers::in)));
+}
+std::string ArgTypeToSignatureSpecific(ls::DecoratedImageType dec_img_type)
+{
+  return "image " + std::to_string(int(dec_img_type.image_type)) + " " + std::to_string(int(dec_img_type.pixel_format)) + " " +
+    (dec_img_type.access_qualifiers ? std::to_string(int(dec_img_type.access_qualifiers.value())) : std::string("-"));
+}
+std::string ArgTypeToSignatureSpecific(ls::SamplerTypes sampler_type)
+{
+  return "sampler " + std::to_string(int(sampler_type));
+}
+
+//everything the pass function bindings capture from their declarations, equal signatures can share the same registrations
+std::string GetPassDeclsSignature(const std::vector<ls::PassDecl> &pass_decls)
+{
+  std::string signature;
+  for(const auto &pass_decl : pass_decls)
+  {
+    signature += std::to_string(int(pass_decl.type)) + " " + CreateAsPassFuncDeclaration(pass_decl, "");
+    for(const auto &arg_desc : pass_decl.arg_descs)
+    {
+      signature += ", " + std::visit([](auto arg){
+        return ArgTypeToSignatureSpecific(arg);
+      }, arg_desc.type);
+    }
+    const auto &numthreads = pass_decl.numthreads;
+    signature += " numthreads " + std::to_string(numthreads.x) + " " + std::to_string(numthreads.y) + " " + std::to_string(numthreads.z);
+    const auto &instanced = pass_decl.instanced;
+    signature += " instanced " + std::to_string(instanced.vertices_count) + " " + std::to_string(instanced.stride);
+    for(const auto &attribute : instanced.attributes)
+      signature += ", " + std::to_string(int(attribute.type)) + " " + attribute.name + " " + std::to_string(attribute.offset);
+    signature += "\n";
+  }
+  return signature;
+}
 
 void AddScriptInvocationAsArgSpecific(ShaderInvocation &invocation, asIScriptGeneric *gen, size_t param_idx, ls::DecoratedPodType dec_pod_type)
 {
@@ -96,7 +159,12 @@ void AddScriptInvocationAsArgSpecific(ShaderInvocation &invocation, asIScriptGen
 
 void AddScriptInvocationAsArgSpecific(ShaderInvocation &invocation, asIScriptGeneric *gen, size_t param_idx, ls::DecoratedImageType dec_img_type)
 {
-  throw std::runtime_error("Images are not supported yet");
+  auto script_img = *(ls::Image*)gen->GetArgObject(param_idx);
+  if(script_img.mip_range.y - script_img.mip_range.x != 1)
+  {
+    throw ls::RenderGraphRuntimeException(0, "", "Can't bind storage image with more than 1 mip");
+  }
+  invocation.storage_image_bindings.push_back({script_img, dec_img_type.access_qualifiers.value_or(ls::AccessQualifiers::readwrite)});
 }
 
 void AddScriptInvocationAsArg(ShaderInvocation &invocation, asIScriptGeneric *gen, size_t param_idx, ls::ArgDesc arg_desc)
@@ -198,17 +266,56 @@ LoadedImage &ScriptContext::GetContextRef<ls::LoadedImage>(std::string name)
 struct RenderGraphScript::Impl
 {
   Impl();
+  ~Impl();
   void LoadScript(std::string script_src, const std::vector<ls::PassDecl> &pass_decls);
   ScriptEvents RunScript(const std::vector<ContextInput> &context_inputs);
+  void SetOptions(const ls::ScriptOptions &options);
+  bool IsStaticGraph() const;
+  size_t GetJitCompiledFunctionsCount() const;
+  size_t GetByteCodeRewritesCount() const;
+  bool IsAotModule() const;
+  std::string GenerateAotSource();
 private:
+  asIScriptModule *LoadAotModule(const std::string &script_src, const std::vector<ls::PassDecl> &pass_decls);
+  asIScriptModule *LoadSharedModule(const std::string &script_src, const std::vector<ls::PassDecl> &pass_decls);
+  void AcquireSharedEngine();
+  void DiscardSharedModule();
+  void ReleaseSharedNamespace();
+  void OnScriptMessage(const asSMessageInfo *msg);
+  void ThrowDeferredBuildError();
+  Impl *GetBoundImpl();
+  static Impl *GetCallingImpl(Impl *bound_impl);
   void SetContextInputs(const std::vector<ContextInput> &context_inputs);
+  template<typename T>
+  T &ObserveContextRef(const std::string &name);
+  using ObservedInputs = std::map<std::pair<size_t, std::string>, ContextValueType>;
+  bool IsObservedInputsUnchanged(const ObservedInputs &inputs);
+  bool IsFrameCacheable();
+  bool IsFrameMemoizable();
+  ScriptEvents RepeatEvents(const ScriptEvents &src_events, std::chrono::steady_clock::time_point frame_start_time);
+  std::set<int> GetInputFuncIds();
   void RecreateAsScriptEngine(const std::vector<ls::PassDecl> &pass_decls);
   void RegisterAsScriptPassFunctions(const std::vector<ls::PassDecl> &pass_decls);
+  void RegisterAsScriptInstancedPassFunction(const ls::PassDecl &pass_decl);
   void RegisterAsScriptGlobals();
   void RegisterImageType();
+  ls::Image RequestCachedImage(uvec2 size, ls::PixelFormats pixel_format, bool is_mipped);
+  uvec3 GetDispatchGroupsCount(const ShaderInvocation &invocation, const ls::PassDecl &pass_decl);
+  void ValidateStorageImageFormats(const ShaderInvocation &invocation, const ls::PassDecl &pass_decl);
+  Image::Id GetStableImageId();
+  Image::Id AllocateImageId();
+  struct PersistentImage;
+  PersistentImage &UsePersistentImage(const std::string &name, const std::string &func_name);
+  ls::Image RequestPersistentImageCopy(const std::string &name, PersistentImage &persistent_image, size_t copy_idx, bool is_history);
+  void UpdatePersistentImageVersions();
+  void ReportImageInvalidations();
+  void ReleaseUnusedImageIds();
   template<typename VecType, size_t CompCount>
   void RegisterVecType(std::string type_name, std::string uppercase_type_name, std::string comp_type_name);
   void RegisterBasicTypeOperations();
+  void RegisterProfileScopes();
+  void CloseScriptTraceScopes();
+  void CollectGarbage(ScriptStats &stats);
 
 
   struct ImageInfo
@@ -227,11 +334,103 @@ private:
       return uvec2{size.x >> mip_level, size.y >> mip_level};
     }
   };
+  //indexed by image id. ids stay valid across frames, 0 is always the swapchain
   std::vector<ImageInfo> image_infos;
-  std::unique_ptr<as::ScriptEngine> as_script_engine;
+  //cached images are identified by the script callstack that requested them (function, line and column on every level)
+  //and by how many times that callstack already requested an image during the frame
+  using ScriptCallStack = std::vector<std::tuple<asIScriptFunction*, int, int>>;
+  struct StableImageId
+  {
+    Image::Id id;
+    size_t last_requested_frame;
+  };
+  std::map<std::pair<ScriptCallStack, size_t>, StableImageId> image_ids;
+  //ids of released cached images, they are allocated again before image_infos grows
+  std::vector<Image::Id> free_image_ids;
+  //lives within a frame, so it's allocated from the frame arena
+  using FrameCallStack = std::vector<std::tuple<asIScriptFunction*, int, int>, FrameAllocator<std::tuple<asIScriptFunction*, int, int>>>;
+  std::map<FrameCallStack, size_t, std::less<FrameCallStack>, FrameAllocator<std::pair<const FrameCallStack, size_t>>> frame_call_site_counts;
+  //last size and format reported for every image id, used to detect invalidations
+  std::map<Image::Id, ImageInfo> allocated_image_infos;
+  struct PersistentImage
+  {
+    ImageInfo info;
+    //ping-pong images use both copies, the current one is written this frame and the other one holds the history
+    std::array<Image::Id, 2> ids = {0, 0};
+    //frame whose invocations last wrote each copy, 0 when it wasn't written since it was allocated
+    std::array<size_t, 2> versions = {0, 0};
+    std::array<size_t, 2> requested_frames = {0, 0};
+    size_t current_copy = 0;
+    bool is_ping_pong = false;
+    size_t last_used_frame = 0;
+  };
+  std::map<std::string, PersistentImage> persistent_images;
+  //starts from 1, so that 0 can mean "never"
+  size_t frame_idx = 0;
+  //declared before the engine so that it outlives the native code of the engine's functions
+  std::unique_ptr<ScriptJit> script_jit;
+  std::unique_ptr<AotFunctionLinker> aot_linker;
+  std::unique_ptr<ScriptOptimizer> script_optimizer;
+  std::map<int, ScriptOptimizer::VectorConstructor> vector_constructors;
+  //points into shared_engine when the instance shares it
+  std::shared_ptr<as::ScriptEngine> as_script_engine;
+  //an engine with everything but the pass functions registered, used by every instance with share_script_engine on
+  struct SharedEngine
+  {
+    std::unique_ptr<as::ScriptEngine> as_script_engine;
+    //the instance whose module is being built, build messages are reported to it
+    Impl *loading_impl = nullptr;
+    //functions can't be unregistered, so every load registers its pass functions in a namespace of its own
+    size_t namespaces_count = 0;
+    //namespaces left behind by instances that were destroyed or reloaded with other pass declarations.
+    //once there are too many, new instances get a fresh engine and this one goes away with its last instance
+    size_t dead_namespaces_count = 0;
+    static const size_t max_dead_namespaces_count = 64;
+  };
+  std::shared_ptr<SharedEngine> shared_engine;
+  //the module of the instance in the shared engine is named after the namespace of its pass functions
+  std::string shared_module_name;
+  //the pass functions capture the instance, so they stay registered in this namespace for reloads with the same pass declarations
+  std::string shared_namespace_name;
+  std::string shared_pass_decls_signature;
+  //the source is wrapped in that namespace on its first line, which shifts the columns of that line
+  size_t shared_source_prefix_size = 0;
+  //a shared engine can't be left in the middle of a build, so the first build error is thrown once the build returns
+  std::optional<RenderGraphBuildException> deferred_build_error;
   std::optional<asIScriptFunction*> as_script_func;
   ScriptContext script_context;
   ScriptEvents script_events;
+  ls::ScriptOptions options;
+  ScriptLineProfiler line_profiler;
+  //ProfileBegin() scopes that are still open, the timestamp is empty when tracing was off when the scope began
+  struct ScriptTraceScope
+  {
+    std::string name;
+    std::optional<double> begin_timestamp_us;
+  };
+  std::vector<ScriptTraceScope> script_trace_scopes;
+  //context values read by the last run (keyed on value type and name) with the values they had when first read
+  ObservedInputs observed_inputs;
+  //events of the last run, kept when it depended on nothing but the observed inputs
+  std::optional<ScriptEvents> memoized_events;
+  //global variables of the module keep their values between runs, so such scripts are never memoized
+  bool has_global_variables = false;
+  //the render graph can't reach any function reading context values, its events only depend on the swapchain size
+  bool is_static_graph = false;
+  //events of memoizable runs with the inputs they observed, served again whenever all those inputs have the same values.
+  //ordered from the least to the most recently used
+  struct CachedFrame
+  {
+    ObservedInputs observed_inputs;
+    ScriptEvents events;
+  };
+  std::vector<CachedFrame> cached_frames;
+  //what the module was last loaded from, kept for GenerateAotSource()
+  std::string loaded_source;
+  std::vector<ls::PassDecl> loaded_pass_decls;
+  bool is_aot_module = false;
+  //byte code loading can't be interrupted by an exception, its errors are reported through the return value instead
+  bool is_loading_byte_code = false;
 };
 
 void RenderGraphScript::LoadScript(std::string script_src, const std::vector<ls::PassDecl> &pass_decls)
@@ -242,6 +441,31 @@ ScriptEvents RenderGraphScript::RunScript(const std::vector<ContextInput> &conte
 {
   return impl->RunScript(context_inputs);
 }
+void RenderGraphScript::SetOptions(const ls::ScriptOptions &options)
+{
+  impl->SetOptions(options);
+}
+bool RenderGraphScript::IsStaticGraph() const
+{
+  return impl->IsStaticGraph();
+}
+size_t RenderGraphScript::GetJitCompiledFunctionsCount() const
+{
+  return impl->GetJitCompiledFunctionsCount();
+}
+
+size_t RenderGraphScript::GetByteCodeRewritesCount() const
+{
+  return impl->GetByteCodeRewritesCount();
+}
+bool RenderGraphScript::IsAotModule() const
+{
+  return impl->IsAotModule();
+}
+std::string RenderGraphScript::GenerateAotSource()
+{
+  return impl->GenerateAotSource();
+}
 RenderGraphScript::RenderGraphScript()
 {
   this->impl.reset(new RenderGraphScript::Impl());
@@ -252,14 +476,309 @@ RenderGraphScript::~RenderGraphScript()
 
 RenderGraphScript::Impl::Impl()
 {
+  InstallScriptMemoryFunctions();
+  image_infos.assign(1, ImageInfo());
+}
+
+RenderGraphScript::Impl::~Impl()
+{
+  DiscardSharedModule();
+  ReleaseSharedNamespace();
+}
+
+void RenderGraphScript::Impl::SetOptions(const ls::ScriptOptions &options)
+{
+  this->options = options;
 }
 
 void RenderGraphScript::Impl::LoadScript(std::string script_src, const std::vector<ls::PassDecl> &pass_decls)
 {
   this->as_script_func.reset();
-  RecreateAsScriptEngine(pass_decls);
-  auto mod = as_script_engine->LoadScript(script_src);
+  //image ids are keyed on script functions, they can't be matched after a reload
+  this->image_infos.assign(1, ImageInfo());
+  this->image_ids.clear();
+  this->free_image_ids.clear();
+  this->allocated_image_infos.clear();
+  this->persistent_images.clear();
+  this->frame_idx = 0;
+  DiscardSharedModule();
+  asIScriptModule *mod = nullptr;
+  if(options.share_script_engine)
+  {
+    LS_TRACE_SCOPE("BuildSharedScriptModule");
+    mod = LoadSharedModule(script_src, pass_decls);
+  }
+  else
+  {
+    ReleaseSharedNamespace();
+    this->shared_engine.reset();
+    {
+      LS_TRACE_SCOPE("RecreateScriptEngine");
+      RecreateAsScriptEngine(pass_decls);
+    }
+    LS_TRACE_SCOPE("BuildScriptModule");
+    mod = LoadAotModule(script_src, pass_decls);
+    if(!mod)
+      mod = as_script_engine->LoadScript(script_src, 0, this);
+  }
+  this->loaded_source = script_src;
+  this->loaded_pass_decls = pass_decls;
   this->as_script_func = mod->GetFunctionByName("main");
+  this->has_global_variables = mod->GetGlobalVarCount() > 0;
+  this->memoized_events.reset();
+  this->observed_inputs.clear();
+  this->cached_frames.clear();
+  {
+    LS_TRACE_SCOPE("AnalyzeRenderGraphInputs");
+    this->is_static_graph = this->as_script_func.value() && !this->has_global_variables && IsIndependentOf(this->as_script_func.value(), GetInputFuncIds());
+  }
+  //whatever global initialization left behind, so that frames start with an empty collector
+  as_script_engine->ptr->GarbageCollect(asGC_FULL_CYCLE);
+}
+
+std::set<int> RenderGraphScript::Impl::GetInputFuncIds()
+{
+  //functions reading context values or state kept between frames
+  std::set<std::string> input_func_names = {"SliderInt", "SliderFloat", "Checkbox", "GetTime", "GetPersistentImage", "GetHistoryImage"};
+  std::set<int> input_func_ids;
+  asIScriptEngine *engine = as_script_engine->ptr;
+  for(asUINT func_idx = 0; func_idx < engine->GetGlobalFunctionCount(); func_idx++)
+  {
+    asIScriptFunction *func = engine->GetGlobalFunctionByIndex(func_idx);
+    std::string name = func->GetName();
+    if(input_func_names.count(name) || name.rfind("Context", 0) == 0)
+      input_func_ids.insert(func->GetId());
+  }
+  return input_func_ids;
+}
+
+bool RenderGraphScript::Impl::IsStaticGraph() const
+{
+  return this->is_static_graph;
+}
+
+size_t RenderGraphScript::Impl::GetJitCompiledFunctionsCount() const
+{
+  return this->script_jit ? this->script_jit->GetCompiledFunctionsCount() : 0;
+}
+
+size_t RenderGraphScript::Impl::GetByteCodeRewritesCount() const
+{
+  return this->script_optimizer ? this->script_optimizer->GetRewritesCount() : 0;
+}
+
+bool RenderGraphScript::Impl::IsAotModule() const
+{
+  return this->is_aot_module;
+}
+
+asIScriptModule *RenderGraphScript::Impl::LoadAotModule(const std::string &script_src, const std::vector<ls::PassDecl> &pass_decls)
+{
+  this->is_aot_module = false;
+  if(!options.load_aot_render_graphs)
+    return nullptr;
+  asIScriptEngine *engine = as_script_engine->ptr;
+  const AotRenderGraph *render_graph = FindAotRenderGraph(GetAotSourceHash(engine, script_src));
+  if(!render_graph)
+    return nullptr;
+  //stubs the engine generates while loading, like template factories, need JitEntry instructions too
+  engine->SetEngineProperty(asEP_INCLUDE_JIT_INSTRUCTIONS, true);
+  //functions without generated code still go to the jit when it's on
+  asIJITCompiler *fallback_compiler = engine->GetJITCompiler();
+  this->aot_linker.reset(new AotFunctionLinker(*render_graph, fallback_compiler));
+  engine->SetJITCompiler(this->aot_linker.get());
+  this->is_loading_byte_code = true;
+  try
+  {
+    auto mod = as_script_engine->LoadByteCode(render_graph->byte_code, render_graph->byte_code_size, 0, this);
+    this->is_loading_byte_code = false;
+    this->is_aot_module = true;
+    return mod;
+  }
+  catch(const std::exception &)
+  {
+    //the byte code refers to functions that aren't registered the same way anymore, the source gets compiled instead
+    this->is_loading_byte_code = false;
+    engine->SetJITCompiler(fallback_compiler);
+    return nullptr;
+  }
+}
+
+asIScriptModule *RenderGraphScript::Impl::LoadSharedModule(const std::string &script_src, const std::vector<ls::PassDecl> &pass_decls)
+{
+  std::string pass_decls_signature = GetPassDeclsSignature(pass_decls);
+  bool is_namespace_reused = !this->shared_namespace_name.empty() && this->shared_pass_decls_signature == pass_decls_signature;
+  if(!is_namespace_reused)
+  {
+    ReleaseSharedNamespace();
+    if(this->shared_engine && this->shared_engine->dead_namespaces_count >= SharedEngine::max_dead_namespaces_count)
+    {
+      this->as_script_engine.reset();
+      this->shared_engine.reset();
+    }
+  }
+  if(!this->shared_engine)
+  {
+    LS_TRACE_SCOPE("AcquireSharedScriptEngine");
+    AcquireSharedEngine();
+  }
+  //the jit, the byte code optimizer and aot render graphs hook into the whole engine, so shared modules go without them
+  this->script_optimizer.reset();
+  this->aot_linker.reset();
+  this->is_aot_module = false;
+  asIScriptEngine *engine = as_script_engine->ptr;
+  std::string namespace_name = is_namespace_reused ? this->shared_namespace_name : "ls_script_" + std::to_string(++this->shared_engine->namespaces_count);
+  std::string source_prefix = "namespace " + namespace_name + " { ";
+  this->shared_module_name = namespace_name;
+  this->shared_source_prefix_size = source_prefix.size();
+  this->deferred_build_error.reset();
+  this->shared_engine->loading_impl = this;
+  asIScriptModule *mod = nullptr;
+  try
+  {
+    if(!is_namespace_reused)
+    {
+      //a namespace whose registration fails half way is dead from the start
+      this->shared_namespace_name = namespace_name;
+      engine->SetDefaultNamespace(namespace_name.c_str());
+      RegisterAsScriptPassFunctions(pass_decls);
+      engine->SetDefaultNamespace("");
+      this->shared_pass_decls_signature = pass_decls_signature;
+    }
+    //the namespace opens on the first line, so that line numbers stay the same
+    mod = as_script_engine->LoadScript(source_prefix + script_src + "\n}", namespace_name.c_str(), this);
+  }
+  catch(const std::exception &)
+  {
+    engine->SetDefaultNamespace("");
+    this->shared_engine->loading_impl = nullptr;
+    DiscardSharedModule();
+    if(this->shared_pass_decls_signature != pass_decls_signature)
+      ReleaseSharedNamespace();
+    ThrowDeferredBuildError();
+    throw;
+  }
+  this->shared_engine->loading_impl = nullptr;
+  //warnings don't fail the build, but an own engine would have thrown on them too
+  if(this->deferred_build_error)
+  {
+    DiscardSharedModule();
+    ThrowDeferredBuildError();
+  }
+  mod->SetDefaultNamespace(namespace_name.c_str());
+  return mod;
+}
+
+void RenderGraphScript::Impl::AcquireSharedEngine()
+{
+  static std::mutex shared_engine_mutex;
+  static std::weak_ptr<SharedEngine> weak_shared_engine;
+  std::lock_guard<std::mutex> lock(shared_engine_mutex);
+  this->shared_engine = weak_shared_engine.lock();
+  bool is_new_engine = !this->shared_engine || this->shared_engine->dead_namespaces_count >= SharedEngine::max_dead_namespaces_count;
+  if(is_new_engine)
+  {
+    this->shared_engine = std::make_shared<SharedEngine>();
+    SharedEngine *shared_engine_ptr = this->shared_engine.get();
+    this->shared_engine->as_script_engine = as::ScriptEngine::Create(
+      [shared_engine_ptr](const asSMessageInfo *msg){
+        if(shared_engine_ptr->loading_impl)
+          shared_engine_ptr->loading_impl->OnScriptMessage(msg);
+      }
+    );
+    this->shared_engine->as_script_engine->ptr->SetEngineProperty(asEP_AUTO_GARBAGE_COLLECT, false);
+  }
+  this->as_script_engine = std::shared_ptr<as::ScriptEngine>(this->shared_engine, this->shared_engine->as_script_engine.get());
+  if(is_new_engine)
+  {
+    this->vector_constructors.clear();
+    RegisterAsScriptGlobals();
+    weak_shared_engine = this->shared_engine;
+  }
+}
+
+void RenderGraphScript::Impl::DiscardSharedModule()
+{
+  if(this->shared_engine && !this->shared_module_name.empty())
+  {
+    if(asIScriptModule *mod = as_script_engine->ptr->GetModule(this->shared_module_name.c_str(), asGM_ONLY_IF_EXISTS))
+      mod->Discard();
+  }
+  this->shared_module_name.clear();
+}
+
+void RenderGraphScript::Impl::ReleaseSharedNamespace()
+{
+  if(this->shared_engine && !this->shared_namespace_name.empty())
+    this->shared_engine->dead_namespaces_count++;
+  this->shared_namespace_name.clear();
+  this->shared_pass_decls_signature.clear();
+}
+
+void RenderGraphScript::Impl::OnScriptMessage(const asSMessageInfo *msg)
+{
+  if(this->is_loading_byte_code)
+    return;
+  if(msg->type != asMSGTYPE_ERROR && msg->type != asMSGTYPE_WARNING)
+    return;
+  if(!this->shared_engine)
+    throw ls::RenderGraphBuildException(msg->row, msg->col, msg->message);
+  if(!this->deferred_build_error)
+  {
+    int col = msg->row == 1 ? std::max(1, msg->col - int(this->shared_source_prefix_size)) : msg->col;
+    this->deferred_build_error = ls::RenderGraphBuildException(msg->row, col, msg->message);
+  }
+}
+
+void RenderGraphScript::Impl::ThrowDeferredBuildError()
+{
+  if(!this->deferred_build_error)
+    return;
+  auto build_error = std::move(this->deferred_build_error.value());
+  this->deferred_build_error.reset();
+  throw build_error;
+}
+
+RenderGraphScript::Impl *RenderGraphScript::Impl::GetBoundImpl()
+{
+  //the instance that bindings registered now capture. the shared engine outlives the instance registering them, so its bindings capture nothing
+  return this->shared_engine ? nullptr : this;
+}
+
+RenderGraphScript::Impl *RenderGraphScript::Impl::GetCallingImpl(Impl *bound_impl)
+{
+  if(bound_impl)
+    return bound_impl;
+  //bindings of the shared engine are registered once and find their instance through the module of the script function calling them
+  asIScriptContext *ctx = asGetActiveContext();
+  asIScriptFunction *func = ctx ? ctx->GetFunction() : nullptr;
+  asIScriptModule *mod = func ? func->GetModule() : nullptr;
+  if(!mod || !mod->GetUserData())
+    throw std::runtime_error("Render graph function called from outside of a loaded script");
+  return static_cast<Impl*>(mod->GetUserData());
+}
+
+std::string RenderGraphScript::Impl::GenerateAotSource()
+{
+  if(!this->as_script_func)
+    throw std::runtime_error("No script loaded");
+  if(this->shared_engine)
+    throw std::runtime_error("Render graphs in a shared script engine can't be compiled ahead of time");
+  auto script_src = this->loaded_source;
+  auto pass_decls = this->loaded_pass_decls;
+  AotFunctionCollector collector;
+  RecreateAsScriptEngine(pass_decls);
+  //generated functions are entered at JitEntry instructions, so the saved byte code needs them
+  as_script_engine->ptr->SetEngineProperty(asEP_INCLUDE_JIT_INSTRUCTIONS, true);
+  //the saved byte code is optimized the same way as a loaded one would be
+  std::unique_ptr<ScriptOptimizer> optimizer;
+  if(options.optimize_byte_code)
+    optimizer.reset(new ScriptOptimizer(&collector, this->vector_constructors));
+  as_script_engine->ptr->SetJITCompiler(optimizer ? static_cast<asIJITCompiler*>(optimizer.get()) : &collector);
+  auto byte_code = as_script_engine->SaveByteCode(as_script_engine->LoadScript(script_src, 0, this));
+  //reloads into an engine that doesn't refer to the collector
+  LoadScript(script_src, pass_decls);
+  return GenerateAotTranslationUnit(GetAotSourceHash(as_script_engine->ptr, script_src), byte_code, collector.functions);
 }
 
 void RenderGraphScript::Impl::SetContextInputs(const std::vector<ContextInput> &context_inputs)
@@ -272,20 +791,161 @@ void RenderGraphScript::Impl::SetContextInputs(const std::vector<ContextInput> &
   }
 }
 
+bool IsSameContextValue(const ContextValueType &left, const ContextValueType &right)
+{
+  if(left.index() != right.index())
+    return false;
+  return std::visit([&right](const auto &left_val){
+    using ValueType = std::decay_t<decltype(left_val)>;
+    return memcmp(&left_val, &std::get<ValueType>(right), sizeof(ValueType)) == 0;
+  }, left);
+}
+
+template<typename T>
+T &RenderGraphScript::Impl::ObserveContextRef(const std::string &name)
+{
+  T &ref = this->script_context.GetContextRef<T>(name);
+  ContextValueType value(std::in_place_type<T>, ref);
+  //only the first read counts, the script can write through the returned reference afterwards
+  this->observed_inputs.insert({{value.index(), name}, value});
+  return ref;
+}
+
+bool RenderGraphScript::Impl::IsObservedInputsUnchanged(const ObservedInputs &inputs)
+{
+  for(const auto &observed_input : inputs)
+  {
+    const auto &name = observed_input.first.second;
+    bool is_same = std::visit([this, &name, &observed_input](const auto &val){
+      using ValueType = std::decay_t<decltype(val)>;
+      ContextValueType curr_value(std::in_place_type<ValueType>, this->script_context.GetContextRef<ValueType>(name));
+      return IsSameContextValue(curr_value, observed_input.second);
+    }, observed_input.second);
+    if(!is_same)
+      return false;
+  }
+  return true;
+}
+
+bool RenderGraphScript::Impl::IsFrameMemoizable()
+{
+  if(this->has_global_variables)
+    return false;
+  //persistent images change their copies and versions every frame
+  for(const auto &request : this->script_events.context_requests)
+  {
+    if(std::holds_alternative<PersistentImageRequest>(request))
+      return false;
+  }
+  //a script that wrote to a context value would see a different value next frame
+  return IsObservedInputsUnchanged(this->observed_inputs);
+}
+
+bool RenderGraphScript::Impl::IsFrameCacheable()
+{
+  //the time never comes back, such frames would only push out the ones that do
+  for(const auto &observed_input : this->observed_inputs)
+  {
+    if(observed_input.first.second == "@time")
+      return false;
+  }
+  return IsFrameMemoizable();
+}
+
+void AddEventStats(ScriptStats &stats, const ScriptEvents &script_events);
+
+ScriptEvents RenderGraphScript::Impl::RepeatEvents(const ScriptEvents &src_events, std::chrono::steady_clock::time_point frame_start_time)
+{
+  LS_TRACE_SCOPE("MemoizedFrame");
+  script_events = src_events;
+  script_events.is_memoized = true;
+  //cached image sizes can differ from the last executed frame when static frames of another swapchain size are served
+  ReportImageInvalidations();
+  if(options.collect_stats)
+  {
+    ScriptStats stats;
+    AddEventStats(stats, script_events);
+    stats.total_time_ms = std::chrono::duration<double>(std::chrono::steady_clock::now() - frame_start_time).count() * 1e3;
+    script_events.stats = stats;
+  }
+  return script_events;
+}
+
+void AddEventStats(ScriptStats &stats, const ScriptEvents &script_events)
+{
+  stats.pass_invocations_count = script_events.script_shader_invocations.size();
+  for(const auto &invocation : script_events.script_shader_invocations)
+    stats.uniform_bytes_count += invocation.uniform_data.size();
+  for(const auto &request : script_events.context_requests)
+  {
+    if(std::holds_alternative<FloatRequest>(request)) stats.float_requests_count++;
+    if(std::holds_alternative<IntRequest>(request)) stats.int_requests_count++;
+    if(std::holds_alternative<ColorRequest>(request)) stats.color_requests_count++;
+    if(std::holds_alternative<BoolRequest>(request)) stats.bool_requests_count++;
+    if(std::holds_alternative<TextRequest>(request)) stats.text_requests_count++;
+    if(std::holds_alternative<LoadedImageRequest>(request)) stats.loaded_image_requests_count++;
+    if(std::holds_alternative<CachedImageRequest>(request)) stats.cached_image_requests_count++;
+    if(std::holds_alternative<PersistentImageRequest>(request)) stats.persistent_image_requests_count++;
+  }
+}
+
 ScriptEvents RenderGraphScript::Impl::RunScript(const std::vector<ContextInput> &context_inputs)
 {
+  using Clock = std::chrono::steady_clock;
+  auto frame_start_time = Clock::now();
+  FrameArenaScope frame_arena_scope(options.use_frame_arena);
+  auto memory_start_counters = GetScriptMemoryCounters();
+
   script_events = ScriptEvents();
+  frame_idx++;
   SetContextInputs(context_inputs);
   
-  uvec2 swapchain_size = this->script_context.GetContextRef<uvec2>("@swapchain_size");
-  image_infos.clear();
-  image_infos.push_back({swapchain_size, ls::PixelFormats::rgba8});
+  if(options.memoize_frames && this->memoized_events && IsObservedInputsUnchanged(this->observed_inputs))
+    return RepeatEvents(this->memoized_events.value(), frame_start_time);
+  this->memoized_events.reset();
+  this->observed_inputs.clear();
+
+  if(options.cache_frames_by_inputs)
+  {
+    for(auto it = this->cached_frames.begin(); it != this->cached_frames.end(); ++it)
+    {
+      if(IsObservedInputsUnchanged(it->observed_inputs))
+      {
+        std::rotate(it, it + 1, this->cached_frames.end());
+        return RepeatEvents(this->cached_frames.back().events, frame_start_time);
+      }
+    }
+  }
+  uvec2 swapchain_size = ObserveContextRef<uvec2>("@swapchain_size");
+  image_infos[swapchain_img_id] = {swapchain_size, ls::PixelFormats::rgba8};
   
   this->script_context.curr_time = this->script_context.GetContextRef<float>("@time");
   
+  as::ScriptEngine::BindingStats binding_stats;
+  double execution_time = 0.0;
   if(this->as_script_func)
   {
-    auto opt_err = as_script_engine->RunScript(this->as_script_func.value());
+    as_script_engine->binding_stats = options.collect_stats ? &binding_stats : nullptr;
+    as::ScriptEngine::LineCallbackBinding::FuncType line_func = nullptr;
+    if(options.profile_lines)
+    {
+      line_profiler.Begin();
+      line_func = [this](asIScriptContext *ctx){ this->line_profiler.OnLine(ctx); };
+    }
+    if(options.collect_stats)
+      ResetVmCounters();
+    auto execution_start_time = Clock::now();
+    std::optional<as::ScriptEngine::RuntimeException> opt_err;
+    {
+      LS_TRACE_SCOPE("ExecuteRenderGraph");
+      opt_err = as_script_engine->RunScript(this->as_script_func.value(), line_func);
+      CloseScriptTraceScopes();
+    }
+    execution_time = std::chrono::duration<double>(Clock::now() - execution_start_time).count();
+    as_script_engine->binding_stats = nullptr;
+    frame_call_site_counts.clear();
+    if(options.profile_lines)
+      script_events.profile = line_profiler.End();
     if(opt_err)
     {
       throw ls::RenderGraphRuntimeException(
@@ -297,95 +957,209 @@ ScriptEvents RenderGraphScript::Impl::RunScript(const std::vector<ContextInput>
   }
   else
     throw std::runtime_error("No script loaded");
+  UpdatePersistentImageVersions();
+  ScriptStats stats;
+  CollectGarbage(stats);
+  ReportImageInvalidations();
+  ReleaseUnusedImageIds();
+  script_events.executed_frame_idx = frame_idx;
+  if(options.memoize_frames && IsFrameMemoizable())
+  {
+    this->memoized_events = script_events;
+    this->memoized_events->image_invalidations.clear();
+    this->memoized_events->released_image_ids.clear();
+    this->memoized_events->profile.reset();
+  }
+  if(options.cache_frames_by_inputs && IsFrameCacheable())
+  {
+    //a window resized continuously or a slider being dragged fills the cache with inputs that never come back,
+    //they are the least recently used ones once the dragging stops
+    const size_t max_cached_frames_count = 16;
+    if(this->cached_frames.size() >= max_cached_frames_count)
+      this->cached_frames.erase(this->cached_frames.begin());
+    this->cached_frames.push_back({this->observed_inputs, script_events});
+    auto &cached_events = this->cached_frames.back().events;
+    cached_events.image_invalidations.clear();
+    cached_events.released_image_ids.clear();
+    cached_events.profile.reset();
+  }
+
+  if(options.collect_stats)
+  {
+    auto memory_end_counters = GetScriptMemoryCounters();
+    stats.binding_time_ms = binding_stats.time * 1e3;
+    stats.binding_calls_count = binding_stats.calls_count;
+    stats.vm_time_ms = std::max(0.0, execution_time - binding_stats.time) * 1e3;
+    stats.script_allocations_count = memory_end_counters.allocations_count - memory_start_counters.allocations_count;
+    stats.script_allocated_bytes = memory_end_counters.allocated_bytes - memory_start_counters.allocated_bytes;
+    stats.arena_allocations_count = memory_end_counters.arena_allocations_count - memory_start_counters.arena_allocations_count;
+    stats.arena_allocated_bytes = memory_end_counters.arena_allocated_bytes - memory_start_counters.arena_allocated_bytes;
+    stats.arena_pinned_bytes = memory_end_counters.arena_pinned_bytes;
+    AddVmStats(stats, as_script_engine->ptr);
+    AddEventStats(stats, script_events);
+    stats.total_time_ms = std::chrono::duration<double>(Clock::now() - frame_start_time).count() * 1e3;
+    script_events.stats = stats;
+  }
   return script_events;
 }
+void RenderGraphScript::Impl::CollectGarbage(ScriptStats &stats)
+{
+  LS_TRACE_SCOPE("CollectGarbage");
+  using Clock = std::chrono::steady_clock;
+  auto start_time = Clock::now();
+  asIScriptEngine *engine = as_script_engine->ptr;
+  asUINT objects_count = 0;
+  asUINT start_destroyed_count = 0;
+  engine->GetGCStatistics(&objects_count, &start_destroyed_count);
+  stats.is_gc_full_cycle = objects_count >= options.gc_full_cycle_objects_count;
+  if(stats.is_gc_full_cycle)
+  {
+    engine->GarbageCollect(asGC_FULL_CYCLE);
+    stats.gc_steps_count = 1;
+  }
+  else
+  {
+    //a step never reports that the collector is done. detecting cycles takes about five steps per object held by the
+    //collector (clearing counters, counting references, marking, verifying, breaking circles), so steps stop once there
+    //are no new objects left and that many steps in a row destroyed nothing. unfinished work carries over to the next frame
+    const asUINT steps_per_batch = 16;
+    const asUINT detection_steps_per_object = 6;
+    auto end_time = start_time + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(options.gc_time_budget_ms));
+    asUINT prev_destroyed_count = start_destroyed_count;
+    size_t idle_steps_count = 0;
+    for(;;)
+    {
+      engine->GarbageCollect(asGC_ONE_STEP, steps_per_batch);
+      stats.gc_steps_count += steps_per_batch;
+      asUINT held_objects_count = 0;
+      asUINT destroyed_count = 0;
+      asUINT new_objects_count = 0;
+      engine->GetGCStatistics(&held_objects_count, &destroyed_count, nullptr, &new_objects_count);
+      idle_steps_count = destroyed_count == prev_destroyed_count ? idle_steps_count + steps_per_batch : 0;
+      prev_destroyed_count = destroyed_count;
+      bool is_idle = new_objects_count == 0 && idle_steps_count >= size_t(held_objects_count) * detection_steps_per_object;
+      if(is_idle || Clock::now() >= end_time)
+        break;
+    }
+  }
+  asUINT end_destroyed_count = 0;
+  engine->GetGCStatistics(&objects_count, &end_destroyed_count);
+  stats.gc_destroyed_objects_count = end_destroyed_count - start_destroyed_count;
+  stats.gc_objects_count = objects_count;
+  stats.gc_time_ms = std::chrono::duration<double>(Clock::now() - start_time).count() * 1e3;
+}
+
 void RenderGraphScript::Impl::RecreateAsScriptEngine(const std::vector<ls::PassDecl> &pass_decls)
 {
   this->as_script_engine.reset();
   this->as_script_engine = as::ScriptEngine::Create(
     [this](const asSMessageInfo *msg){
-      std::string msg_str = std::string("[") + std::to_string(msg->row) + ":" + std::to_string(msg->col) + "]" + " " + msg->message;
-      if(msg->type == asMSGTYPE_ERROR || msg->type == asMSGTYPE_WARNING)
-        throw ls::RenderGraphBuildException(
-          msg->row,
-          msg->col,
-          msg->message);
+      OnScriptMessage(msg);
     }
   );
+  //garbage is collected between frames instead of after allocations, see CollectGarbage()
+  as_script_engine->ptr->SetEngineProperty(asEP_AUTO_GARBAGE_COLLECT, false);
+  if(options.jit_compile)
+  {
+    if(!this->script_jit)
+      this->script_jit = ScriptJit::Create();
+    if(this->script_jit)
+    {
+      as_script_engine->ptr->SetEngineProperty(asEP_INCLUDE_JIT_INSTRUCTIONS, true);
+      as_script_engine->ptr->SetJITCompiler(this->script_jit.get());
+    }
+  }
+  this->vector_constructors.clear();
   RegisterAsScriptGlobals();
   RegisterAsScriptPassFunctions(pass_decls);
+  this->script_optimizer.reset();
+  if(options.optimize_byte_code)
+  {
+    //runs on every function before the jit sees it
+    asIScriptEngine *engine = as_script_engine->ptr;
+    this->script_optimizer.reset(new ScriptOptimizer(engine->GetJITCompiler(), this->vector_constructors));
+    engine->SetEngineProperty(asEP_INCLUDE_JIT_INSTRUCTIONS, true);
+    engine->SetJITCompiler(this->script_optimizer.get());
+  }
 }
 
 
 void RenderGraphScript::Impl::RegisterAsScriptGlobals()
 {
+  Impl *bound_impl = GetBoundImpl();
   as_script_engine->RegisterEnum("PixelFormats", {
     {"rgba8", int(ls::PixelFormats::rgba8)},
     {"rgba16f", int(ls::PixelFormats::rgba16f)},
     {"rgba32f", int(ls::PixelFormats::rgba32f)}
   });  
-  as_script_engine->RegisterGlobalFunction("int SliderInt(string name, int min_val, int max_val, int def_val = 0)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("int SliderInt(string name, int min_val, int max_val, int def_val = 0)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     std::string *name = (std::string*)gen->GetArgObject(0);
     int min_val = gen->GetArgDWord(1);
     int max_val = gen->GetArgDWord(2);
     int def_val = gen->GetArgDWord(3);
     
-    if(this->script_context.int_params.count(*name) == 0)
+    if(impl->script_context.int_params.count(*name) == 0)
     {
-      this->script_context.int_params[*name] = def_val;
+      impl->script_context.int_params[*name] = def_val;
     }
-    this->script_events.context_requests.push_back(
+    impl->script_events.context_requests.push_back(
       IntRequest{*name, min_val, max_val, def_val}
     );
-    auto curr_val = this->script_context.GetContextRef<int>(*name);
+    auto curr_val = impl->ObserveContextRef<int>(*name);
     gen->SetReturnDWord(curr_val);
   });
-  as_script_engine->RegisterGlobalFunction("float SliderFloat(string name, float min_val, float max_val, float def_val = 0.0f)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("float SliderFloat(string name, float min_val, float max_val, float def_val = 0.0f)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     std::string *name = (std::string*)gen->GetArgObject(0);
     float min_val = gen->GetArgFloat(1);
     float max_val = gen->GetArgFloat(2);
     float def_val = gen->GetArgFloat(3);
     
-    if(this->script_context.float_params.count(*name) == 0)
+    if(impl->script_context.float_params.count(*name) == 0)
     {
-      this->script_context.float_params[*name] = def_val;
+      impl->script_context.float_params[*name] = def_val;
     }
-    this->script_events.context_requests.push_back(
+    impl->script_events.context_requests.push_back(
       FloatRequest{*name, min_val, max_val, def_val}
     );
 
-    auto curr_val = this->script_context.GetContextRef<float>(*name);
+    auto curr_val = impl->ObserveContextRef<float>(*name);
     gen->SetReturnFloat(curr_val);
   });
-  as_script_engine->RegisterGlobalFunction("bool Checkbox(string name, bool def_val = true)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("bool Checkbox(string name, bool def_val = true)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     std::string *name = (std::string*)gen->GetArgObject(0);
     auto def_val = gen->GetArgByte(1);
     
-    if(this->script_context.int_params.count(*name) == 0)
+    if(impl->script_context.int_params.count(*name) == 0)
     {
-      this->script_context.int_params[*name] = def_val;
+      impl->script_context.int_params[*name] = def_val;
     }
-    this->script_events.context_requests.push_back(
+    impl->script_events.context_requests.push_back(
       BoolRequest{*name, def_val != 0}
     );
 
-    auto curr_val = this->script_context.GetContextRef<int>(*name);
+    auto curr_val = impl->ObserveContextRef<int>(*name);
     gen->SetReturnByte(curr_val != 0);
   });
 
-  as_script_engine->RegisterGlobalFunction("void Text(string str)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("void Text(string str)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     std::string text = *(std::string*)gen->GetArgObject(0);
-    this->script_events.context_requests.push_back(
+    impl->script_events.context_requests.push_back(
       TextRequest{text}
     );
   });
-  as_script_engine->RegisterGlobalFunction("float GetTime()", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("float GetTime()", [bound_impl](asIScriptGeneric *gen)
   {
-    gen->SetReturnFloat(this->script_context.curr_time);
+    Impl *impl = GetCallingImpl(bound_impl);
+    impl->ObserveContextRef<float>("@time");
+    gen->SetReturnFloat(impl->script_context.curr_time);
   });
 
   RegisterVecType<ls::vec2, 2>("vec2", "Vec2", "float");
@@ -399,10 +1173,54 @@ void RenderGraphScript::Impl::RegisterAsScriptGlobals()
   RegisterVecType<ls::uvec4, 4>("uvec4", "UVec4", "uint");
   RegisterImageType();
   RegisterBasicTypeOperations();
+  RegisterProfileScopes();
+}
+
+void RenderGraphScript::Impl::RegisterProfileScopes()
+{
+  Impl *bound_impl = GetBoundImpl();
+  //these are always registered so that scripts stay valid when tracing is compiled out
+  as_script_engine->RegisterGlobalFunction("void ProfileBegin(string name)", [bound_impl](asIScriptGeneric *gen)
+  {
+#if LEGIT_SCRIPT_TRACING
+    Impl *impl = GetCallingImpl(bound_impl);
+    std::string *name = (std::string*)gen->GetArgObject(0);
+    std::optional<double> begin_timestamp_us;
+    if(IsTracingEnabled())
+      begin_timestamp_us = GetTraceTimestamp();
+    impl->script_trace_scopes.push_back({*name, begin_timestamp_us});
+#endif
+  });
+  as_script_engine->RegisterGlobalFunction("void ProfileEnd()", [bound_impl](asIScriptGeneric *gen)
+  {
+#if LEGIT_SCRIPT_TRACING
+    Impl *impl = GetCallingImpl(bound_impl);
+    if(impl->script_trace_scopes.empty())
+      throw ls::RenderGraphRuntimeException(0, "ProfileEnd", "ProfileEnd() without a matching ProfileBegin()");
+    const auto &scope = impl->script_trace_scopes.back();
+    if(scope.begin_timestamp_us)
+      AddTraceEvent(scope.name.c_str(), scope.begin_timestamp_us.value());
+    impl->script_trace_scopes.pop_back();
+#endif
+  });
+}
+
+void RenderGraphScript::Impl::CloseScriptTraceScopes()
+{
+#if LEGIT_SCRIPT_TRACING
+  //scopes left open by an exception or a missing ProfileEnd() are closed at the end of the frame
+  for(; !script_trace_scopes.empty(); script_trace_scopes.pop_back())
+  {
+    const auto &scope = script_trace_scopes.back();
+    if(scope.begin_timestamp_us)
+      AddTraceEvent(scope.name.c_str(), scope.begin_timestamp_us.value());
+  }
+#endif
 }
 
 void RenderGraphScript::Impl::RegisterBasicTypeOperations()
 {
+  Impl *bound_impl = GetBoundImpl();
   as_script_engine->RegisterGlobalFunction("string to_string(float v)", [](asIScriptGeneric *gen)
   {
     float arg = gen->GetArgFloat(0);
@@ -415,77 +1233,317 @@ void RenderGraphScript::Impl::RegisterBasicTypeOperations()
     std::string res = std::to_string(arg);
     gen->SetReturnObject(&res);
   });
-  as_script_engine->RegisterGlobalFunction("int &ContextInt(string name)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("int &ContextInt(string name)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto *name = (std::string*)gen->GetArgObject(0);
     //this does not invalidate existing points
-    gen->SetReturnAddress(&this->script_context.int_params[*name]);
+    gen->SetReturnAddress(&impl->ObserveContextRef<int>(*name));
   });
-  as_script_engine->RegisterGlobalFunction("uint &ContextUInt(string name)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("uint &ContextUInt(string name)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto *name = (std::string*)gen->GetArgObject(0);
     //this does not invalidate existing points
-    gen->SetReturnAddress(&this->script_context.uint_params[*name]);
+    gen->SetReturnAddress(&impl->ObserveContextRef<unsigned int>(*name));
   });
-  as_script_engine->RegisterGlobalFunction("float &ContextFloat(string name)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("float &ContextFloat(string name)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto *name = (std::string*)gen->GetArgObject(0);
     //this does not invalidate existing points
-    gen->SetReturnAddress(&this->script_context.float_params[*name]);
+    gen->SetReturnAddress(&impl->ObserveContextRef<float>(*name));
   });  
 }
 
+ls::Image RenderGraphScript::Impl::RequestCachedImage(uvec2 size, ls::PixelFormats pixel_format, bool is_mipped)
+{
+  Image::Id id = GetStableImageId();
+  this->image_infos[id] = {size, pixel_format};
+  size_t mips_count = is_mipped ? this->image_infos[id].GetMipsCount() : 1;
+
+  ls::CachedImageRequest image_request;
+  image_request.id = id;
+  image_request.pixel_format = pixel_format;
+  image_request.size = size;
+  image_request.mips_count = mips_count;
+  this->script_events.context_requests.push_back(image_request);
+
+  ls::Image img;
+  img.id = id;
+  img.mip_range = ivec2{0, int(mips_count)};
+  return img;
+}
+
+void RenderGraphScript::Impl::ValidateStorageImageFormats(const ShaderInvocation &invocation, const ls::PassDecl &pass_decl)
+{
+  //storage images are accessed without format conversion, so the bound image has to have the declared image2D<format>.
+  //storage bindings are added in the order of the image arguments
+  size_t binding_idx = 0;
+  for(const auto &arg_desc : pass_decl.arg_descs)
+  {
+    const auto *dec_img_type = std::get_if<ls::DecoratedImageType>(&arg_desc.type);
+    if(!dec_img_type)
+      continue;
+    const auto &image = invocation.storage_image_bindings[binding_idx++].image;
+    ls::PixelFormats pixel_format = this->image_infos[image.id].pixel_format;
+    if(pixel_format != dec_img_type->pixel_format)
+    {
+      throw ls::RenderGraphRuntimeException(
+        0,
+        pass_decl.name,
+        "Storage image " + arg_desc.name + " is declared as " + PixelFormatToString(dec_img_type->pixel_format) + " but bound to an " + PixelFormatToString(pixel_format) + " image"
+      );
+    }
+  }
+}
+
+uvec3 RenderGraphScript::Impl::GetDispatchGroupsCount(const ShaderInvocation &invocation, const ls::PassDecl &pass_decl)
+{
+  //without an explicit count, one thread covers one texel of the first storage image. a sampled image says nothing
+  //about the domain of a pass that only reads, like a reduction, so such passes need the count
+  if(invocation.storage_image_bindings.empty())
+    throw ls::RenderGraphRuntimeException(0, pass_decl.name, "Compute pass without storage image arguments needs an explicit groups count");
+  const auto &target_img = invocation.storage_image_bindings[0].image;
+  uvec2 target_size = this->image_infos[target_img.id].GetMipSize(target_img.mip_range.x);
+  const auto &numthreads = pass_decl.numthreads;
+  return uvec3{
+    (target_size.x + numthreads.x - 1) / numthreads.x,
+    (target_size.y + numthreads.y - 1) / numthreads.y,
+    1};
+}
+
+Image::Id RenderGraphScript::Impl::GetStableImageId()
+{
+  FrameCallStack call_stack;
+  if(asIScriptContext *ctx = asGetActiveContext())
+  {
+    for(asUINT stack_level = 0; stack_level < ctx->GetCallstackSize(); stack_level++)
+    {
+      int column = 0;
+      int line = ctx->GetLineNumber(stack_level, &column);
+      call_stack.push_back({ctx->GetFunction(stack_level), line, column});
+    }
+  }
+  size_t call_idx = this->frame_call_site_counts[call_stack]++;
+  auto key = std::make_pair(ScriptCallStack(call_stack.begin(), call_stack.end()), call_idx);
+
+  auto it = this->image_ids.find(key);
+  if(it == this->image_ids.end())
+    it = this->image_ids.insert({key, {AllocateImageId(), 0}}).first;
+  it->second.last_requested_frame = this->frame_idx;
+  return it->second.id;
+}
+
+Image::Id RenderGraphScript::Impl::AllocateImageId()
+{
+  if(!this->free_image_ids.empty())
+  {
+    Image::Id id = this->free_image_ids.back();
+    this->free_image_ids.pop_back();
+    return id;
+  }
+  Image::Id id = this->image_infos.size();
+  this->image_infos.push_back(ImageInfo());
+  return id;
+}
+
+RenderGraphScript::Impl::PersistentImage &RenderGraphScript::Impl::UsePersistentImage(const std::string &name, const std::string &func_name)
+{
+  auto it = this->persistent_images.find(name);
+  if(it == this->persistent_images.end())
+    throw ls::RenderGraphRuntimeException(0, func_name, "Persistent image " + name + " was never requested");
+  auto &persistent_image = it->second;
+  //the first use in a frame swaps ping-pong copies
+  if(persistent_image.last_used_frame != this->frame_idx)
+  {
+    if(persistent_image.is_ping_pong && persistent_image.last_used_frame != 0)
+      persistent_image.current_copy ^= 1;
+    persistent_image.last_used_frame = this->frame_idx;
+  }
+  return persistent_image;
+}
+
+ls::Image RenderGraphScript::Impl::RequestPersistentImageCopy(const std::string &name, PersistentImage &persistent_image, size_t copy_idx, bool is_history)
+{
+  Image::Id id = persistent_image.ids[copy_idx];
+  this->image_infos[id] = persistent_image.info;
+  if(persistent_image.requested_frames[copy_idx] != this->frame_idx)
+  {
+    ls::PersistentImageRequest image_request;
+    image_request.name = name;
+    image_request.pixel_format = persistent_image.info.pixel_format;
+    image_request.size = persistent_image.info.size;
+    image_request.id = id;
+    image_request.is_history = is_history;
+    image_request.version = persistent_image.versions[copy_idx];
+    this->script_events.context_requests.push_back(image_request);
+    persistent_image.requested_frames[copy_idx] = this->frame_idx;
+  }
+  ls::Image img;
+  img.id = id;
+  img.mip_range = ivec2{0, 1};
+  return img;
+}
+
+void RenderGraphScript::Impl::UpdatePersistentImageVersions()
+{
+  std::set<Image::Id> written_ids;
+  for(const auto &invocation : script_events.script_shader_invocations)
+  {
+    for(const auto &attachment : invocation.color_attachments)
+      written_ids.insert(attachment.id);
+    for(const auto &storage_binding : invocation.storage_image_bindings)
+    {
+      if(storage_binding.access_qualifier != ls::AccessQualifiers::readonly)
+        written_ids.insert(storage_binding.image.id);
+    }
+  }
+  //requests are made before the invocations that write the copies, so their versions are filled once the frame is done
+  std::map<Image::Id, size_t> copy_versions;
+  for(auto &persistent_image : this->persistent_images)
+  {
+    auto &image = persistent_image.second;
+    for(size_t copy_idx = 0; copy_idx < 2; copy_idx++)
+    {
+      if(image.requested_frames[copy_idx] != this->frame_idx)
+        continue;
+      if(written_ids.count(image.ids[copy_idx]))
+        image.versions[copy_idx] = this->frame_idx;
+      copy_versions[image.ids[copy_idx]] = image.versions[copy_idx];
+    }
+  }
+  for(auto &request : script_events.context_requests)
+  {
+    if(std::holds_alternative<PersistentImageRequest>(request))
+    {
+      auto &image_request = std::get<PersistentImageRequest>(request);
+      image_request.version = copy_versions[image_request.id];
+    }
+  }
+}
+
+void RenderGraphScript::Impl::ReportImageInvalidations()
+{
+  auto report_image = [this](Image::Id id, uvec2 size, ls::PixelFormats pixel_format)
+  {
+    auto it = this->allocated_image_infos.find(id);
+    if(it != this->allocated_image_infos.end())
+    {
+      const ImageInfo &prev_info = it->second;
+      if(prev_info.size.x != size.x || prev_info.size.y != size.y || prev_info.pixel_format != pixel_format)
+        script_events.image_invalidations.push_back({id, prev_info.size, prev_info.pixel_format});
+    }
+    this->allocated_image_infos[id] = {size, pixel_format};
+  };
+  for(const auto &request : script_events.context_requests)
+  {
+    if(std::holds_alternative<CachedImageRequest>(request))
+    {
+      const auto &image_request = std::get<CachedImageRequest>(request);
+      report_image(image_request.id, image_request.size, image_request.pixel_format);
+    }
+    if(std::holds_alternative<PersistentImageRequest>(request))
+    {
+      const auto &image_request = std::get<PersistentImageRequest>(request);
+      report_image(image_request.id, image_request.size, image_request.pixel_format);
+    }
+  }
+}
+
+void RenderGraphScript::Impl::ReleaseUnusedImageIds()
+{
+  //a call site that stopped requesting its image (a branch toggled off, a loop that got shorter) would otherwise keep
+  //its id and the backend its allocation until the script is reloaded
+  const size_t max_unused_frames_count = 64;
+  for(auto it = this->image_ids.begin(); it != this->image_ids.end();)
+  {
+    if(this->frame_idx - it->second.last_requested_frame <= max_unused_frames_count)
+    {
+      ++it;
+      continue;
+    }
+    Image::Id id = it->second.id;
+    this->allocated_image_infos.erase(id);
+    this->free_image_ids.push_back(id);
+    script_events.released_image_ids.push_back(id);
+    it = this->image_ids.erase(it);
+  }
+  //cached frames can refer to the released ids, which will be handed out to other images
+  if(!script_events.released_image_ids.empty())
+    this->cached_frames.clear();
+}
+
 void RenderGraphScript::Impl::RegisterImageType()
 {
+  Impl *bound_impl = GetBoundImpl();
   as_script_engine->RegisterType<ls::Image>("Image");
 
-  as_script_engine->RegisterGlobalFunction("Image GetMippedImage(uvec2 size, PixelFormats pixel_format)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("Image GetMippedImage(uvec2 size, PixelFormats pixel_format)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto size = *(ls::uvec2*)gen->GetArgObject(0);
     auto pixel_format = ls::PixelFormats(gen->GetArgDWord(1));
     
-    Image::Id id = this->image_infos.size();
-    this->image_infos.push_back({size, pixel_format});
-
-    ls::CachedImageRequest image_request;
-    image_request.id = id;
-    image_request.pixel_format = pixel_format;
-    image_request.size = size;
-    this->script_events.context_requests.push_back(image_request);
-
-    ls::Image img;
-    img.id = id;
-    img.mip_range = ivec2{0, int(this->image_infos[id].GetMipsCount())};
+    ls::Image img = impl->RequestCachedImage(size, pixel_format, true);
     gen->SetReturnObject(&img);
   });
-  as_script_engine->RegisterGlobalFunction("Image GetImage(uvec2 size, PixelFormats pixel_format)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("Image GetImage(uvec2 size, PixelFormats pixel_format)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto size = *(ls::uvec2*)gen->GetArgObject(0);
     auto pixel_format = ls::PixelFormats(gen->GetArgDWord(1));
     
-    ls::CachedImageRequest image_request;
-    Image::Id id = this->image_infos.size();
-    this->image_infos.push_back({size, pixel_format});
-
-    image_request.id = id;
-    image_request.pixel_format = pixel_format;
-    image_request.size = size;    
-    this->script_events.context_requests.push_back(image_request);
-
-    ls::Image img;
-    img.id = id;
-    img.mip_range = ivec2{0, 1};
+    ls::Image img = impl->RequestCachedImage(size, pixel_format, false);
     gen->SetReturnObject(&img);
   });
-  as_script_engine->RegisterGlobalFunction("Image GetSwapchainImage()", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("Image GetSwapchainImage()", [](asIScriptGeneric *gen)
   {
     ls::Image img;
     img.id = swapchain_img_id;
     img.mip_range = ivec2{0, 1};
     gen->SetReturnObject(&img);
   });
-  as_script_engine->RegisterMethod("Image", "Image GetMip(int mip_level)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction("Image GetPersistentImage(string name, uvec2 size, PixelFormats pixel_format)", [bound_impl](asIScriptGeneric *gen)
+  {
+    Impl *impl = GetCallingImpl(bound_impl);
+    auto name = *(std::string*)gen->GetArgObject(0);
+    auto size = *(ls::uvec2*)gen->GetArgObject(1);
+    auto pixel_format = ls::PixelFormats(gen->GetArgDWord(2));
+
+    if(impl->persistent_images.find(name) == impl->persistent_images.end())
+      impl->persistent_images[name].ids[0] = impl->AllocateImageId();
+    auto &persistent_image = impl->UsePersistentImage(name, "GetPersistentImage");
+    //the backend drops the contents of both copies with the invalidation
+    if(persistent_image.info.size.x != size.x || persistent_image.info.size.y != size.y || persistent_image.info.pixel_format != pixel_format)
+      persistent_image.versions = {0, 0};
+    persistent_image.info = {size, pixel_format};
+    ls::Image img = impl->RequestPersistentImageCopy(name, persistent_image, persistent_image.current_copy, false);
+    gen->SetReturnObject(&img);
+  });
+  as_script_engine->RegisterGlobalFunction("Image GetHistoryImage(string name)", [bound_impl](asIScriptGeneric *gen)
+  {
+    Impl *impl = GetCallingImpl(bound_impl);
+    auto name = *(std::string*)gen->GetArgObject(0);
+
+    auto &persistent_image = impl->UsePersistentImage(name, "GetHistoryImage");
+    if(!persistent_image.is_ping_pong)
+    {
+      persistent_image.is_ping_pong = true;
+      persistent_image.ids[persistent_image.current_copy ^ 1] = impl->AllocateImageId();
+    }
+    ls::Image img = impl->RequestPersistentImageCopy(name, persistent_image, persistent_image.current_copy ^ 1, true);
+    gen->SetReturnObject(&img);
+  });
+  as_script_engine->RegisterGlobalFunction("void MarkExternalOutput(Image img)", [bound_impl](asIScriptGeneric *gen)
+  {
+    Impl *impl = GetCallingImpl(bound_impl);
+    auto img = *(ls::Image*)gen->GetArgObject(0);
+    impl->script_events.external_output_ids.push_back(img.id);
+  });
+  as_script_engine->RegisterMethod("Image", "Image GetMip(int mip_level)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto src_img = *(ls::Image*)gen->GetObject();
     int mip_level = gen->GetArgDWord(0);
     
@@ -501,24 +1559,25 @@ void RenderGraphScript::Impl::RegisterImageType()
       );
     }
     
-    int mip = std::clamp<int>(dst_mip, 0, this->image_infos[src_img.id].GetMipsCount() - 1);
+    int mip = std::clamp<int>(dst_mip, 0, impl->image_infos[src_img.id].GetMipsCount() - 1);
     dst_img.mip_range = ivec2{mip, mip + 1};
 
     gen->SetReturnObject(&dst_img);
   });
-  as_script_engine->RegisterMethod("Image", "uvec2 GetSize() const", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterMethod("Image", "uvec2 GetSize() const", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto *this_ptr = (ls::Image*)gen->GetObject();
-    uvec2 mip_size = this->image_infos[this_ptr->id].GetMipSize(this_ptr->mip_range.x);
+    uvec2 mip_size = impl->image_infos[this_ptr->id].GetMipSize(this_ptr->mip_range.x);
     gen->SetReturnObject(&mip_size);
   });
-  as_script_engine->RegisterMethod("Image", "uint GetMipsCount() const", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterMethod("Image", "uint GetMipsCount() const", [](asIScriptGeneric *gen)
   {
     auto *this_ptr = (ls::Image*)gen->GetObject();
     int mips_count = this_ptr->mip_range.y - this_ptr->mip_range.x;
     gen->SetReturnDWord(mips_count);
   });
-  as_script_engine->RegisterMethod("Image", "void Print()", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterMethod("Image", "void Print()", [](asIScriptGeneric *gen)
   {
     auto *this_ptr = (ls::Image*)gen->GetObject();
     std::cout << "Img id: " << this_ptr->id << " [" << this_ptr->mip_range.x << ", " << this_ptr->mip_range.y << "]\n";
@@ -549,6 +1608,7 @@ void SetComp(VecType &v, size_t idx, CompType c)
 template<typename VecType, size_t CompCount>
 void RenderGraphScript::Impl::RegisterVecType(std::string type_name, std::string uppercase_type_name, std::string comp_type_name)
 {
+  Impl *bound_impl = GetBoundImpl();
   using CompType = decltype(VecType::x);
   assert(sizeof(VecType) == sizeof(CompType) * CompCount);
   as_script_engine->RegisterType<VecType>(type_name.c_str());
@@ -565,7 +1625,7 @@ void RenderGraphScript::Impl::RegisterVecType(std::string type_name, std::string
     constr_decl += member_decl;
   }
   constr_decl += ")";
-  as_script_engine->RegisterConstructor(type_name.c_str(), constr_decl.c_str(), [](asIScriptGeneric *gen)
+  int constr_id = as_script_engine->RegisterConstructor(type_name.c_str(), constr_decl.c_str(), [](asIScriptGeneric *gen)
   {
     auto *this_ptr = (VecType*)gen->GetObject();
     for(size_t i = 0; i < CompCount; i++)
@@ -573,7 +1633,7 @@ void RenderGraphScript::Impl::RegisterVecType(std::string type_name, std::string
       SetComp(*this_ptr, i, GetArg<CompType>(gen, i));
     }
   });
-  as_script_engine->RegisterConstructor(type_name.c_str(), "void f(" + comp_type_name + " v)", [](asIScriptGeneric *gen)
+  int splat_constr_id = as_script_engine->RegisterConstructor(type_name.c_str(), "void f(" + comp_type_name + " v)", [](asIScriptGeneric *gen)
   {
     auto *this_ptr = (VecType*)gen->GetObject();
     for(size_t i = 0; i < CompCount; i++)
@@ -581,6 +1641,8 @@ void RenderGraphScript::Impl::RegisterVecType(std::string type_name, std::string
       SetComp(*this_ptr, i, GetArg<CompType>(gen, 0));
     }
   });
+  this->vector_constructors[constr_id] = {CompCount, false};
+  this->vector_constructors[splat_constr_id] = {CompCount, true};
 
   as_script_engine->RegisterMethod(type_name.c_str(), (type_name + " " + "opAdd(" + type_name + ") const").c_str(), [=](asIScriptGeneric *gen)
   {
@@ -669,10 +1731,11 @@ void RenderGraphScript::Impl::RegisterVecType(std::string type_name, std::string
     res += "]";
     gen->SetReturnObject(&res);
   });
-  as_script_engine->RegisterGlobalFunction(type_name + "& Context" + uppercase_type_name + "(string name)", [this](asIScriptGeneric *gen)
+  as_script_engine->RegisterGlobalFunction(type_name + "& Context" + uppercase_type_name + "(string name)", [bound_impl](asIScriptGeneric *gen)
   {
+    Impl *impl = GetCallingImpl(bound_impl);
     auto *name_ptr = (std::string*)gen->GetArgObject(0);
-    gen->SetReturnObject(&this->script_context.GetContextRef<VecType>(*name_ptr));
+    gen->SetReturnObject(&impl->ObserveContextRef<VecType>(*name_ptr));
   });
 }
 
@@ -681,18 +1744,95 @@ void RenderGraphScript::Impl::RegisterAsScriptPassFunctions(const std::vector<ls
 {
   for(const auto &pass_decl : pass_decls)
   {
-    std::string as_func_decl = CreateAsPassFuncDeclaration(pass_decl);
+    if(pass_decl.type == ls::PassDecl::Types::InstancedPass)
+    {
+      RegisterAsScriptInstancedPassFunction(pass_decl);
+      continue;
+    }
+    std::string as_func_decl = CreateAsPassFuncDeclaration(pass_decl, "");
     this->as_script_engine->RegisterGlobalFunction(as_func_decl, [this, pass_decl](asIScriptGeneric *gen)
     {
+      LS_TRACE_SCOPE(pass_decl.name);
       ShaderInvocation invocation;
       invocation.shader_name = pass_decl.name;
       for(size_t param_idx = 0; param_idx < pass_decl.arg_descs.size(); param_idx++)
       {
         AddScriptInvocationAsArg(invocation, gen, param_idx, pass_decl.arg_descs[param_idx]);
       }
+      ValidateStorageImageFormats(invocation, pass_decl);
+      if(pass_decl.type == ls::PassDecl::Types::ComputePass)
+        invocation.groups_count = GetDispatchGroupsCount(invocation, pass_decl);
       this->script_events.script_shader_invocations.push_back(invocation);
     });
+    if(pass_decl.type == ls::PassDecl::Types::ComputePass)
+    {
+      //overload that takes the dispatched workgroups count explicitly as the last argument
+      std::string as_dispatch_decl = CreateAsPassFuncDeclaration(pass_decl, "uvec3 groups_count");
+      this->as_script_engine->RegisterGlobalFunction(as_dispatch_decl, [this, pass_decl](asIScriptGeneric *gen)
+      {
+        LS_TRACE_SCOPE(pass_decl.name);
+        ShaderInvocation invocation;
+        invocation.shader_name = pass_decl.name;
+        for(size_t param_idx = 0; param_idx < pass_decl.arg_descs.size(); param_idx++)
+        {
+          AddScriptInvocationAsArg(invocation, gen, param_idx, pass_decl.arg_descs[param_idx]);
+        }
+        ValidateStorageImageFormats(invocation, pass_decl);
+        invocation.groups_count = *(uvec3*)gen->GetArgObject(pass_decl.arg_descs.size());
+        this->script_events.script_shader_invocations.push_back(invocation);
+      });
+    }
   }
 }
 
-}
\ No newline at end of file
+void RenderGraphScript::Impl::RegisterAsScriptInstancedPassFunction(const ls::PassDecl &pass_decl)
+{
+  //per-instance data is passed as an array of <Name>Instance, a value type laid out exactly like the instance buffer
+  const auto &instanced = pass_decl.instanced;
+  std::string instance_type_name = pass_decl.name + "Instance";
+  std::string extra_args = "uint instances_count";
+  if(instanced.stride > 0)
+  {
+    this->as_script_engine->RegisterType(instance_type_name, instanced.stride);
+    size_t stride = instanced.stride;
+    this->as_script_engine->RegisterConstructor(instance_type_name, "void f()", [stride](asIScriptGeneric *gen)
+    {
+      std::memset(gen->GetObject(), 0, stride);
+    });
+    for(const auto &attribute : instanced.attributes)
+      this->as_script_engine->RegisterMember(instance_type_name, PodTypeToString(attribute.type) + " " + attribute.name, attribute.offset);
+    extra_args += ", const array<" + instance_type_name + "> &in instances";
+  }
+  std::string as_func_decl = CreateAsPassFuncDeclaration(pass_decl, extra_args);
+  this->as_script_engine->RegisterGlobalFunction(as_func_decl, [this, pass_decl](asIScriptGeneric *gen)
+  {
+    LS_TRACE_SCOPE(pass_decl.name);
+    ShaderInvocation invocation;
+    invocation.shader_name = pass_decl.name;
+    size_t args_count = pass_decl.arg_descs.size();
+    for(size_t param_idx = 0; param_idx < args_count; param_idx++)
+    {
+      AddScriptInvocationAsArg(invocation, gen, param_idx, pass_decl.arg_descs[param_idx]);
+    }
+    ValidateStorageImageFormats(invocation, pass_decl);
+    invocation.instances_count = gen->GetArgDWord(args_count);
+    size_t stride = pass_decl.instanced.stride;
+    if(stride > 0)
+    {
+      auto *instances = (CScriptArray*)gen->GetArgAddress(args_count + 1);
+      if(invocation.instances_count > instances->GetSize())
+      {
+        throw ls::RenderGraphRuntimeException(
+          0,
+          pass_decl.name,
+          "Requested " + std::to_string(invocation.instances_count) + " instances but the array only has " + std::to_string(instances->GetSize()));
+      }
+      invocation.instance_data.resize(invocation.instances_count * stride);
+      for(asUINT instance_idx = 0; instance_idx < invocation.instances_count; instance_idx++)
+        std::memcpy(invocation.instance_data.data() + instance_idx * stride, instances->At(instance_idx), stride);
+    }
+    this->script_events.script_shader_invocations.push_back(invocation);
+  });
+}
+
+}
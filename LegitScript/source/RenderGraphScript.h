@@ -2,6 +2,7 @@
 #include "ScriptParser.h"
 #include "../include/LegitScriptEvents.h"
 #include "../include/LegitScriptInputs.h"
+#include "../include/LegitScriptOptions.h"
 #include <functional>
 
 namespace ls
@@ -46,6 +47,13 @@ namespace ls
     ~RenderGraphScript();
     void LoadScript(std::string script_src, const std::vector<ls::PassDecl> &pass_decls);
     ScriptEvents RunScript(const std::vector<ContextInput> &context_inputs);
+    void SetOptions(const ls::ScriptOptions &options);
+    bool IsStaticGraph() const;
+    size_t GetJitCompiledFunctionsCount() const;
+    size_t GetByteCodeRewritesCount() const;
+    bool IsAotModule() const;
+    //c++ translation unit registering the loaded render graph, see LegitScriptAot.h
+    std::string GenerateAotSource();
     
   private:
     struct Impl;
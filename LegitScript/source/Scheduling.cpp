@@ -0,0 +1,94 @@
+#include "FrameGraph.h"
+#include <set>
+
+namespace ls
+{
+  bool IsSameAttachments(const ShaderInvocation &left, const ShaderInvocation &right)
+  {
+    //compute dispatches can't happen inside a render pass
+    if(left.groups_count || right.groups_count)
+      return false;
+    if(left.color_attachments.size() != right.color_attachments.size())
+      return false;
+    for(size_t attachment_idx = 0; attachment_idx < left.color_attachments.size(); attachment_idx++)
+    {
+      const auto &left_attachment = left.color_attachments[attachment_idx];
+      const auto &right_attachment = right.color_attachments[attachment_idx];
+      if(left_attachment.id != right_attachment.id || left_attachment.mip_range.x != right_attachment.mip_range.x)
+        return false;
+    }
+    return true;
+  }
+
+  std::vector<RenderPass> GetRenderPasses(const std::vector<ShaderInvocation> &invocations)
+  {
+    std::vector<RenderPass> render_passes;
+    for(size_t invocation_idx = 0; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      if(render_passes.empty() || !IsSameAttachments(invocations[invocation_idx - 1], invocations[invocation_idx]))
+        render_passes.push_back({invocation_idx, 0});
+      render_passes.back().invocations_count++;
+    }
+    return render_passes;
+  }
+
+  RenderPassSchedule ScheduleRenderPasses(ScriptEvents &script_events, FrameAccesses &frame_accesses)
+  {
+    auto &invocations = script_events.script_shader_invocations;
+    RenderPassSchedule schedule;
+    schedule.unscheduled_render_passes_count = GetRenderPasses(invocations).size();
+
+    //greedy list scheduling: among the invocations whose dependencies are done, keep rendering to the current attachments
+    //if possible, otherwise take the earliest one in script order
+    auto dependency_graph = BuildDependencyGraph(frame_accesses);
+    std::vector<size_t> pending_dependencies_counts(invocations.size());
+    std::vector<std::vector<size_t>> dependents(invocations.size());
+    for(size_t invocation_idx = 0; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      pending_dependencies_counts[invocation_idx] = dependency_graph.dependencies[invocation_idx].size();
+      for(size_t dependency : dependency_graph.dependencies[invocation_idx])
+        dependents[dependency].push_back(invocation_idx);
+    }
+    std::set<size_t> ready_invocations;
+    for(size_t invocation_idx = 0; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      if(pending_dependencies_counts[invocation_idx] == 0)
+        ready_invocations.insert(invocation_idx);
+    }
+    while(!ready_invocations.empty())
+    {
+      size_t next_idx = *ready_invocations.begin();
+      if(!schedule.original_indices.empty())
+      {
+        const auto &last_invocation = invocations[schedule.original_indices.back()];
+        for(size_t ready_idx : ready_invocations)
+        {
+          if(IsSameAttachments(last_invocation, invocations[ready_idx]))
+          {
+            next_idx = ready_idx;
+            break;
+          }
+        }
+      }
+      ready_invocations.erase(next_idx);
+      schedule.original_indices.push_back(next_idx);
+      for(size_t dependent : dependents[next_idx])
+      {
+        if(--pending_dependencies_counts[dependent] == 0)
+          ready_invocations.insert(dependent);
+      }
+    }
+
+    std::vector<ShaderInvocation> scheduled_invocations;
+    FrameAccesses scheduled_accesses;
+    for(size_t original_idx : schedule.original_indices)
+    {
+      scheduled_invocations.push_back(std::move(invocations[original_idx]));
+      scheduled_accesses.push_back(std::move(frame_accesses[original_idx]));
+    }
+    invocations = std::move(scheduled_invocations);
+    frame_accesses = std::move(scheduled_accesses);
+    schedule.render_passes = GetRenderPasses(invocations);
+    return schedule;
+  }
+}
@@ -0,0 +1,64 @@
+#include "ScriptAnalysis.h"
+#include <vector>
+
+namespace ls
+{
+  bool IsIndependentOf(asIScriptFunction *func, const std::set<int> &input_func_ids)
+  {
+    asIScriptEngine *engine = func->GetEngine();
+    std::vector<asIScriptFunction*> pending_funcs = {func};
+    std::set<int> visited_func_ids;
+    auto add_func = [&](asIScriptFunction *called_func)
+    {
+      if(called_func && visited_func_ids.insert(called_func->GetId()).second)
+        pending_funcs.push_back(called_func);
+    };
+    visited_func_ids.insert(func->GetId());
+    while(!pending_funcs.empty())
+    {
+      asIScriptFunction *curr_func = pending_funcs.back();
+      pending_funcs.pop_back();
+      if(input_func_ids.count(curr_func->GetId()))
+        return false;
+      if(curr_func->GetFuncType() != asFUNC_SCRIPT)
+        continue;
+
+      asUINT length = 0;
+      asDWORD *byte_code = curr_func->GetByteCode(&length);
+      for(asDWORD *instr = byte_code; byte_code && instr < byte_code + length; instr += asBCTypeSize[asBCInfo[*(asBYTE*)instr].type])
+      {
+        switch(*(asBYTE*)instr)
+        {
+          case asBC_CALL:
+          case asBC_CALLSYS:
+          case asBC_Thiscall1:
+            add_func(engine->GetFunctionById(asBC_INTARG(instr)));
+          break;
+          case asBC_ALLOC:
+            add_func(engine->GetFunctionById(asBC_INTARG(instr + AS_PTR_SIZE)));
+          break;
+          case asBC_CALLINTF:
+          {
+            //virtual calls can end up in any implementation, so every method of the module's classes is scanned
+            add_func(engine->GetFunctionById(asBC_INTARG(instr)));
+            asIScriptModule *module = curr_func->GetModule();
+            for(asUINT type_idx = 0; module && type_idx < module->GetObjectTypeCount(); type_idx++)
+            {
+              asITypeInfo *type_info = module->GetObjectTypeByIndex(type_idx);
+              for(asUINT method_idx = 0; method_idx < type_info->GetMethodCount(); method_idx++)
+                add_func(type_info->GetMethodByIndex(method_idx, false));
+            }
+          }break;
+          case asBC_FuncPtr:
+            add_func((asIScriptFunction*)asBC_PTRARG(instr));
+          break;
+          case asBC_CALLBND:
+          case asBC_CallPtr:
+            return false;
+          break;
+        }
+      }
+    }
+    return true;
+  }
+}
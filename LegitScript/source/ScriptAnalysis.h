@@ -0,0 +1,10 @@
+#pragma once
+#include <angelscript.h>
+#include <set>
+
+namespace ls
+{
+  //walks the bytecode of func and of every script function it can call. returns false if any of them calls one of
+  //input_func_ids or makes a call that can't be followed statically (function pointers, imported functions)
+  bool IsIndependentOf(asIScriptFunction *func, const std::set<int> &input_func_ids);
+}
@@ -0,0 +1,424 @@
+#include "ScriptAot.h"
+#include "ScriptJit.h"
+#include <iomanip>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+
+namespace ls
+{
+  std::map<uint64_t, AotRenderGraph> &GetAotRegistry(std::unique_lock<std::mutex> &lock)
+  {
+    static std::mutex registry_mutex;
+    static std::map<uint64_t, AotRenderGraph> registry;
+    lock = std::unique_lock<std::mutex>(registry_mutex);
+    return registry;
+  }
+
+  void RegisterAotRenderGraph(const AotRenderGraph &render_graph)
+  {
+    std::unique_lock<std::mutex> lock;
+    GetAotRegistry(lock)[render_graph.source_hash] = render_graph;
+  }
+
+  const AotRenderGraph *FindAotRenderGraph(uint64_t source_hash)
+  {
+    std::unique_lock<std::mutex> lock;
+    auto &registry = GetAotRegistry(lock);
+    auto it = registry.find(source_hash);
+    return it == registry.end() ? nullptr : &it->second;
+  }
+
+  bool AotCallSystem(asSVMRegisters *registers, void *instr)
+  {
+    return JitCallSystem(registers, static_cast<asDWORD*>(instr)) != 0;
+  }
+
+  //fnv-1a
+  void HashBytes(uint64_t &hash, const std::string &str)
+  {
+    for(char c : str)
+    {
+      hash ^= uint64_t(uint8_t(c));
+      hash *= 1099511628211ull;
+    }
+  }
+
+  uint64_t GetAotSourceHash(asIScriptEngine *engine, const std::string &script_src)
+  {
+    uint64_t hash = 14695981039346656037ull;
+    HashBytes(hash, script_src);
+    //byte code only loads against the functions it was saved with, so pass signatures are part of the key
+    for(asUINT func_idx = 0; func_idx < engine->GetGlobalFunctionCount(); func_idx++)
+      HashBytes(hash, engine->GetGlobalFunctionByIndex(func_idx)->GetDeclaration(true, true, true));
+    return hash;
+  }
+
+  std::string GetAotFunctionDecl(asIScriptFunction *function)
+  {
+    return function->GetDeclaration(true, true, true);
+  }
+
+  int AotFunctionCollector::CompileFunction(asIScriptFunction *function, asJITFunction *output)
+  {
+    asUINT length;
+    asDWORD *byte_code = function->GetByteCode(&length);
+    if(byte_code)
+      functions.push_back({GetAotFunctionDecl(function), std::vector<asDWORD>(byte_code, byte_code + length)});
+    return asNOT_SUPPORTED;
+  }
+  void AotFunctionCollector::ReleaseJITFunction(asJITFunction func)
+  {
+  }
+
+  //translates the instructions IsJitSupported() accepts to c++ statements with the semantics of the interpreter's ones.
+  //every other instruction returns to the interpreter
+  struct AotFunctionWriter
+  {
+    AotFunctionWriter(const std::vector<asDWORD> &byte_code)
+      : byte_code(byte_code)
+    {
+      for(size_t offset = 0; offset < byte_code.size(); offset += asBCTypeSize[asBCInfo[Op(offset)].type])
+        offsets.push_back(offset);
+    }
+
+    //offsets of the JitEntry instructions the function can be entered at, in the order of their entry numbers
+    std::vector<size_t> GetEntryOffsets() const
+    {
+      std::vector<size_t> entry_offsets;
+      for(size_t instr_idx = 0; instr_idx + 1 < offsets.size(); instr_idx++)
+      {
+        if(Op(offsets[instr_idx]) == asBC_JitEntry && IsJitSupported(Op(offsets[instr_idx + 1])))
+          entry_offsets.push_back(offsets[instr_idx]);
+      }
+      return entry_offsets;
+    }
+
+    void Write(std::ostream &out, const std::string &func_name)
+    {
+      auto entry_offsets = GetEntryOffsets();
+      std::set<size_t> labels(entry_offsets.begin(), entry_offsets.end());
+      for(size_t offset : offsets)
+      {
+        auto opt_target = GetJumpTarget(offset);
+        if(opt_target)
+          labels.insert(opt_target.value());
+      }
+
+      out << "  void " << func_name << "(asSVMRegisters *regs, size_t entry)\n";
+      out << "  {\n";
+      out << "    static const size_t entry_offsets[] = {";
+      for(size_t entry_idx = 0; entry_idx < entry_offsets.size(); entry_idx++)
+        out << (entry_idx ? ", " : "") << entry_offsets[entry_idx];
+      out << "};\n";
+      out << "    asDWORD *bc = regs->programPointer - entry_offsets[entry - 1];\n";
+      out << "    asDWORD *fp = regs->stackFramePointer;\n";
+      out << "    switch(entry)\n";
+      out << "    {\n";
+      for(size_t entry_idx = 0; entry_idx < entry_offsets.size(); entry_idx++)
+      {
+        out << "      " << (entry_idx + 1 < entry_offsets.size() ? "case " + std::to_string(entry_idx + 1) : std::string("default"));
+        out << ": goto bc_" << entry_offsets[entry_idx] << ";\n";
+      }
+      out << "    }\n";
+
+      bool is_reachable = false;
+      for(size_t instr_idx = 0; instr_idx < offsets.size(); instr_idx++)
+      {
+        size_t offset = offsets[instr_idx];
+        bool is_supported = IsJitSupported(Op(offset));
+        bool is_label = labels.count(offset) > 0;
+        if(!is_supported && !is_reachable && !is_label)
+          continue;
+        if(is_label)
+          out << "  bc_" << offset << ":\n";
+        if(is_supported)
+          WriteInstr(out, offset);
+        else
+          out << "    " << Exit(offset) << "\n";
+        is_reachable = is_supported && Op(offset) != asBC_JMP;
+      }
+      out << "  }\n";
+    }
+  private:
+    asEBCInstr Op(size_t offset) const
+    {
+      return asEBCInstr(*reinterpret_cast<const asBYTE*>(&byte_code[offset]));
+    }
+    short VarArg(size_t offset, size_t arg_idx) const
+    {
+      return *(reinterpret_cast<const short*>(&byte_code[offset]) + 1 + arg_idx);
+    }
+    asDWORD DwordArg(size_t offset, size_t arg_idx = 0) const
+    {
+      return byte_code[offset + 1 + arg_idx];
+    }
+    std::optional<size_t> GetJumpTarget(size_t offset) const
+    {
+      switch(Op(offset))
+      {
+        case asBC_JMP: case asBC_JZ: case asBC_JNZ: case asBC_JS: case asBC_JNS: case asBC_JP: case asBC_JNP:
+        case asBC_JLowZ: case asBC_JLowNZ:
+          return size_t(int64_t(offset) + 2 + int(DwordArg(offset)));
+        default:
+          return std::nullopt;
+      }
+    }
+    //the same stack slot or value register is read as different types, so they are only accessed through the generated
+    //file's memcpy based Load<T>() and Store<T>(). pointer casts would break strict aliasing and let the compiler reorder them
+    static std::string Address(short var_offset)
+    {
+      return var_offset >= 0 ? "fp - " + std::to_string(var_offset) : "fp + " + std::to_string(-int(var_offset));
+    }
+    //variable at fp - var_offset
+    static std::string Load(const std::string &type, short var_offset)
+    {
+      return "Load<" + type + ">(" + Address(var_offset) + ")";
+    }
+    static std::string Store(const std::string &type, short var_offset, const std::string &val)
+    {
+      return "Store<" + type + ">(" + Address(var_offset) + ", " + val + ");";
+    }
+    static std::string LoadRegister(const std::string &type)
+    {
+      return "Load<" + type + ">(&regs->valueRegister)";
+    }
+    static std::string StoreRegister(const std::string &type, const std::string &val)
+    {
+      return "Store<" + type + ">(&regs->valueRegister, " + val + ");";
+    }
+    static std::string Hex(uint64_t val)
+    {
+      std::stringstream ss;
+      ss << "0x" << std::hex << val << "u";
+      return ss.str();
+    }
+    static std::string Exit(size_t offset)
+    {
+      return "{ regs->programPointer = bc + " + std::to_string(offset) + "; return; }";
+    }
+    static std::string Compare(const std::string &type, const std::string &left, const std::string &right)
+    {
+      return "{ " + type + " v1 = " + left + ", v2 = " + right + "; " + StoreRegister("int", "v1 == v2 ? 0 : (v1 < v2 ? -1 : 1)") + " }";
+    }
+    static std::string Test(const std::string &cond)
+    {
+      return "{ int v = " + LoadRegister("int") + "; " + StoreRegister("asQWORD", "v " + cond + " 0 ? 1 : 0") + " }";
+    }
+    std::string Branch(size_t offset, const std::string &cond) const
+    {
+      return "if(" + cond + ") goto bc_" + std::to_string(GetJumpTarget(offset).value()) + ";";
+    }
+    std::string Binary(const std::string &type, size_t offset, const std::string &op) const
+    {
+      return Store(type, VarArg(offset, 0), Load(type, VarArg(offset, 1)) + " " + op + " " + Load(type, VarArg(offset, 2)));
+    }
+    std::string BinaryImm(const std::string &type, size_t offset, const std::string &op, const std::string &imm) const
+    {
+      return Store(type, VarArg(offset, 0), Load(type, VarArg(offset, 1)) + " " + op + " " + imm);
+    }
+    //divisions by 0 and by -1 (which can overflow) are left to the interpreter, it raises the script exceptions
+    std::string IntDivision(size_t offset, const std::string &op) const
+    {
+      return "{ int divider = " + Load("int", VarArg(offset, 2)) + "; if(divider == 0 || divider == -1) " + Exit(offset) + " " +
+        Store("int", VarArg(offset, 0), Load("int", VarArg(offset, 1)) + " " + op + " divider") + " }";
+    }
+    std::string FloatImm(size_t offset) const
+    {
+      return "FloatBits(" + Hex(DwordArg(offset, 1)) + ")";
+    }
+
+    void WriteInstr(std::ostream &out, size_t offset)
+    {
+      short a = VarArg(offset, 0);
+      std::string stmt;
+      switch(Op(offset))
+      {
+        case asBC_JitEntry: return;
+        case asBC_SUSPEND: stmt = "if(regs->doProcessSuspend) " + Exit(offset); break;
+        //integer arithmetic is done on unsigned values, it wraps around like in the interpreter without being undefined
+        case asBC_ADDi: stmt = Binary("asDWORD", offset, "+"); break;
+        case asBC_SUBi: stmt = Binary("asDWORD", offset, "-"); break;
+        case asBC_MULi: stmt = Binary("asDWORD", offset, "*"); break;
+        case asBC_BAND: stmt = Binary("asDWORD", offset, "&"); break;
+        case asBC_BOR: stmt = Binary("asDWORD", offset, "|"); break;
+        case asBC_BXOR: stmt = Binary("asDWORD", offset, "^"); break;
+        case asBC_BSLL: stmt = Binary("asDWORD", offset, "<<"); break;
+        case asBC_BSRL: stmt = Binary("asDWORD", offset, ">>"); break;
+        case asBC_BSRA: stmt = Store("int", a, Load("int", VarArg(offset, 1)) + " >> " + Load("asDWORD", VarArg(offset, 2))); break;
+        case asBC_DIVi: stmt = IntDivision(offset, "/"); break;
+        case asBC_MODi: stmt = IntDivision(offset, "%"); break;
+        case asBC_ADDIi: stmt = BinaryImm("asDWORD", offset, "+", Hex(DwordArg(offset, 1))); break;
+        case asBC_SUBIi: stmt = BinaryImm("asDWORD", offset, "-", Hex(DwordArg(offset, 1))); break;
+        case asBC_MULIi: stmt = BinaryImm("asDWORD", offset, "*", Hex(DwordArg(offset, 1))); break;
+        case asBC_NEGi: stmt = Store("asDWORD", a, "0u - " + Load("asDWORD", a)); break;
+        case asBC_IncVi: stmt = Store("asDWORD", a, Load("asDWORD", a) + " + 1u"); break;
+        case asBC_DecVi: stmt = Store("asDWORD", a, Load("asDWORD", a) + " - 1u"); break;
+        case asBC_ADDf: stmt = Binary("float", offset, "+"); break;
+        case asBC_SUBf: stmt = Binary("float", offset, "-"); break;
+        case asBC_MULf: stmt = Binary("float", offset, "*"); break;
+        case asBC_ADDd: stmt = Binary("double", offset, "+"); break;
+        case asBC_SUBd: stmt = Binary("double", offset, "-"); break;
+        case asBC_MULd: stmt = Binary("double", offset, "*"); break;
+        case asBC_DIVf:
+          stmt = "{ float divider = " + Load("float", VarArg(offset, 2)) + "; if(divider == 0) " + Exit(offset) + " " +
+            Store("float", a, Load("float", VarArg(offset, 1)) + " / divider") + " }";
+          break;
+        case asBC_ADDIf: stmt = BinaryImm("float", offset, "+", FloatImm(offset)); break;
+        case asBC_SUBIf: stmt = BinaryImm("float", offset, "-", FloatImm(offset)); break;
+        case asBC_MULIf: stmt = BinaryImm("float", offset, "*", FloatImm(offset)); break;
+        case asBC_NEGf: stmt = Store("float", a, "-" + Load("float", a)); break;
+        case asBC_iTOf: stmt = Store("float", a, "float(" + Load("int", a) + ")"); break;
+        case asBC_uTOf: stmt = Store("float", a, "float(" + Load("asDWORD", a) + ")"); break;
+        case asBC_fTOi: stmt = Store("int", a, "int(" + Load("float", a) + ")"); break;
+        case asBC_fTOd: stmt = Store("double", a, "double(" + Load("float", VarArg(offset, 1)) + ")"); break;
+        case asBC_dTOf: stmt = Store("float", a, "float(" + Load("double", VarArg(offset, 1)) + ")"); break;
+        case asBC_SetV1: case asBC_SetV4: stmt = Store("asDWORD", a, Hex(DwordArg(offset))); break;
+        case asBC_SetV8: stmt = Store("asQWORD", a, Hex(asBC_QWORDARG(&byte_code[offset])) + "ll"); break;
+        case asBC_CpyVtoV4: stmt = Store("asDWORD", a, Load("asDWORD", VarArg(offset, 1))); break;
+        case asBC_CpyVtoV8: stmt = Store("asQWORD", a, Load("asQWORD", VarArg(offset, 1))); break;
+        case asBC_CpyVtoR4: stmt = StoreRegister("asDWORD", Load("asDWORD", a)); break;
+        case asBC_CpyRtoV4: stmt = Store("asDWORD", a, LoadRegister("asDWORD")); break;
+        case asBC_PshV4: stmt = "Store<asDWORD>(--regs->stackPointer, " + Load("asDWORD", a) + ");"; break;
+        case asBC_PshC4: stmt = "Store<asDWORD>(--regs->stackPointer, " + Hex(DwordArg(offset)) + ");"; break;
+        case asBC_CMPi: stmt = Compare("int", Load("int", a), Load("int", VarArg(offset, 1))); break;
+        case asBC_CMPIi: stmt = Compare("int", Load("int", a), "int(" + Hex(DwordArg(offset)) + ")"); break;
+        case asBC_CMPu: stmt = Compare("asDWORD", Load("asDWORD", a), Load("asDWORD", VarArg(offset, 1))); break;
+        case asBC_CMPIu: stmt = Compare("asDWORD", Load("asDWORD", a), Hex(DwordArg(offset))); break;
+        case asBC_CMPf: stmt = Compare("float", Load("float", a), Load("float", VarArg(offset, 1))); break;
+        case asBC_CMPIf: stmt = Compare("float", Load("float", a), "FloatBits(" + Hex(DwordArg(offset)) + ")"); break;
+        case asBC_TZ: stmt = Test("=="); break;
+        case asBC_TNZ: stmt = Test("!="); break;
+        case asBC_TS: stmt = Test("<"); break;
+        case asBC_TNS: stmt = Test(">="); break;
+        case asBC_TP: stmt = Test(">"); break;
+        case asBC_TNP: stmt = Test("<="); break;
+        case asBC_NOT: stmt = Store("asDWORD", a, Load("asBYTE", a) + " == 0 ? 1 : 0"); break;
+        case asBC_JMP: stmt = "goto bc_" + std::to_string(GetJumpTarget(offset).value()) + ";"; break;
+        case asBC_JZ: stmt = Branch(offset, LoadRegister("int") + " == 0"); break;
+        case asBC_JNZ: stmt = Branch(offset, LoadRegister("int") + " != 0"); break;
+        case asBC_JS: stmt = Branch(offset, LoadRegister("int") + " < 0"); break;
+        case asBC_JNS: stmt = Branch(offset, LoadRegister("int") + " >= 0"); break;
+        case asBC_JP: stmt = Branch(offset, LoadRegister("int") + " > 0"); break;
+        case asBC_JNP: stmt = Branch(offset, LoadRegister("int") + " <= 0"); break;
+        case asBC_JLowZ: stmt = Branch(offset, LoadRegister("asBYTE") + " == 0"); break;
+        case asBC_JLowNZ: stmt = Branch(offset, LoadRegister("asBYTE") + " != 0"); break;
+        case asBC_CALLSYS: stmt = "if(!ls::AotCallSystem(regs, bc + " + std::to_string(offset) + ")) return;"; break;
+        default: break;
+      }
+      out << "    " << stmt << "\n";
+    }
+
+    const std::vector<asDWORD> &byte_code;
+    std::vector<size_t> offsets;
+  };
+
+  std::string GenerateAotTranslationUnit(uint64_t source_hash, const std::vector<unsigned char> &byte_code, const std::vector<AotFunctionCollector::Function> &functions)
+  {
+    //overloads can't be told apart by the linker if their declarations match, those stay interpreted
+    std::map<std::string, size_t> decl_counts;
+    for(const auto &function : functions)
+      decl_counts[function.decl]++;
+
+    std::stringstream out;
+    out << "//generated by LegitScript::GenerateAotSource(), do not edit\n";
+    out << "#include <angelscript.h>\n";
+    out << "#include <LegitScriptAot.h>\n";
+    out << "#include <cstring>\n\n";
+    out << "namespace\n";
+    out << "{\n";
+    out << "  float FloatBits(asDWORD bits)\n";
+    out << "  {\n";
+    out << "    float val;\n";
+    out << "    memcpy(&val, &bits, sizeof(val));\n";
+    out << "    return val;\n";
+    out << "  }\n\n";
+    //accessors of stack slots and the value register, see AotFunctionWriter::Load()
+    out << "  template<typename T>\n";
+    out << "  T Load(const void *ptr)\n";
+    out << "  {\n";
+    out << "    T val;\n";
+    out << "    memcpy(&val, ptr, sizeof(val));\n";
+    out << "    return val;\n";
+    out << "  }\n";
+    out << "  template<typename T>\n";
+    out << "  void Store(void *ptr, T val)\n";
+    out << "  {\n";
+    out << "    memcpy(ptr, &val, sizeof(val));\n";
+    out << "  }\n\n";
+    out << "  const unsigned char byte_code[] = {";
+    for(size_t byte_idx = 0; byte_idx < byte_code.size(); byte_idx++)
+      out << (byte_idx % 32 == 0 ? "\n    " : "") << int(byte_code[byte_idx]) << ",";
+    out << "\n  };\n\n";
+
+    std::vector<std::pair<const AotFunctionCollector::Function*, std::string>> written_functions;
+    for(const auto &function : functions)
+    {
+      AotFunctionWriter writer(function.byte_code);
+      if(decl_counts[function.decl] > 1 || writer.GetEntryOffsets().empty())
+        continue;
+      std::string func_name = "Function" + std::to_string(written_functions.size());
+      out << "  //" << function.decl << "\n";
+      writer.Write(out, func_name);
+      out << "\n";
+      written_functions.push_back({&function, func_name});
+    }
+
+    out << "  const ls::AotFunction functions[] = {\n";
+    for(const auto &written_function : written_functions)
+    {
+      std::stringstream decl;
+      decl << std::quoted(written_function.first->decl);
+      out << "    {" << decl.str() << ", " << written_function.first->byte_code.size() << ", " << written_function.second << "},\n";
+    }
+    if(written_functions.empty())
+      out << "    {nullptr, 0, nullptr},\n";
+    out << "  };\n";
+    out << "  const ls::AotRegistration registration({" << source_hash << "ull, byte_code, sizeof(byte_code), functions, " << written_functions.size() << "});\n";
+    out << "}\n";
+    return out.str();
+  }
+
+  AotFunctionLinker::AotFunctionLinker(const AotRenderGraph &render_graph, asIJITCompiler *fallback)
+    : fallback(fallback)
+  {
+    for(size_t func_idx = 0; func_idx < render_graph.functions_count; func_idx++)
+      functions[render_graph.functions[func_idx].decl] = &render_graph.functions[func_idx];
+  }
+
+  int AotFunctionLinker::CompileFunction(asIScriptFunction *function, asJITFunction *output)
+  {
+    asUINT length;
+    asDWORD *byte_code = function->GetByteCode(&length);
+    auto it = functions.find(GetAotFunctionDecl(function));
+    if(!byte_code || it == functions.end() || it->second->byte_code_length != length)
+      return fallback ? fallback->CompileFunction(function, output) : asNOT_SUPPORTED;
+
+    //entries are numbered in the order the generated function expects them
+    std::vector<asDWORD> byte_code_copy(byte_code, byte_code + length);
+    AotFunctionWriter writer(byte_code_copy);
+    auto entry_offsets = writer.GetEntryOffsets();
+    for(size_t entry_idx = 0; entry_idx < entry_offsets.size(); entry_idx++)
+      asBC_PTRARG(byte_code + entry_offsets[entry_idx]) = asPWORD(entry_idx + 1);
+    *output = reinterpret_cast<asJITFunction>(it->second->ptr);
+    linked_functions_count++;
+    return asSUCCESS;
+  }
+
+  void AotFunctionLinker::ReleaseJITFunction(asJITFunction func)
+  {
+    for(const auto &function : functions)
+    {
+      if(reinterpret_cast<asJITFunction>(function.second->ptr) == func)
+        return;
+    }
+    if(fallback)
+      fallback->ReleaseJITFunction(func);
+  }
+
+  size_t AotFunctionLinker::GetLinkedFunctionsCount() const
+  {
+    return linked_functions_count;
+  }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../include/LegitScriptAot.h"
+#include <angelscript.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ls
+{
+  //hash of the assembled render graph source and the functions registered on the engine
+  uint64_t GetAotSourceHash(asIScriptEngine *engine, const std::string &script_src);
+  const AotRenderGraph *FindAotRenderGraph(uint64_t source_hash);
+
+  //records the byte code of every function of a module while it's built with JitEntry instructions, without compiling anything
+  struct AotFunctionCollector : public asIJITCompiler
+  {
+    int CompileFunction(asIScriptFunction *function, asJITFunction *output) override;
+    void ReleaseJITFunction(asJITFunction func) override;
+
+    struct Function
+    {
+      std::string decl;
+      std::vector<asDWORD> byte_code;
+    };
+    std::vector<Function> functions;
+  };
+  //c++ translation unit registering the module byte code and the translated functions
+  std::string GenerateAotTranslationUnit(uint64_t source_hash, const std::vector<unsigned char> &byte_code, const std::vector<AotFunctionCollector::Function> &functions);
+
+  //installs the generated functions while the byte code of a registered render graph is loaded.
+  //functions without generated code are passed to the fallback compiler if there is one
+  struct AotFunctionLinker : public asIJITCompiler
+  {
+    AotFunctionLinker(const AotRenderGraph &render_graph, asIJITCompiler *fallback);
+    int CompileFunction(asIScriptFunction *function, asJITFunction *output) override;
+    void ReleaseJITFunction(asJITFunction func) override;
+    size_t GetLinkedFunctionsCount() const;
+  private:
+    std::map<std::string, const AotFunction*> functions;
+    asIJITCompiler *fallback;
+    size_t linked_functions_count = 0;
+  };
+}
@@ -0,0 +1,564 @@
+#include "ScriptJit.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define LS_SCRIPT_JIT_SUPPORTED 1
+#include <sys/mman.h>
+#endif
+
+//declared in angelscript's internal as_callfunc.h. asCContext derives from asIScriptContext alone, so the context
+//pointer kept in asSVMRegisters can be passed to it as is
+class asCContext;
+int CallSystemFunction(int id, asCContext *context);
+
+namespace ls
+{
+  asDWORD JitCallSystem(asSVMRegisters *regs, asDWORD *instr)
+  {
+    regs->programPointer = instr;
+    regs->stackPointer += CallSystemFunction(asBC_INTARG(instr), reinterpret_cast<asCContext*>(regs->ctx));
+    regs->programPointer = instr + 2;
+    return regs->ctx->GetState() == asEXECUTION_ACTIVE && !regs->doProcessSuspend;
+  }
+
+  bool IsJitSupported(asEBCInstr op)
+  {
+    switch(op)
+    {
+      case asBC_JitEntry: case asBC_SUSPEND:
+      case asBC_ADDi: case asBC_SUBi: case asBC_MULi: case asBC_DIVi: case asBC_MODi:
+      case asBC_ADDIi: case asBC_SUBIi: case asBC_MULIi: case asBC_NEGi: case asBC_IncVi: case asBC_DecVi:
+      case asBC_BAND: case asBC_BOR: case asBC_BXOR: case asBC_BSLL: case asBC_BSRL: case asBC_BSRA:
+      case asBC_ADDf: case asBC_SUBf: case asBC_MULf: case asBC_DIVf:
+      case asBC_ADDIf: case asBC_SUBIf: case asBC_MULIf: case asBC_NEGf:
+      case asBC_ADDd: case asBC_SUBd: case asBC_MULd:
+      case asBC_iTOf: case asBC_uTOf: case asBC_fTOi: case asBC_fTOd: case asBC_dTOf:
+      case asBC_SetV1: case asBC_SetV4: case asBC_SetV8: case asBC_CpyVtoV4: case asBC_CpyVtoV8:
+      case asBC_CpyVtoR4: case asBC_CpyRtoV4: case asBC_PshV4: case asBC_PshC4:
+      case asBC_CMPi: case asBC_CMPIi: case asBC_CMPu: case asBC_CMPIu: case asBC_CMPf: case asBC_CMPIf:
+      case asBC_TZ: case asBC_TNZ: case asBC_TS: case asBC_TNS: case asBC_TP: case asBC_TNP: case asBC_NOT:
+      case asBC_JMP: case asBC_JZ: case asBC_JNZ: case asBC_JS: case asBC_JNS: case asBC_JP: case asBC_JNP:
+      case asBC_JLowZ: case asBC_JLowNZ:
+      case asBC_CALLSYS:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+#if LS_SCRIPT_JIT_SUPPORTED
+  //register allocation of the generated code: rbx holds the asSVMRegisters pointer and rbp the script frame pointer,
+  //both are callee-saved so they survive calls into the engine. eax, ecx, edx and xmm0-xmm2 are scratch
+  struct NativeCode
+  {
+    std::vector<uint8_t> bytes;
+
+    void Emit(std::initializer_list<uint8_t> new_bytes)
+    {
+      bytes.insert(bytes.end(), new_bytes);
+    }
+    void EmitDword(uint32_t val)
+    {
+      for(size_t i = 0; i < 4; i++)
+        bytes.push_back(uint8_t(val >> (i * 8)));
+    }
+    void EmitQword(uint64_t val)
+    {
+      EmitDword(uint32_t(val));
+      EmitDword(uint32_t(val >> 32));
+    }
+    //modrm of a [rbp + disp32] operand. script variables live at fp - 4 * var_offset
+    void EmitVar(uint8_t reg, short var_offset)
+    {
+      Emit({uint8_t(0x85 | (reg << 3))});
+      EmitDword(uint32_t(-4 * int(var_offset)));
+    }
+    //modrm of a [rbx + disp32] operand, a field of asSVMRegisters
+    void EmitReg(uint8_t reg, size_t field_offset)
+    {
+      Emit({uint8_t(0x83 | (reg << 3))});
+      EmitDword(uint32_t(field_offset));
+    }
+    //returns the position of the rel32 operand to patch once the target is known
+    size_t EmitRel32()
+    {
+      EmitDword(0);
+      return bytes.size() - 4;
+    }
+    void PatchRel32(size_t pos, size_t target)
+    {
+      uint32_t rel = uint32_t(int64_t(target) - int64_t(pos + 4));
+      memcpy(bytes.data() + pos, &rel, 4);
+    }
+  };
+
+  const uint8_t eax = 0, ecx = 1, edx = 2;
+  const uint8_t xmm0 = 0, xmm1 = 1;
+  const size_t program_pointer_offset = offsetof(asSVMRegisters, programPointer);
+  const size_t frame_pointer_offset = offsetof(asSVMRegisters, stackFramePointer);
+  const size_t stack_pointer_offset = offsetof(asSVMRegisters, stackPointer);
+  const size_t value_register_offset = offsetof(asSVMRegisters, valueRegister);
+  const size_t process_suspend_offset = offsetof(asSVMRegisters, doProcessSuspend);
+
+  short VarArg(asDWORD *instr, size_t arg_idx)
+  {
+    return *(reinterpret_cast<short*>(instr) + 1 + arg_idx);
+  }
+
+  struct FunctionCompiler
+  {
+    FunctionCompiler(asDWORD *byte_code, asUINT length)
+    {
+      for(asDWORD *instr = byte_code; instr < byte_code + length; instr += asBCTypeSize[asBCInfo[Op(instr)].type])
+      {
+        instr_indices[instr] = instrs.size();
+        instrs.push_back(instr);
+      }
+    }
+
+    //returns the native offsets of the supported instructions, indexed like instrs
+    std::vector<std::optional<size_t>> Compile()
+    {
+      native_offsets.assign(instrs.size(), std::nullopt);
+      //prologue: push rbx; push rbp; sub rsp, 8 (keeps calls 16-byte aligned); mov rbx, rdi; mov rbp, [rbx + fp]; jmp rsi
+      code.Emit({0x53, 0x55, 0x48, 0x83, 0xEC, 0x08, 0x48, 0x89, 0xFB, 0x48, 0x8B});
+      code.EmitReg(5, frame_pointer_offset);
+      code.Emit({0xFF, 0xE6});
+
+      for(size_t instr_idx = 0; instr_idx < instrs.size(); instr_idx++)
+      {
+        asDWORD *instr = instrs[instr_idx];
+        if(!IsJitSupported(Op(instr)))
+          continue;
+        native_offsets[instr_idx] = code.bytes.size();
+        EmitInstr(instr);
+        //falling through into an instruction the interpreter has to execute
+        bool is_next_supported = instr_idx + 1 < instrs.size() && IsJitSupported(Op(instrs[instr_idx + 1]));
+        if(Op(instr) != asBC_JMP && !is_next_supported)
+        {
+          code.Emit({0xE9});
+          jumps.push_back({code.EmitRel32(), instr + asBCTypeSize[asBCInfo[Op(instr)].type], false});
+        }
+      }
+
+      for(const auto &jump : jumps)
+      {
+        auto it = instr_indices.find(jump.target);
+        if(!jump.is_exit && it != instr_indices.end() && native_offsets[it->second])
+          code.PatchRel32(jump.rel32_pos, native_offsets[it->second].value());
+        else
+          code.PatchRel32(jump.rel32_pos, GetExitStub(jump.target));
+      }
+      return native_offsets;
+    }
+
+    static asEBCInstr Op(asDWORD *instr)
+    {
+      return asEBCInstr(*reinterpret_cast<asBYTE*>(instr));
+    }
+
+    std::vector<asDWORD*> instrs;
+    std::map<asDWORD*, size_t> instr_indices;
+    NativeCode code;
+  private:
+    //returns to the interpreter, which continues at the given instruction
+    size_t GetExitStub(asDWORD *target)
+    {
+      auto it = exit_stubs.find(target);
+      if(it != exit_stubs.end())
+        return it->second;
+      size_t offset = code.bytes.size();
+      //mov rax, target; mov [rbx + pp], rax; add rsp, 8; pop rbp; pop rbx; ret
+      code.Emit({0x48, 0xB8});
+      code.EmitQword(uint64_t(target));
+      code.Emit({0x48, 0x89});
+      code.EmitReg(eax, program_pointer_offset);
+      code.Emit({0x48, 0x83, 0xC4, 0x08, 0x5D, 0x5B, 0xC3});
+      exit_stubs[target] = offset;
+      return offset;
+    }
+    void EmitJump(std::initializer_list<uint8_t> opcode, asDWORD *target)
+    {
+      code.Emit(opcode);
+      jumps.push_back({code.EmitRel32(), target, false});
+    }
+    //leaves the native code even when the target instruction has native code, the interpreter has to execute it
+    void EmitExit(std::initializer_list<uint8_t> opcode, asDWORD *target)
+    {
+      code.Emit(opcode);
+      jumps.push_back({code.EmitRel32(), target, true});
+    }
+    void EmitVarOp(std::initializer_list<uint8_t> opcode, uint8_t reg, short var_offset)
+    {
+      code.Emit(opcode);
+      code.EmitVar(reg, var_offset);
+    }
+    void EmitRegOp(std::initializer_list<uint8_t> opcode, uint8_t reg, size_t field_offset)
+    {
+      code.Emit(opcode);
+      code.EmitReg(reg, field_offset);
+    }
+    //valueRegister = ecx - edx, after the two flags of a comparison were set in ecx and edx
+    void EmitCompareResult(uint8_t greater_setcc, uint8_t less_setcc)
+    {
+      code.Emit({0x0F, greater_setcc, 0xC1, 0x0F, less_setcc, 0xC2, 0x0F, 0xB6, 0xC9, 0x0F, 0xB6, 0xD2, 0x29, 0xD1});
+      EmitRegOp({0x89}, ecx, value_register_offset);
+    }
+    //valueRegister = 0, -1 or 1 after ucomiss. unordered values compare as greater, like in the interpreter
+    void EmitFloatCompareResult()
+    {
+      //mov ecx, 1; jp done; mov edx, 0; cmove ecx, edx; mov edx, -1; cmovb ecx, edx; done:
+      code.Emit({0xB9, 0x01, 0x00, 0x00, 0x00, 0x7A, 0x10});
+      code.Emit({0xBA, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x44, 0xCA});
+      code.Emit({0xBA, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 0x42, 0xCA});
+      EmitRegOp({0x89}, ecx, value_register_offset);
+    }
+    //valueRegister = (int(valueRegister) <cond> 0) as a bool extended to the whole register
+    void EmitTest(uint8_t setcc)
+    {
+      EmitRegOp({0x8B}, eax, value_register_offset);
+      code.Emit({0x85, 0xC0, 0x0F, setcc, 0xC0, 0x0F, 0xB6, 0xC0});
+      EmitRegOp({0x48, 0x89}, eax, value_register_offset);
+    }
+    void EmitConditionalJump(uint8_t jcc, asDWORD *instr)
+    {
+      EmitRegOp({0x8B}, eax, value_register_offset);
+      code.Emit({0x85, 0xC0});
+      EmitJump({0x0F, jcc}, instr + 2 + asBC_INTARG(instr));
+    }
+    void EmitIntBinaryOp(std::initializer_list<uint8_t> opcode, asDWORD *instr)
+    {
+      EmitVarOp({0x8B}, eax, VarArg(instr, 1));
+      EmitVarOp(opcode, eax, VarArg(instr, 2));
+      EmitVarOp({0x89}, eax, VarArg(instr, 0));
+    }
+    void EmitShift(uint8_t modrm, asDWORD *instr)
+    {
+      EmitVarOp({0x8B}, eax, VarArg(instr, 1));
+      EmitVarOp({0x8B}, ecx, VarArg(instr, 2));
+      code.Emit({0xD3, modrm});
+      EmitVarOp({0x89}, eax, VarArg(instr, 0));
+    }
+    //divisions by 0 and by -1 (which can overflow) are left to the interpreter, it raises the script exceptions
+    void EmitIntDivision(uint8_t result_reg, asDWORD *instr)
+    {
+      EmitVarOp({0x8B}, ecx, VarArg(instr, 2));
+      code.Emit({0x85, 0xC9});
+      EmitExit({0x0F, 0x84}, instr);
+      code.Emit({0x83, 0xF9, 0xFF});
+      EmitExit({0x0F, 0x84}, instr);
+      EmitVarOp({0x8B}, eax, VarArg(instr, 1));
+      code.Emit({0x99, 0xF7, 0xF9});
+      EmitVarOp({0x89}, result_reg, VarArg(instr, 0));
+    }
+    void EmitFloatBinaryOp(uint8_t prefix, uint8_t opcode, asDWORD *instr)
+    {
+      EmitVarOp({prefix, 0x0F, 0x10}, xmm0, VarArg(instr, 1));
+      EmitVarOp({prefix, 0x0F, opcode}, xmm0, VarArg(instr, 2));
+      EmitVarOp({prefix, 0x0F, 0x11}, xmm0, VarArg(instr, 0));
+    }
+    void EmitFloatImmOp(uint8_t opcode, asDWORD *instr)
+    {
+      EmitVarOp({0xF3, 0x0F, 0x10}, xmm0, VarArg(instr, 1));
+      //mov eax, imm; movd xmm1, eax; op xmm0, xmm1
+      code.Emit({0xB8});
+      code.EmitDword(instr[2]);
+      code.Emit({0x66, 0x0F, 0x6E, 0xC8, 0xF3, 0x0F, opcode, 0xC1});
+      EmitVarOp({0xF3, 0x0F, 0x11}, xmm0, VarArg(instr, 0));
+    }
+    void EmitPush()
+    {
+      //mov rax, [rbx + sp]; sub rax, 4; mov [rbx + sp], rax
+      EmitRegOp({0x48, 0x8B}, eax, stack_pointer_offset);
+      code.Emit({0x48, 0x83, 0xE8, 0x04});
+      EmitRegOp({0x48, 0x89}, eax, stack_pointer_offset);
+    }
+
+    void EmitInstr(asDWORD *instr)
+    {
+      switch(Op(instr))
+      {
+        case asBC_JitEntry: break;
+        case asBC_SUSPEND:
+        {
+          //cmp byte [rbx + doProcessSuspend], 0; jne <interpreter executes the suspend>
+          EmitRegOp({0x80}, 7, process_suspend_offset);
+          code.Emit({0x00});
+          EmitExit({0x0F, 0x85}, instr);
+        }break;
+        case asBC_ADDi: EmitIntBinaryOp({0x03}, instr); break;
+        case asBC_SUBi: EmitIntBinaryOp({0x2B}, instr); break;
+        case asBC_MULi: EmitIntBinaryOp({0x0F, 0xAF}, instr); break;
+        case asBC_BAND: EmitIntBinaryOp({0x23}, instr); break;
+        case asBC_BOR: EmitIntBinaryOp({0x0B}, instr); break;
+        case asBC_BXOR: EmitIntBinaryOp({0x33}, instr); break;
+        case asBC_BSLL: EmitShift(0xE0, instr); break;
+        case asBC_BSRL: EmitShift(0xE8, instr); break;
+        case asBC_BSRA: EmitShift(0xF8, instr); break;
+        case asBC_DIVi: EmitIntDivision(eax, instr); break;
+        case asBC_MODi: EmitIntDivision(edx, instr); break;
+        case asBC_ADDIi: case asBC_SUBIi: case asBC_MULIi:
+        {
+          EmitVarOp({0x8B}, eax, VarArg(instr, 1));
+          if(Op(instr) == asBC_ADDIi) code.Emit({0x05});
+          if(Op(instr) == asBC_SUBIi) code.Emit({0x2D});
+          if(Op(instr) == asBC_MULIi) code.Emit({0x69, 0xC0});
+          code.EmitDword(instr[2]);
+          EmitVarOp({0x89}, eax, VarArg(instr, 0));
+        }break;
+        case asBC_NEGi: EmitVarOp({0xF7}, 3, VarArg(instr, 0)); break;
+        case asBC_IncVi: EmitVarOp({0xFF}, 0, VarArg(instr, 0)); break;
+        case asBC_DecVi: EmitVarOp({0xFF}, 1, VarArg(instr, 0)); break;
+        case asBC_ADDf: EmitFloatBinaryOp(0xF3, 0x58, instr); break;
+        case asBC_SUBf: EmitFloatBinaryOp(0xF3, 0x5C, instr); break;
+        case asBC_MULf: EmitFloatBinaryOp(0xF3, 0x59, instr); break;
+        case asBC_ADDd: EmitFloatBinaryOp(0xF2, 0x58, instr); break;
+        case asBC_SUBd: EmitFloatBinaryOp(0xF2, 0x5C, instr); break;
+        case asBC_MULd: EmitFloatBinaryOp(0xF2, 0x59, instr); break;
+        case asBC_DIVf:
+        {
+          //movss xmm1, divider; xorps xmm2, xmm2; ucomiss xmm1, xmm2; jp nonzero; je <interpreter raises the exception>
+          EmitVarOp({0xF3, 0x0F, 0x10}, xmm1, VarArg(instr, 2));
+          code.Emit({0x0F, 0x57, 0xD2, 0x0F, 0x2E, 0xCA, 0x7A, 0x06});
+          EmitExit({0x0F, 0x84}, instr);
+          EmitVarOp({0xF3, 0x0F, 0x10}, xmm0, VarArg(instr, 1));
+          code.Emit({0xF3, 0x0F, 0x5E, 0xC1});
+          EmitVarOp({0xF3, 0x0F, 0x11}, xmm0, VarArg(instr, 0));
+        }break;
+        case asBC_ADDIf: EmitFloatImmOp(0x58, instr); break;
+        case asBC_SUBIf: EmitFloatImmOp(0x5C, instr); break;
+        case asBC_MULIf: EmitFloatImmOp(0x59, instr); break;
+        case asBC_NEGf:
+        {
+          EmitVarOp({0x81}, 6, VarArg(instr, 0));
+          code.EmitDword(0x80000000);
+        }break;
+        case asBC_iTOf:
+        {
+          EmitVarOp({0xF3, 0x0F, 0x2A}, xmm0, VarArg(instr, 0));
+          EmitVarOp({0xF3, 0x0F, 0x11}, xmm0, VarArg(instr, 0));
+        }break;
+        case asBC_uTOf:
+        {
+          //the 32 bit load zero-extends rax, so the 64 bit conversion sees the unsigned value
+          EmitVarOp({0x8B}, eax, VarArg(instr, 0));
+          code.Emit({0xF3, 0x48, 0x0F, 0x2A, 0xC0});
+          EmitVarOp({0xF3, 0x0F, 0x11}, xmm0, VarArg(instr, 0));
+        }break;
+        case asBC_fTOi:
+        {
+          EmitVarOp({0xF3, 0x0F, 0x2C}, eax, VarArg(instr, 0));
+          EmitVarOp({0x89}, eax, VarArg(instr, 0));
+        }break;
+        case asBC_fTOd:
+        {
+          EmitVarOp({0xF3, 0x0F, 0x5A}, xmm0, VarArg(instr, 1));
+          EmitVarOp({0xF2, 0x0F, 0x11}, xmm0, VarArg(instr, 0));
+        }break;
+        case asBC_dTOf:
+        {
+          EmitVarOp({0xF2, 0x0F, 0x5A}, xmm0, VarArg(instr, 1));
+          EmitVarOp({0xF3, 0x0F, 0x11}, xmm0, VarArg(instr, 0));
+        }break;
+        case asBC_SetV1: case asBC_SetV4:
+        {
+          EmitVarOp({0xC7}, 0, VarArg(instr, 0));
+          code.EmitDword(instr[1]);
+        }break;
+        case asBC_SetV8:
+        {
+          code.Emit({0x48, 0xB8});
+          code.EmitQword(asBC_QWORDARG(instr));
+          EmitVarOp({0x48, 0x89}, eax, VarArg(instr, 0));
+        }break;
+        case asBC_CpyVtoV4:
+        {
+          EmitVarOp({0x8B}, eax, VarArg(instr, 1));
+          EmitVarOp({0x89}, eax, VarArg(instr, 0));
+        }break;
+        case asBC_CpyVtoV8:
+        {
+          EmitVarOp({0x48, 0x8B}, eax, VarArg(instr, 1));
+          EmitVarOp({0x48, 0x89}, eax, VarArg(instr, 0));
+        }break;
+        case asBC_CpyVtoR4:
+        {
+          EmitVarOp({0x8B}, eax, VarArg(instr, 0));
+          EmitRegOp({0x89}, eax, value_register_offset);
+        }break;
+        case asBC_CpyRtoV4:
+        {
+          EmitRegOp({0x8B}, eax, value_register_offset);
+          EmitVarOp({0x89}, eax, VarArg(instr, 0));
+        }break;
+        case asBC_PshV4:
+        {
+          EmitPush();
+          EmitVarOp({0x8B}, ecx, VarArg(instr, 0));
+          code.Emit({0x89, 0x08});
+        }break;
+        case asBC_PshC4:
+        {
+          EmitPush();
+          code.Emit({0xC7, 0x00});
+          code.EmitDword(instr[1]);
+        }break;
+        case asBC_CMPi: case asBC_CMPu:
+        {
+          EmitVarOp({0x8B}, eax, VarArg(instr, 0));
+          EmitVarOp({0x3B}, eax, VarArg(instr, 1));
+          if(Op(instr) == asBC_CMPi) EmitCompareResult(0x9F, 0x9C); else EmitCompareResult(0x97, 0x92);
+        }break;
+        case asBC_CMPIi: case asBC_CMPIu:
+        {
+          EmitVarOp({0x8B}, eax, VarArg(instr, 0));
+          code.Emit({0x3D});
+          code.EmitDword(instr[1]);
+          if(Op(instr) == asBC_CMPIi) EmitCompareResult(0x9F, 0x9C); else EmitCompareResult(0x97, 0x92);
+        }break;
+        case asBC_CMPf:
+        {
+          EmitVarOp({0xF3, 0x0F, 0x10}, xmm0, VarArg(instr, 0));
+          EmitVarOp({0x0F, 0x2E}, xmm0, VarArg(instr, 1));
+          EmitFloatCompareResult();
+        }break;
+        case asBC_CMPIf:
+        {
+          EmitVarOp({0xF3, 0x0F, 0x10}, xmm0, VarArg(instr, 0));
+          code.Emit({0xB8});
+          code.EmitDword(instr[1]);
+          code.Emit({0x66, 0x0F, 0x6E, 0xC8, 0x0F, 0x2E, 0xC1});
+          EmitFloatCompareResult();
+        }break;
+        case asBC_TZ: EmitTest(0x94); break;
+        case asBC_TNZ: EmitTest(0x95); break;
+        case asBC_TS: EmitTest(0x9C); break;
+        case asBC_TNS: EmitTest(0x9D); break;
+        case asBC_TP: EmitTest(0x9F); break;
+        case asBC_TNP: EmitTest(0x9E); break;
+        case asBC_NOT:
+        {
+          //only the low byte holds the bool, the result fills the whole dword
+          EmitVarOp({0x0F, 0xB6}, eax, VarArg(instr, 0));
+          code.Emit({0x85, 0xC0, 0x0F, 0x94, 0xC0, 0x0F, 0xB6, 0xC0});
+          EmitVarOp({0x89}, eax, VarArg(instr, 0));
+        }break;
+        case asBC_JMP: EmitJump({0xE9}, instr + 2 + asBC_INTARG(instr)); break;
+        case asBC_JZ: EmitConditionalJump(0x84, instr); break;
+        case asBC_JNZ: EmitConditionalJump(0x85, instr); break;
+        case asBC_JS: EmitConditionalJump(0x8C, instr); break;
+        case asBC_JNS: EmitConditionalJump(0x8D, instr); break;
+        case asBC_JP: EmitConditionalJump(0x8F, instr); break;
+        case asBC_JNP: EmitConditionalJump(0x8E, instr); break;
+        case asBC_JLowZ: case asBC_JLowNZ:
+        {
+          EmitRegOp({0x0F, 0xB6}, eax, value_register_offset);
+          code.Emit({0x85, 0xC0});
+          EmitJump({0x0F, uint8_t(Op(instr) == asBC_JLowZ ? 0x84 : 0x85)}, instr + 2 + asBC_INTARG(instr));
+        }break;
+        case asBC_CALLSYS:
+        {
+          //mov rdi, rbx; mov rsi, instr; mov rax, JitCallSystem; call rax; test eax, eax; je <interpreter continues after the call>
+          code.Emit({0x48, 0x89, 0xDF, 0x48, 0xBE});
+          code.EmitQword(uint64_t(instr));
+          code.Emit({0x48, 0xB8});
+          code.EmitQword(uint64_t(&JitCallSystem));
+          code.Emit({0xFF, 0xD0, 0x85, 0xC0});
+          EmitExit({0x0F, 0x84}, instr + 2);
+        }break;
+        default: break;
+      }
+    }
+
+    struct Jump
+    {
+      size_t rel32_pos;
+      asDWORD *target;
+      bool is_exit;
+    };
+    std::vector<Jump> jumps;
+    std::vector<std::optional<size_t>> native_offsets;
+    std::map<asDWORD*, size_t> exit_stubs;
+  };
+#endif
+
+  std::unique_ptr<ScriptJit> ScriptJit::Create()
+  {
+#if LS_SCRIPT_JIT_SUPPORTED
+    return std::unique_ptr<ScriptJit>(new ScriptJit());
+#else
+    return nullptr;
+#endif
+  }
+
+  ScriptJit::~ScriptJit()
+  {
+#if LS_SCRIPT_JIT_SUPPORTED
+    for(const auto &code_block : code_blocks)
+      munmap(code_block.second.ptr, code_block.second.size);
+#endif
+  }
+
+  int ScriptJit::CompileFunction(asIScriptFunction *function, asJITFunction *output)
+  {
+#if LS_SCRIPT_JIT_SUPPORTED
+    asUINT length;
+    asDWORD *byte_code = function->GetByteCode(&length);
+    if(!byte_code)
+      return asNOT_SUPPORTED;
+    FunctionCompiler compiler(byte_code, length);
+    auto native_offsets = compiler.Compile();
+
+    //the interpreter enters the native code at JitEntry instructions whose argument is set
+    std::vector<std::pair<asDWORD*, size_t>> entries;
+    for(size_t instr_idx = 0; instr_idx + 1 < compiler.instrs.size(); instr_idx++)
+    {
+      if(FunctionCompiler::Op(compiler.instrs[instr_idx]) == asBC_JitEntry && native_offsets[instr_idx + 1])
+        entries.push_back({compiler.instrs[instr_idx], native_offsets[instr_idx + 1].value()});
+    }
+    if(entries.empty())
+      return asNOT_SUPPORTED;
+
+    const auto &bytes = compiler.code.bytes;
+    void *ptr = mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ptr == MAP_FAILED)
+      return asOUT_OF_MEMORY;
+    memcpy(ptr, bytes.data(), bytes.size());
+    if(mprotect(ptr, bytes.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+      munmap(ptr, bytes.size());
+      return asERROR;
+    }
+    for(const auto &entry : entries)
+      asBC_PTRARG(entry.first) = asPWORD(static_cast<uint8_t*>(ptr) + entry.second);
+
+    *output = reinterpret_cast<asJITFunction>(ptr);
+    code_blocks[*output] = {ptr, bytes.size()};
+    return asSUCCESS;
+#else
+    return asNOT_SUPPORTED;
+#endif
+  }
+
+  void ScriptJit::ReleaseJITFunction(asJITFunction func)
+  {
+#if LS_SCRIPT_JIT_SUPPORTED
+    auto it = code_blocks.find(func);
+    if(it == code_blocks.end())
+      return;
+    munmap(it->second.ptr, it->second.size);
+    code_blocks.erase(it);
+#endif
+  }
+
+  size_t ScriptJit::GetCompiledFunctionsCount() const
+  {
+    return code_blocks.size();
+  }
+}
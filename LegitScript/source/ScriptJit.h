@@ -0,0 +1,36 @@
+#pragma once
+#include <angelscript.h>
+#include <map>
+#include <memory>
+
+namespace ls
+{
+  //translates the integer/float arithmetic, local variable, branch and registered function call instructions of script
+  //functions to native code. any other instruction leaves the native code with the program pointer on it, the interpreter
+  //executes it and re-enters the native code at the next JitEntry instruction.
+  //only x86-64 Linux is supported, Create() returns nullptr everywhere else.
+  //compiled code is owned by the jit, so it has to outlive the engines it's set on
+  struct ScriptJit : public asIJITCompiler
+  {
+    static std::unique_ptr<ScriptJit> Create();
+    ~ScriptJit();
+    int CompileFunction(asIScriptFunction *function, asJITFunction *output) override;
+    void ReleaseJITFunction(asJITFunction func) override;
+    //functions with native code that haven't been released yet
+    size_t GetCompiledFunctionsCount() const;
+  private:
+    ScriptJit() = default;
+    struct CodeBlock
+    {
+      void *ptr;
+      size_t size;
+    };
+    std::map<asJITFunction, CodeBlock> code_blocks;
+  };
+
+  //same as the interpreter's asBC_CALLSYS for native code entered from the interpreter. returns 0 when the native code
+  //has to give control back: after an exception, or when a suspend or a line callback is pending
+  asDWORD JitCallSystem(asSVMRegisters *regs, asDWORD *instr);
+  //instructions that run natively, everything else is left to the interpreter
+  bool IsJitSupported(asEBCInstr op);
+}
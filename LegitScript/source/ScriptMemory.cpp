@@ -0,0 +1,172 @@
+#include "ScriptMemory.h"
+#include <angelscript.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+namespace ls
+{
+  thread_local ScriptMemoryCounters script_memory_counters;
+
+  struct ArenaBlock
+  {
+    //one reference per live allocation, plus one held by the arena while it bumps from the block
+    std::atomic<size_t> refs_count;
+    const void *owner;
+    size_t capacity;
+    //set by the owner when it drops its reference and moves on to another block
+    bool is_detached;
+  };
+  //precedes every allocation, the block is null for heap allocations and the size is only kept for them. keeps the memory
+  //after it 16 byte aligned
+  struct alignas(16) AllocationHeader
+  {
+    ArenaBlock *block;
+    size_t size;
+  };
+  const size_t block_header_size = (sizeof(ArenaBlock) + 15) / 16 * 16;
+  const size_t min_block_size = 64 * 1024;
+  const size_t max_block_size = 4 * 1024 * 1024;
+  //larger allocations would waste most of a block when the rest of the frame doesn't fit next to them
+  const size_t max_arena_allocation_size = 256 * 1024;
+  //detached blocks can be freed on any thread
+  std::atomic<size_t> arena_pinned_bytes(0);
+
+  void ReleaseBlock(ArenaBlock *block)
+  {
+    if(block->refs_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      if(block->is_detached)
+        arena_pinned_bytes.fetch_sub(block->capacity, std::memory_order_relaxed);
+      block->~ArenaBlock();
+      free(block);
+    }
+  }
+  //the block is pinned by its live allocations from now on, or freed right away when there are none
+  void DetachBlock(ArenaBlock *block)
+  {
+    block->is_detached = true;
+    arena_pinned_bytes.fetch_add(block->capacity, std::memory_order_relaxed);
+    ReleaseBlock(block);
+  }
+
+  struct FrameArena
+  {
+    ~FrameArena()
+    {
+      if(this->block)
+        DetachBlock(this->block);
+    }
+    ArenaBlock *block = nullptr;
+    size_t offset = 0;
+    size_t scopes_count = 0;
+    //grows every time a frame runs out of its block, unless the last frame retained its block
+    size_t block_size = min_block_size;
+    bool is_retaining = false;
+  };
+  thread_local FrameArena frame_arena;
+
+  void *HeapAlloc(size_t size)
+  {
+    auto *header = static_cast<AllocationHeader*>(malloc(sizeof(AllocationHeader) + size));
+    if(!header)
+      return nullptr;
+    header->block = nullptr;
+    header->size = size;
+    script_memory_counters.allocations_count++;
+    script_memory_counters.allocated_bytes += size;
+    return header + 1;
+  }
+
+  void *FrameArenaAlloc(size_t size)
+  {
+    FrameArena &arena = frame_arena;
+    size_t total_size = (sizeof(AllocationHeader) + size + 15) / 16 * 16;
+    if(arena.scopes_count == 0 || total_size > max_arena_allocation_size)
+      return HeapAlloc(size);
+    if(!arena.block || arena.offset + total_size > arena.block->capacity)
+    {
+      if(arena.block)
+      {
+        if(!arena.is_retaining)
+          arena.block_size = std::min(arena.block_size * 2, max_block_size);
+        DetachBlock(arena.block);
+      }
+      void *block_ptr = malloc(block_header_size + arena.block_size);
+      if(!block_ptr)
+      {
+        arena.block = nullptr;
+        return HeapAlloc(size);
+      }
+      arena.block = new(block_ptr) ArenaBlock();
+      arena.block->refs_count.store(1, std::memory_order_relaxed);
+      arena.block->owner = &arena;
+      arena.block->capacity = arena.block_size;
+      arena.block->is_detached = false;
+      arena.offset = 0;
+    }
+    auto *header = reinterpret_cast<AllocationHeader*>(reinterpret_cast<char*>(arena.block) + block_header_size + arena.offset);
+    arena.offset += total_size;
+    arena.block->refs_count.fetch_add(1, std::memory_order_relaxed);
+    header->block = arena.block;
+    script_memory_counters.arena_allocations_count++;
+    script_memory_counters.arena_allocated_bytes += size;
+    return header + 1;
+  }
+  void FrameArenaFree(void *ptr)
+  {
+    if(!ptr)
+      return;
+    auto *header = static_cast<AllocationHeader*>(ptr) - 1;
+    if(!header->block)
+    {
+      script_memory_counters.freed_bytes += header->size;
+      free(header);
+      return;
+    }
+    if(header->block->owner != &frame_arena)
+      script_memory_counters.arena_remote_frees_count++;
+    ReleaseBlock(header->block);
+  }
+
+  FrameArenaScope::FrameArenaScope(bool is_enabled) : is_enabled(is_enabled)
+  {
+    if(is_enabled)
+      frame_arena.scopes_count++;
+  }
+  FrameArenaScope::~FrameArenaScope()
+  {
+    if(!is_enabled)
+      return;
+    FrameArena &arena = frame_arena;
+    if(--arena.scopes_count > 0 || !arena.block)
+      return;
+    //only the arena's own reference is left, nothing allocated during the frame is alive anymore
+    if(arena.block->refs_count.load(std::memory_order_acquire) == 1)
+    {
+      arena.offset = 0;
+      arena.is_retaining = false;
+      return;
+    }
+    script_memory_counters.arena_retained_blocks_count++;
+    DetachBlock(arena.block);
+    arena.block = nullptr;
+    arena.block_size = min_block_size;
+    arena.is_retaining = true;
+  }
+
+  void InstallScriptMemoryFunctions()
+  {
+    static std::once_flag install_flag;
+    std::call_once(install_flag, [](){
+      asSetGlobalMemoryFunctions(FrameArenaAlloc, FrameArenaFree);
+    });
+  }
+  ScriptMemoryCounters GetScriptMemoryCounters()
+  {
+    ScriptMemoryCounters counters = script_memory_counters;
+    counters.arena_pinned_bytes = arena_pinned_bytes.load(std::memory_order_relaxed);
+    return counters;
+  }
+}
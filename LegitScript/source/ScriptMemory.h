@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+namespace ls
+{
+  //counters of the allocations made by angelscript on the calling thread
+  struct ScriptMemoryCounters
+  {
+    //heap allocations, including the ones made while a frame arena is active but that don't fit in it
+    size_t allocations_count = 0;
+    size_t allocated_bytes = 0;
+    //heap bytes freed by this thread. allocated_bytes - freed_bytes is the live memory of the thread's allocations as
+    //long as they are freed on the same thread
+    size_t freed_bytes = 0;
+    //allocations bumped from the frame arena, FrameAllocator ones included
+    size_t arena_allocations_count = 0;
+    size_t arena_allocated_bytes = 0;
+    //arena blocks that still had live allocations when their frame ended, each is freed along with its last allocation
+    size_t arena_retained_blocks_count = 0;
+    //bytes of arena blocks that the arena moved on from while allocations in them were still alive, retained blocks
+    //included. counted over all threads
+    size_t arena_pinned_bytes = 0;
+    //arena allocations freed by this thread that another thread made. these are the only arena operations that touch
+    //memory shared with other threads
+    size_t arena_remote_frees_count = 0;
+  };
+
+  //routes angelscript's allocations through counting wrappers. has to be called before the first engine is created
+  void InstallScriptMemoryFunctions();
+  ScriptMemoryCounters GetScriptMemoryCounters();
+
+  //while an enabled scope is alive, angelscript and FrameAllocator allocations made on the calling thread are bumped
+  //from a thread local arena. when the outermost scope ends, the arena is rewound if everything allocated from it was
+  //freed. otherwise its block is left to the allocations that outlived the frame and the next frame starts a new one of
+  //the smallest size. blocks only grow again after a frame that freed everything, so that frames keeping some of their
+  //memory don't pin large blocks
+  struct FrameArenaScope
+  {
+    FrameArenaScope(bool is_enabled);
+    ~FrameArenaScope();
+  private:
+    bool is_enabled;
+  };
+  //falls back to the heap outside of arena scopes and for large allocations. memory from either can be freed on any thread
+  void *FrameArenaAlloc(size_t size);
+  void FrameArenaFree(void *ptr);
+
+  //std allocator on top of the frame arena for containers that are filled and emptied within a frame
+  template<typename T>
+  struct FrameAllocator
+  {
+    using value_type = T;
+    FrameAllocator() = default;
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U> &)
+    {
+    }
+    T *allocate(size_t count)
+    {
+      void *ptr = FrameArenaAlloc(count * sizeof(T));
+      if(!ptr)
+        throw std::bad_alloc();
+      return static_cast<T*>(ptr);
+    }
+    void deallocate(T *ptr, size_t)
+    {
+      FrameArenaFree(ptr);
+    }
+    template<typename U>
+    bool operator==(const FrameAllocator<U> &) const
+    {
+      return true;
+    }
+    template<typename U>
+    bool operator!=(const FrameAllocator<U> &) const
+    {
+      return false;
+    }
+  };
+}
@@ -0,0 +1,312 @@
+#include "ScriptOptimizer.h"
+#include <cstring>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ls
+{
+  namespace
+  {
+    asDWORD EncodeOp(asEBCInstr op, short var = 0)
+    {
+      return asDWORD(op) | (asDWORD(asWORD(var)) << 16);
+    }
+
+    bool IsJump(asEBCInstr op)
+    {
+      switch(op)
+      {
+        case asBC_JMP: case asBC_JZ: case asBC_JNZ: case asBC_JS: case asBC_JNS: case asBC_JP: case asBC_JNP:
+        case asBC_JLowZ: case asBC_JLowNZ:
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    bool IsWordType(int type_id, asDWORD flags)
+    {
+      return flags == asTM_NONE && (type_id == asTYPEID_FLOAT || type_id == asTYPEID_INT32 || type_id == asTYPEID_UINT32);
+    }
+
+    //instructions that can't raise script exceptions and only touch the variables in their arguments
+    bool IsInlinable(asEBCInstr op)
+    {
+      switch(op)
+      {
+        case asBC_ADDi: case asBC_SUBi: case asBC_MULi: case asBC_ADDIi: case asBC_SUBIi: case asBC_MULIi:
+        case asBC_BAND: case asBC_BOR: case asBC_BXOR: case asBC_BSLL: case asBC_BSRL: case asBC_BSRA:
+        case asBC_ADDf: case asBC_SUBf: case asBC_MULf: case asBC_ADDIf: case asBC_SUBIf: case asBC_MULIf:
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    //the body of a function that can be inlined: one arithmetic instruction from its arguments into a temporary
+    //that is returned. arguments are at offsets 0, -1, -2...
+    struct InlineBody
+    {
+      std::vector<asDWORD> instr;
+      size_t params_count;
+    };
+
+    std::optional<InlineBody> GetInlineBody(asIScriptFunction *function)
+    {
+      if(!function || function->GetFuncType() != asFUNC_SCRIPT || function->GetObjectType())
+        return std::nullopt;
+      asDWORD flags = 0;
+      if(!IsWordType(function->GetReturnTypeId(&flags), flags) || function->GetParamCount() == 0)
+        return std::nullopt;
+      for(asUINT param_idx = 0; param_idx < function->GetParamCount(); param_idx++)
+      {
+        int type_id;
+        flags = 0;
+        if(function->GetParam(param_idx, &type_id, &flags) < 0 || !IsWordType(type_id, flags))
+          return std::nullopt;
+      }
+
+      asUINT length = 0;
+      asDWORD *byte_code = function->GetByteCode(&length);
+      std::vector<asDWORD*> instrs;
+      for(asDWORD *instr = byte_code; byte_code && instr < byte_code + length; instr += asBCTypeSize[asBCInfo[*(asBYTE*)instr].type])
+      {
+        asEBCInstr op = asEBCInstr(*(asBYTE*)instr);
+        if(op != asBC_JitEntry && op != asBC_SUSPEND)
+          instrs.push_back(instr);
+      }
+      if(instrs.size() != 3)
+        return std::nullopt;
+      asEBCInstr op = asEBCInstr(*(asBYTE*)instrs[0]);
+      if(!IsInlinable(op))
+        return std::nullopt;
+      bool has_var_operand = asBCInfo[op].type == asBCTYPE_wW_rW_rW_ARG;
+      short result_var = asBC_SWORDARG0(instrs[0]);
+      short min_param_var = -short(function->GetParamCount() - 1);
+      auto is_param_var = [&](short var){ return var <= 0 && var >= min_param_var; };
+      if(result_var <= 0 || !is_param_var(asBC_SWORDARG1(instrs[0])) || (has_var_operand && !is_param_var(asBC_SWORDARG2(instrs[0]))))
+        return std::nullopt;
+      if(*(asBYTE*)instrs[1] != asBC_CpyVtoR4 || asBC_SWORDARG0(instrs[1]) != result_var)
+        return std::nullopt;
+      if(*(asBYTE*)instrs[2] != asBC_RET || asBC_WORDARG0(instrs[2]) != function->GetParamCount())
+        return std::nullopt;
+
+      InlineBody body;
+      body.instr.assign(instrs[0], instrs[0] + asBCTypeSize[asBCInfo[op].type]);
+      body.params_count = function->GetParamCount();
+      return body;
+    }
+
+    struct FunctionRewriter
+    {
+      FunctionRewriter(asIScriptFunction *function)
+      {
+        asUINT length = 0;
+        this->byte_code = function->GetByteCode(&length);
+        for(asUINT offset = 0; offset < length; offset += asBCTypeSize[asBCInfo[*(asBYTE*)(byte_code + offset)].type])
+        {
+          offsets.push_back(offset);
+          if(IsJump(asEBCInstr(*(asBYTE*)(byte_code + offset))))
+            jump_targets.insert(offset + 2 + asBC_INTARG(byte_code + offset));
+        }
+        //sentinel, so that offsets[instrs_count] is the end of the byte code
+        offsets.push_back(length);
+      }
+      size_t GetInstrsCount() const
+      {
+        return offsets.size() - 1;
+      }
+      asDWORD *Instr(size_t instr_idx) const
+      {
+        return byte_code + offsets[instr_idx];
+      }
+      asEBCInstr Op(size_t instr_idx) const
+      {
+        return instr_idx < GetInstrsCount() ? asEBCInstr(*(asBYTE*)Instr(instr_idx)) : asBC_MAXBYTECODE;
+      }
+      size_t SkipJitEntries(size_t instr_idx) const
+      {
+        while(Op(instr_idx) == asBC_JitEntry)
+          instr_idx++;
+        return instr_idx;
+      }
+      //replaces instructions [begin_idx, end_idx) with code followed by a jump over what's left of them
+      bool Rewrite(size_t begin_idx, size_t end_idx, const std::vector<asDWORD> &code)
+      {
+        if(begin_idx < this->rewritten_end_idx)
+          return false;
+        asUINT begin = offsets[begin_idx];
+        asUINT end = offsets[end_idx];
+        auto target_it = jump_targets.upper_bound(begin);
+        if(target_it != jump_targets.end() && *target_it < end)
+          return false;
+        if(code.size() > end - begin)
+          return false;
+        size_t skipped_size = end - begin - code.size();
+        if(skipped_size == 1)
+          return false;
+        asDWORD *dst = byte_code + begin;
+        memcpy(dst, code.data(), code.size() * sizeof(asDWORD));
+        dst += code.size();
+        if(skipped_size > 0)
+        {
+          //the skipped part is never executed, it only has to stay decodable
+          dst[0] = EncodeOp(asBC_JMP);
+          dst[1] = asDWORD(int(skipped_size - 2));
+          for(size_t offset = 2; offset < skipped_size; offset++)
+            dst[offset] = EncodeOp(asBC_SUSPEND);
+        }
+        this->rewritten_end_idx = end_idx;
+        return true;
+      }
+      asDWORD *byte_code;
+      std::vector<asUINT> offsets;
+      std::set<asUINT> jump_targets;
+      size_t rewritten_end_idx = 0;
+    };
+
+    std::vector<asDWORD> GetComponentStores(short var, const std::vector<asDWORD> &comps)
+    {
+      std::vector<asDWORD> code;
+      for(size_t comp_idx = 0; comp_idx < comps.size();)
+      {
+        short comp_var = short(var - comp_idx);
+        if(comp_idx + 1 < comps.size())
+        {
+          //the first component is at the lowest address, which is the low half of the qword
+          code.push_back(EncodeOp(asBC_SetV8, comp_var));
+          code.push_back(comps[comp_idx]);
+          code.push_back(comps[comp_idx + 1]);
+          comp_idx += 2;
+        }else
+        {
+          code.push_back(EncodeOp(asBC_SetV4, comp_var));
+          code.push_back(comps[comp_idx]);
+          comp_idx++;
+        }
+      }
+      return code;
+    }
+  }
+
+  ScriptOptimizer::ScriptOptimizer(asIJITCompiler *next_compiler, std::map<int, VectorConstructor> vector_constructors)
+    : next_compiler(next_compiler), vector_constructors(std::move(vector_constructors))
+  {
+  }
+
+  int ScriptOptimizer::CompileFunction(asIScriptFunction *function, asJITFunction *output)
+  {
+    asIScriptEngine *engine = function->GetEngine();
+    FunctionRewriter rewriter(function);
+    std::map<int, std::optional<InlineBody>> inline_bodies;
+    for(size_t instr_idx = 0; rewriter.byte_code && instr_idx < rewriter.GetInstrsCount(); instr_idx++)
+    {
+      asEBCInstr op = rewriter.Op(instr_idx);
+      if(op == asBC_CALLSYS && instr_idx > rewriter.rewritten_end_idx && rewriter.Op(instr_idx - 1) == asBC_PSF)
+      {
+        int func_id = asBC_INTARG(rewriter.Instr(instr_idx));
+        asIScriptFunction *called_func = engine->GetFunctionById(func_id);
+        asITypeInfo *type_info = called_func ? called_func->GetObjectType() : nullptr;
+        if(!type_info || std::string(called_func->GetName()) != "$beh0" || (type_info->GetFlags() & (asOBJ_VALUE | asOBJ_POD)) != (asOBJ_VALUE | asOBJ_POD))
+          continue;
+        short temp_var = asBC_SWORDARG0(rewriter.Instr(instr_idx - 1));
+
+        //PSF temp; CALLSYS constructor; PSF temp; PSF var; COPY; PopPtr at the end of a statement
+        std::optional<short> dst_var;
+        size_t copy_idx = rewriter.SkipJitEntries(instr_idx + 1);
+        if(
+          rewriter.Op(copy_idx) == asBC_PSF && asBC_SWORDARG0(rewriter.Instr(copy_idx)) == temp_var &&
+          rewriter.Op(copy_idx + 1) == asBC_PSF && asBC_SWORDARG0(rewriter.Instr(copy_idx + 1)) != temp_var &&
+          rewriter.Op(copy_idx + 2) == asBC_COPY && asBC_WORDARG0(rewriter.Instr(copy_idx + 2)) * 4 == type_info->GetSize() &&
+          rewriter.Op(copy_idx + 3) == asBC_PopPtr &&
+          rewriter.Op(rewriter.SkipJitEntries(copy_idx + 4)) == asBC_SUSPEND)
+        {
+          dst_var = asBC_SWORDARG0(rewriter.Instr(copy_idx + 1));
+        }
+
+        //literal arguments are pushed last to first right before the object pointer
+        std::optional<std::vector<asDWORD>> comps;
+        auto ctor_it = vector_constructors.find(func_id);
+        if(ctor_it != vector_constructors.end())
+        {
+          size_t args_count = ctor_it->second.is_splat ? 1 : ctor_it->second.comps_count;
+          comps.emplace();
+          for(size_t comp_idx = 0; comp_idx < ctor_it->second.comps_count && comps; comp_idx++)
+          {
+            size_t arg_idx = ctor_it->second.is_splat ? 0 : comp_idx;
+            if(instr_idx < 2 + arg_idx || rewriter.Op(instr_idx - 2 - arg_idx) != asBC_PshC4)
+              comps.reset();
+            else
+              comps->push_back(asBC_DWORDARG(rewriter.Instr(instr_idx - 2 - arg_idx)));
+          }
+          size_t args_idx = instr_idx - 1 - args_count;
+          if(comps && dst_var && rewriter.Rewrite(args_idx, copy_idx + 4, GetComponentStores(*dst_var, *comps)))
+          {
+            rewrites_count++;
+            instr_idx = copy_idx + 3;
+            continue;
+          }
+          if(comps && rewriter.Rewrite(args_idx, instr_idx + 1, GetComponentStores(temp_var, *comps)))
+          {
+            rewrites_count++;
+            continue;
+          }
+        }
+        if(dst_var && rewriter.Rewrite(instr_idx + 1, copy_idx + 4, {}))
+        {
+          asDWORD *psf_instr = rewriter.Instr(instr_idx - 1);
+          *psf_instr = EncodeOp(asBC_PSF, *dst_var);
+          rewrites_count++;
+          instr_idx = copy_idx + 3;
+        }
+      }
+      if(op == asBC_CALL)
+      {
+        int func_id = asBC_INTARG(rewriter.Instr(instr_idx));
+        auto body_it = inline_bodies.find(func_id);
+        if(body_it == inline_bodies.end())
+          body_it = inline_bodies.emplace(func_id, GetInlineBody(engine->GetFunctionById(func_id))).first;
+        if(!body_it->second)
+          continue;
+        const InlineBody &body = *body_it->second;
+
+        //PshV4 arg_n-1 ... PshV4 arg_0; CALL; CpyRtoV4 result
+        size_t result_idx = rewriter.SkipJitEntries(instr_idx + 1);
+        if(instr_idx < body.params_count || rewriter.Op(result_idx) != asBC_CpyRtoV4)
+          continue;
+        bool has_var_args = true;
+        for(size_t param_idx = 0; param_idx < body.params_count; param_idx++)
+          has_var_args &= rewriter.Op(instr_idx - 1 - param_idx) == asBC_PshV4;
+        if(!has_var_args)
+          continue;
+        auto get_arg_var = [&](short param_var){ return asBC_SWORDARG0(rewriter.Instr(instr_idx - 1 + param_var)); };
+
+        std::vector<asDWORD> code = body.instr;
+        asEBCInstr body_op = asEBCInstr(*(asBYTE*)code.data());
+        code[0] = EncodeOp(body_op, asBC_SWORDARG0(rewriter.Instr(result_idx)));
+        short lhs_var = get_arg_var(asBC_SWORDARG1(code.data()));
+        short rhs_var = asBCInfo[body_op].type == asBCTYPE_wW_rW_rW_ARG ? get_arg_var(asBC_SWORDARG2(code.data())) : asBC_SWORDARG2(code.data());
+        code[1] = asDWORD(asWORD(lhs_var)) | (asDWORD(asWORD(rhs_var)) << 16);
+        if(rewriter.Rewrite(instr_idx - body.params_count, result_idx + 1, code))
+        {
+          rewrites_count++;
+          instr_idx = result_idx;
+        }
+      }
+    }
+    return next_compiler ? next_compiler->CompileFunction(function, output) : asNOT_SUPPORTED;
+  }
+
+  void ScriptOptimizer::ReleaseJITFunction(asJITFunction func)
+  {
+    if(next_compiler)
+      next_compiler->ReleaseJITFunction(func);
+  }
+
+  size_t ScriptOptimizer::GetRewritesCount() const
+  {
+    return rewrites_count;
+  }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <angelscript.h>
+#include <map>
+
+namespace ls
+{
+  //rewrites the byte code of script functions in place before it's passed on to the next compiler (the jit or nothing).
+  //angelscript doesn't let the byte code grow or shrink, so every rewrite replaces a sequence with a shorter one and
+  //jumps over the rest:
+  //- constructors of vector types called with literals become stores of the components
+  //- a pod value type constructed into a temporary and copied to a variable at the end of a statement is constructed
+  //  into the variable directly
+  //- calls to script functions whose body is a single arithmetic instruction on their arguments are replaced with
+  //  that instruction
+  //needs asEP_INCLUDE_JIT_INSTRUCTIONS, otherwise the engine reports every function as compiled without jit entries
+  struct ScriptOptimizer : public asIJITCompiler
+  {
+    //constructor of a vector type registered with one argument per component or a single one for all of them
+    struct VectorConstructor
+    {
+      size_t comps_count;
+      bool is_splat;
+    };
+    //vector_constructors is keyed by function id
+    ScriptOptimizer(asIJITCompiler *next_compiler, std::map<int, VectorConstructor> vector_constructors);
+    int CompileFunction(asIScriptFunction *function, asJITFunction *output) override;
+    void ReleaseJITFunction(asJITFunction func) override;
+    //sequences rewritten in all the functions passed so far
+    size_t GetRewritesCount() const;
+  private:
+    asIJITCompiler *next_compiler;
+    std::map<int, VectorConstructor> vector_constructors;
+    size_t rewrites_count = 0;
+  };
+}
@@ -19,13 +19,15 @@ namespace ls
         Block               <- Preamble BlockDecl '{{' BlockBody '}}'
         BlockDecl           <- (PassDecl)?
         Preamble            <- (PreambleSection)*
-        PreambleSection     <- '[' (RendergraphSection / BlendModeSection / DeclarationSection / IncludeSection / NumthreadsSection) ']'
+        PreambleSection     <- '[' (RendergraphSection / BlendModeSection / DeclarationSection / IncludeSection / NumthreadsSection / InstancedSection) ']'
         RendergraphSection  <- 'rendergraph'
         BlendModeSection    <- 'blendmode' ':' BlendMode
         BlendMode           <- <'opaque' | 'alphablend' | 'additive' | 'multiplicative'>
         DeclarationSection  <- 'declaration' ':' String
         IncludeSection      <- 'include' ':' StringArray
         NumthreadsSection   <- 'numthreads' Int3
+        InstancedSection    <- 'instanced' '(' Int (',' InstanceAttribute)* ')'
+        InstanceAttribute   <- PodType Name
         PassDecl            <- PodType Name '(' ArgDescs ')'
         BlockBody           <- (!('}}') .)*
         ArgDescs            <- ArgDesc? (',' ArgDesc)* 
@@ -142,6 +144,25 @@ namespace ls
         return section;
       };
       
+      parser["InstancedSection"] = [](const peg::SemanticValues &vs) -> PreambleSection
+      {
+        InstancedSection section;
+        section.vertices_count = std::any_cast<int>(vs[0]);
+        for(size_t attribute_idx = 1; attribute_idx < vs.size(); attribute_idx++)
+        {
+          section.attributes.push_back(std::any_cast<InstanceAttribute>(vs[attribute_idx]));
+        }
+        return section;
+      };
+
+      parser["InstanceAttribute"] = [](const peg::SemanticValues &vs) -> InstanceAttribute
+      {
+        InstanceAttribute attribute;
+        attribute.type = std::any_cast<DecoratedPodType::PodTypes>(vs[0]);
+        attribute.name = std::any_cast<std::string>(vs[1]);
+        return attribute;
+      };
+      
       parser["PassDecl"] = [](const peg::SemanticValues &vs) -> BlockDecl
       {
         PassDecl pass_decl;
@@ -292,6 +313,26 @@ namespace ls
       default: throw std::runtime_error("Can't generate glsl type");
     }
   }
+  size_t GetPodTypeSize(ls::DecoratedPodType::PodTypes type)
+  {
+    using PodTypes = ls::DecoratedPodType::PodTypes;
+    switch(type)
+    {
+      case PodTypes::float_: return sizeof(float); break;
+      case PodTypes::vec2: return sizeof(vec2); break;
+      case PodTypes::vec3: return sizeof(vec3); break;
+      case PodTypes::vec4: return sizeof(vec4); break;
+      case PodTypes::int_: return sizeof(int); break;
+      case PodTypes::ivec2: return sizeof(ivec2); break;
+      case PodTypes::ivec3: return sizeof(ivec3); break;
+      case PodTypes::ivec4: return sizeof(ivec4); break;
+      case PodTypes::uint_: return sizeof(unsigned int); break;
+      case PodTypes::uvec2: return sizeof(uvec2); break;
+      case PodTypes::uvec3: return sizeof(uvec3); break;
+      case PodTypes::uvec4: return sizeof(uvec4); break;
+      default: throw std::runtime_error("Type has no size");
+    }
+  }
   std::string SamplerTypeToString(ls::SamplerTypes type)
   {
     switch(type)
@@ -302,6 +343,16 @@ namespace ls
       default: throw std::runtime_error("Can't generate glsl sampler type");
     }
   }
+  std::string ImageTypeToString(ls::ImageTypes type)
+  {
+    switch(type)
+    {
+      case ls::ImageTypes::image1D: return "image1D"; break;
+      case ls::ImageTypes::image2D: return "image2D"; break;
+      case ls::ImageTypes::image3D: return "image3D"; break;
+      default: throw std::runtime_error("Can't generate glsl image type");
+    }
+  }
 
 
 }
\ No newline at end of file
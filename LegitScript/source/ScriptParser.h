@@ -40,19 +40,6 @@ namespace ls
   };
 
 
-  enum struct ImageTypes : int
-  {
-    image1D,
-    image2D,
-    image3D
-  };
-  enum struct AccessQualifiers : int
-  {
-    readonly,
-    writeonly,
-    readwrite
-  };
-
   struct DecoratedImageType
   {
     ImageTypes image_type;
@@ -77,11 +64,25 @@ namespace ls
     int x, y, z;
   };
 
+  struct InstanceAttribute
+  {
+    DecoratedPodType::PodTypes type;
+    std::string name;
+    //tightly packed, filled when the pass declaration is processed
+    size_t offset = 0;
+  };
+  struct InstancedSection
+  {
+    int vertices_count = 0;
+    std::vector<InstanceAttribute> attributes;
+    size_t stride = 0;
+  };
+
   struct RendergraphSection
   {
   };
   
-  using PreambleSection = std::variant<RendergraphSection, BlendModes, DeclarationSection, IncludeSection, NumthreadsSection>;
+  using PreambleSection = std::variant<RendergraphSection, BlendModes, DeclarationSection, IncludeSection, NumthreadsSection, InstancedSection>;
   struct ArgDesc
   {
     using ArgType = std::variant<DecoratedPodType, DecoratedImageType, SamplerTypes>;
@@ -94,9 +95,15 @@ namespace ls
   {
     enum struct Types
     {
-      FullscreenPass
+      FullscreenPass,
+      ComputePass,
+      InstancedPass
     };
     Types type = Types::FullscreenPass;
+    //only used by compute passes
+    NumthreadsSection numthreads = {1, 1, 1};
+    //only used by instanced passes
+    InstancedSection instanced;
     DecoratedPodType::PodTypes return_type = DecoratedPodType::PodTypes::undefined;
     std::string name;
     ArgDescs arg_descs;
@@ -119,6 +126,8 @@ namespace ls
   
   std::string PodTypeToString(ls::DecoratedPodType::PodTypes type);
   std::string SamplerTypeToString(ls::SamplerTypes type);
+  size_t GetPodTypeSize(ls::DecoratedPodType::PodTypes type);
+  std::string ImageTypeToString(ls::ImageTypes type);
   
   class ScriptParserException : public std::runtime_error
   {
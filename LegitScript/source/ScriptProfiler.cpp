@@ -0,0 +1,62 @@
+#include "ScriptProfiler.h"
+
+namespace ls
+{
+  void ScriptLineProfiler::Begin()
+  {
+    line_entries.clear();
+    function_entries.clear();
+    last_line.reset();
+    last_callstack_size = 0;
+    last_time = Clock::now();
+  }
+
+  void ScriptLineProfiler::FlushLine(Clock::time_point curr_time)
+  {
+    if(last_line)
+      line_entries[last_line.value()].time += std::chrono::duration<double>(curr_time - last_time).count();
+    last_time = curr_time;
+  }
+
+  void ScriptLineProfiler::OnLine(asIScriptContext *ctx)
+  {
+    FlushLine(Clock::now());
+
+    int line = ctx->GetLineNumber(0);
+    if(line <= 0)
+    {
+      last_line.reset();
+      return;
+    }
+    if(size_t(line) >= line_entries.size())
+      line_entries.resize(line + 1);
+    line_entries[line].hits_count++;
+    last_line = size_t(line);
+
+    //a deeper callstack means that a new function was entered since the last line. repeated calls to the same
+    //function within a single statement are indistinguishable at line granularity and are counted once
+    asUINT callstack_size = ctx->GetCallstackSize();
+    if(callstack_size > last_callstack_size)
+      function_entries[ctx->GetFunction(0)]++;
+    last_callstack_size = callstack_size;
+  }
+
+  ScriptProfile ScriptLineProfiler::End()
+  {
+    FlushLine(Clock::now());
+    last_line.reset();
+
+    ScriptProfile profile;
+    for(size_t line = 0; line < line_entries.size(); line++)
+    {
+      const auto &entry = line_entries[line];
+      if(entry.hits_count > 0)
+        profile.lines.push_back({line, entry.hits_count, entry.time * 1e3});
+    }
+    for(const auto &function_entry : function_entries)
+    {
+      profile.functions.push_back({function_entry.first->GetDeclaration(), function_entry.second});
+    }
+    return profile;
+  }
+}
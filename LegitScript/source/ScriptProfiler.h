@@ -0,0 +1,33 @@
+#pragma once
+#include "../include/LegitScriptEvents.h"
+#include <angelscript.h>
+#include <chrono>
+#include <map>
+#include <optional>
+
+namespace ls
+{
+  //attributes time between consecutive line callbacks to the line that was executing. lines are reported
+  //in the coordinates of the assembled angelscript source
+  struct ScriptLineProfiler
+  {
+    void Begin();
+    void OnLine(asIScriptContext *ctx);
+    ScriptProfile End();
+  private:
+    using Clock = std::chrono::steady_clock;
+    void FlushLine(Clock::time_point curr_time);
+
+    struct LineEntry
+    {
+      size_t hits_count = 0;
+      double time = 0.0;
+    };
+    std::vector<LineEntry> line_entries;
+    std::map<asIScriptFunction*, size_t> function_entries;
+
+    Clock::time_point last_time;
+    std::optional<size_t> last_line;
+    asUINT last_callstack_size = 0;
+  };
+}
@@ -0,0 +1,171 @@
+#include "Tracing.h"
+#include <json.hpp>
+
+#if LEGIT_SCRIPT_TRACING
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace ls
+{
+#if LEGIT_SCRIPT_TRACING
+  struct TraceRecorder
+  {
+    using Clock = std::chrono::steady_clock;
+    struct Event
+    {
+      //copied, script scope names don't outlive the scope. longer names are truncated
+      std::array<char, 64> name;
+      double timestamp_us;
+      double duration_us;
+    };
+    //every thread writes to its own ring buffer. its mutex is only contended while the trace is dumped or cleared
+    struct ThreadBuffer
+    {
+      ThreadBuffer(uint32_t thread_id)
+        : events(1 << 14)
+        , thread_id(thread_id)
+      {
+      }
+      std::mutex mutex;
+      std::vector<Event> events;
+      size_t first_event_idx = 0;
+      size_t events_count = 0;
+      uint32_t thread_id;
+    };
+
+    TraceRecorder()
+      : start_time(Clock::now())
+    {
+    }
+    double GetTimestamp()
+    {
+      return std::chrono::duration<double, std::micro>(Clock::now() - start_time).count();
+    }
+    void AddEvent(const char *name, double begin_timestamp_us)
+    {
+      double timestamp_us = GetTimestamp();
+      ThreadBuffer &buffer = GetThreadBuffer();
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+      Event &event = buffer.events[(buffer.first_event_idx + buffer.events_count) % buffer.events.size()];
+      size_t name_len = std::min(std::strlen(name), event.name.size() - 1);
+      //the cut must not split a utf-8 sequence, the json dump rejects incomplete ones
+      for(; name_len > 0 && (uint8_t(name[name_len]) & 0xC0) == 0x80; name_len--);
+      std::memcpy(event.name.data(), name, name_len);
+      event.name[name_len] = 0;
+      event.timestamp_us = begin_timestamp_us;
+      event.duration_us = timestamp_us - begin_timestamp_us;
+      if(buffer.events_count < buffer.events.size())
+        buffer.events_count++;
+      else
+        buffer.first_event_idx = (buffer.first_event_idx + 1) % buffer.events.size();
+    }
+    std::string Dump()
+    {
+      using json = nlohmann::json;
+      std::lock_guard<std::mutex> lock(mutex);
+      auto trace_events = json::array();
+      for(const auto &buffer : thread_buffers)
+      {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        for(size_t event_idx = 0; event_idx < buffer->events_count; event_idx++)
+        {
+          const auto &event = buffer->events[(buffer->first_event_idx + event_idx) % buffer->events.size()];
+          trace_events.push_back(json::object({
+            {"name", event.name.data()},
+            {"cat", "LegitScript"},
+            {"ph", "X"},
+            {"ts", event.timestamp_us},
+            {"dur", event.duration_us},
+            {"pid", 1},
+            {"tid", buffer->thread_id}
+          }));
+        }
+      }
+      return json::object({{"traceEvents", trace_events}, {"displayTimeUnit", "ms"}}).dump();
+    }
+    void Clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for(const auto &buffer : thread_buffers)
+      {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->first_event_idx = 0;
+        buffer->events_count = 0;
+      }
+      //buffers of exited threads are only referenced by the recorder
+      thread_buffers.erase(std::remove_if(thread_buffers.begin(), thread_buffers.end(), [](const std::shared_ptr<ThreadBuffer> &buffer)
+      {
+        return buffer.use_count() == 1;
+      }), thread_buffers.end());
+    }
+    std::atomic<bool> is_enabled = false;
+  private:
+    ThreadBuffer &GetThreadBuffer()
+    {
+      //the recorder is a single global, so one buffer per thread is enough
+      thread_local std::shared_ptr<ThreadBuffer> thread_buffer;
+      if(!thread_buffer)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_buffer = std::make_shared<ThreadBuffer>(++threads_count);
+        thread_buffers.push_back(thread_buffer);
+      }
+      return *thread_buffer;
+    }
+    //only guards the list of buffers
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> thread_buffers;
+    uint32_t threads_count = 0;
+    Clock::time_point start_time;
+  };
+  TraceRecorder &GetTraceRecorder()
+  {
+    static TraceRecorder recorder;
+    return recorder;
+  }
+
+  bool IsTracingEnabled()
+  {
+    return GetTraceRecorder().is_enabled.load(std::memory_order_relaxed);
+  }
+  double GetTraceTimestamp()
+  {
+    return GetTraceRecorder().GetTimestamp();
+  }
+  void AddTraceEvent(const char *name, double begin_timestamp_us)
+  {
+    GetTraceRecorder().AddEvent(name, begin_timestamp_us);
+  }
+
+  void SetTracingEnabled(bool is_enabled)
+  {
+    GetTraceRecorder().is_enabled = is_enabled;
+  }
+  std::string DumpTrace()
+  {
+    return GetTraceRecorder().Dump();
+  }
+  void ClearTrace()
+  {
+    GetTraceRecorder().Clear();
+  }
+#else
+  void SetTracingEnabled(bool is_enabled)
+  {
+  }
+  std::string DumpTrace()
+  {
+    return nlohmann::json::object({{"traceEvents", nlohmann::json::array()}}).dump();
+  }
+  void ClearTrace()
+  {
+  }
+#endif
+}
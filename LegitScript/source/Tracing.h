@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include "../include/LegitScriptTracing.h"
+
+#if LEGIT_SCRIPT_TRACING
+namespace ls
+{
+  bool IsTracingEnabled();
+  double GetTraceTimestamp();
+  //scopes are recorded as complete events when they end, so that a ring buffer never keeps half of a scope
+  void AddTraceEvent(const char *name, double begin_timestamp_us);
+
+  struct TraceScope
+  {
+    TraceScope(const char *name) : name(IsTracingEnabled() ? name : nullptr)
+    {
+      if(this->name)
+        begin_timestamp_us = GetTraceTimestamp();
+    }
+    TraceScope(const std::string &name) : TraceScope(name.c_str()){}
+    ~TraceScope()
+    {
+      if(this->name)
+        AddTraceEvent(this->name, begin_timestamp_us);
+    }
+  private:
+    const char *name;
+    double begin_timestamp_us = 0.0;
+  };
+}
+#define LS_TRACE_CONCAT_IMPL(a, b) a##b
+#define LS_TRACE_CONCAT(a, b) LS_TRACE_CONCAT_IMPL(a, b)
+#define LS_TRACE_SCOPE(name) ls::TraceScope LS_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define LS_TRACE_SCOPE(name)
+#endif
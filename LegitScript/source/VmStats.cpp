@@ -0,0 +1,66 @@
+#include "VmStats.h"
+#include <algorithm>
+#include <vector>
+
+namespace ls
+{
+#if LEGIT_SCRIPT_VM_STATS
+  //declared in angelscript's as_callfunc.h
+  thread_local unsigned long long vmOpcodeCounts[256];
+  //indexed by function id, script and registered functions share the id space
+  thread_local std::vector<size_t> vm_call_counts;
+
+  void CountVmCall(int funcId)
+  {
+    size_t idx = size_t(funcId);
+    if(idx >= vm_call_counts.size())
+      vm_call_counts.resize(idx + 1, 0);
+    vm_call_counts[idx]++;
+  }
+
+  void ResetVmCounters()
+  {
+    std::fill(std::begin(vmOpcodeCounts), std::end(vmOpcodeCounts), 0);
+    std::fill(vm_call_counts.begin(), vm_call_counts.end(), 0);
+  }
+
+  void SortVmCounts(std::vector<ScriptStats::VmCount> &counts)
+  {
+    std::stable_sort(counts.begin(), counts.end(), [](const ScriptStats::VmCount &a, const ScriptStats::VmCount &b){
+      return a.count > b.count;
+    });
+  }
+
+  void AddVmStats(ScriptStats &stats, asIScriptEngine *engine)
+  {
+    for(size_t op = 0; op < 256; op++)
+    {
+      if(vmOpcodeCounts[op] > 0)
+        stats.opcode_counts.push_back({asBCInfo[op].name, size_t(vmOpcodeCounts[op])});
+    }
+    for(size_t func_id = 0; func_id < vm_call_counts.size(); func_id++)
+    {
+      if(vm_call_counts[func_id] == 0)
+        continue;
+      auto func = engine->GetFunctionById(int(func_id));
+      if(!func)
+        continue;
+      ScriptStats::VmCount count = {func->GetDeclaration(true, true), vm_call_counts[func_id]};
+      if(func->GetFuncType() == asFUNC_SYSTEM)
+        stats.registered_call_counts.push_back(count);
+      else
+        stats.script_call_counts.push_back(count);
+    }
+    SortVmCounts(stats.opcode_counts);
+    SortVmCounts(stats.registered_call_counts);
+    SortVmCounts(stats.script_call_counts);
+  }
+#else
+  void ResetVmCounters()
+  {
+  }
+  void AddVmStats(ScriptStats &stats, asIScriptEngine *engine)
+  {
+  }
+#endif
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <angelscript.h>
+#include "../include/LegitScriptEvents.h"
+
+namespace ls
+{
+  //the interpreter counts executed opcodes and function calls of the calling thread when the library is built with
+  //LEGIT_SCRIPT_VM_STATS. the hooks live in angelscript's as_context.cpp and as_callfunc.cpp and compile out otherwise,
+  //along with everything below
+  void ResetVmCounters();
+  //fills the vm counts of stats with the calling thread's counters, functions are named by their declaration in engine
+  void AddVmStats(ScriptStats &stats, asIScriptEngine *engine);
+}
@@ -0,0 +1,42 @@
+#include <LegitScript.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+//compiles the render graph of a script ahead of time. linking the output into an application makes
+//LegitScript::LoadScript() of the same script use it instead of compiling the render graph
+int main(int argc, char **argv)
+{
+  if(argc != 3)
+  {
+    std::cout << "Usage: LegitScriptAot <script.ls> <output.cpp>\n";
+    return 1;
+  }
+  std::ifstream script_stream(argv[1]);
+  if(!script_stream)
+  {
+    std::cout << "Can't open " << argv[1] << "\n";
+    return 1;
+  }
+  std::stringstream string_stream;
+  string_stream << script_stream.rdbuf();
+  try
+  {
+    ls::LegitScript script;
+    script.LoadScript(string_stream.str());
+    std::string aot_source = script.GenerateAotSource();
+    std::ofstream output_stream(argv[2]);
+    output_stream << aot_source;
+    if(!output_stream)
+    {
+      std::cout << "Can't write " << argv[2] << "\n";
+      return 1;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Failed to compile " << argv[1] << ": " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,567 @@
+#include <LegitScript.h>
+#include <LegitScriptJsonApi.h>
+#include <ScriptParser.h>
+#include <IncludeGraph.h>
+#include <ScriptMemory.h>
+#include <json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <thread>
+
+//every c++ heap allocation made by the benchmark thread is counted here. angelscript allocates through
+//its own memory functions which are counted by ls::GetScriptMemoryCounters()
+thread_local size_t heap_allocations_count = 0;
+thread_local size_t heap_allocated_bytes = 0;
+thread_local size_t heap_freed_bytes = 0;
+
+//keeps the size in front of every allocation, so that frees can be counted too
+struct alignas(std::max_align_t) HeapAllocationHeader
+{
+  size_t size;
+};
+
+void *operator new(size_t size)
+{
+  heap_allocations_count++;
+  heap_allocated_bytes += size;
+  auto *header = static_cast<HeapAllocationHeader*>(malloc(sizeof(HeapAllocationHeader) + size));
+  if(!header) throw std::bad_alloc();
+  header->size = size;
+  return header + 1;
+}
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+void operator delete(void *ptr) noexcept
+{
+  if(!ptr)
+    return;
+  auto *header = static_cast<HeapAllocationHeader*>(ptr) - 1;
+  heap_freed_bytes += header->size;
+  free(header);
+}
+void operator delete[](void *ptr) noexcept
+{
+  operator delete(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+  operator delete(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+struct AllocationCounters
+{
+  size_t allocations_count;
+  size_t allocated_bytes;
+};
+AllocationCounters GetAllocationCounters()
+{
+  auto script_counters = ls::GetScriptMemoryCounters();
+  return {heap_allocations_count + script_counters.allocations_count, heap_allocated_bytes + script_counters.allocated_bytes};
+}
+//bytes allocated by the benchmark thread that are still alive, c++ and angelscript ones together
+size_t GetLiveBytes()
+{
+  auto script_counters = ls::GetScriptMemoryCounters();
+  return heap_allocated_bytes - heap_freed_bytes + script_counters.allocated_bytes - script_counters.freed_bytes;
+}
+
+struct SyntheticScriptParams
+{
+  std::string name;
+  size_t blocks_count;
+  size_t passes_count;
+  size_t sliders_count;
+  size_t diamond_depth;
+  size_t body_lines_count;
+};
+
+struct SyntheticScript
+{
+  std::string source;
+  ls::Graph include_graph;
+};
+
+//declaration blocks form a chain of include diamonds: every level includes both blocks of the level below it.
+//passes include the top of the chain so flattening visits 2^depth paths per pass
+SyntheticScript GenerateScript(const SyntheticScriptParams &params)
+{
+  SyntheticScript script;
+  std::stringstream src;
+  auto add_body = [&](const std::string &line)
+  {
+    src << "{{\n";
+    for(size_t line_idx = 0; line_idx < params.body_lines_count; line_idx++)
+      src << "  " << line << " //" << line_idx << "\n";
+    src << "}}\n";
+  };
+  auto add_node = [&](std::vector<ls::NodeIdx> adjacent_nodes)
+  {
+    script.include_graph.push_back({adjacent_nodes});
+    return script.include_graph.size() - 1;
+  };
+
+  std::vector<size_t> prev_level;
+  for(size_t level = 0; level < params.diamond_depth; level++)
+  {
+    std::vector<size_t> curr_level;
+    for(size_t side = 0; side < (level == 0 ? 1 : 2); side++)
+    {
+      std::string name = "diamond_" + std::to_string(level) + "_" + std::to_string(side);
+      if(!prev_level.empty())
+      {
+        src << "[include: ";
+        for(size_t i = 0; i < prev_level.size(); i++)
+          src << (i > 0 ? ", " : "") << "\"diamond_" << level - 1 << "_" << i << "\"";
+        src << "]\n";
+      }
+      src << "[declaration: \"" << name << "\"]\n";
+      add_body("float " + name + "_func(float x){ return x * 2.0f; }");
+      curr_level.push_back(add_node(prev_level));
+    }
+    prev_level = curr_level;
+  }
+
+  for(size_t block_idx = 0; block_idx < params.blocks_count; block_idx++)
+  {
+    src << "[declaration: \"block_" << block_idx << "\"]\n";
+    add_body("vec4 block_func(vec4 v){ return v.yzwx; }");
+    add_node({});
+  }
+
+  std::string top_include = params.diamond_depth > 0 ? "diamond_" + std::to_string(params.diamond_depth - 1) + "_0" : "";
+  for(size_t pass_idx = 0; pass_idx < params.passes_count; pass_idx++)
+  {
+    if(!top_include.empty())
+      src << "[include: \"" << top_include << "\"]\n";
+    src << "void Pass" << pass_idx << "(in float amount, in vec2 offset, sampler2D src_tex, out vec4 color)\n";
+    add_body("color = texture(src_tex, gl_FragCoord.xy + offset) * amount;");
+    add_node(prev_level.empty() ? std::vector<ls::NodeIdx>() : std::vector<ls::NodeIdx>{prev_level[0]});
+  }
+
+  src << "[rendergraph]\n";
+  src << "void RenderGraphMain()\n{{\n";
+  src << "  Image img0 = GetImage(uvec2(256, 256), rgba8);\n";
+  src << "  Image img1 = GetImage(uvec2(256, 256), rgba8);\n";
+  src << "  float amount = 0.0f;\n";
+  for(size_t slider_idx = 0; slider_idx < params.sliders_count; slider_idx++)
+    src << "  amount += SliderFloat(\"slider_" << slider_idx << "\", 0.0f, 1.0f, 0.5f);\n";
+  for(size_t pass_idx = 0; pass_idx < params.passes_count; pass_idx++)
+  {
+    bool is_even = pass_idx % 2 == 0;
+    src << "  Pass" << pass_idx << "(amount, vec2(" << pass_idx << ".0f, 1.0f), " << (is_even ? "img0, img1" : "img1, img0") << ");\n";
+  }
+  src << "  Text(\"amount: \" + amount);\n";
+  src << "}}\n";
+  add_node({});
+
+  script.source = src.str();
+  return script;
+}
+
+//render graph dominated by vector constructors, vector arithmetic and calls to small helper functions
+std::string GenerateVectorMathScript(size_t iterations_count)
+{
+  std::stringstream src;
+  src << "void Shade(vec4 tint, vec2 offset, out vec4 color)\n{{\n  color = tint + vec4(offset, 0.0f, 1.0f);\n}}\n";
+  src << "[declaration: \"helpers\"]\n{{\n";
+  src << "  float Scale(float x) { return x * 0.5f; }\n";
+  src << "  float Offset(float x, float y) { return x + y; }\n";
+  src << "}}\n";
+  src << "[rendergraph]\n[include: \"helpers\"]\n";
+  src << "void RenderGraphMain()\n{{\n";
+  src << "  vec4 tint = vec4(0.0f);\n";
+  src << "  vec2 offset = vec2(0.0f, 0.0f);\n";
+  src << "  float x = 0.0f;\n";
+  src << "  for(int i = 0; i < " << iterations_count << "; i++)\n  {\n";
+  src << "    vec4 step = vec4(0.25f, 0.5f, 0.75f, 1.0f);\n";
+  src << "    offset = vec2(1.0f, 2.0f);\n";
+  src << "    x = Offset(Scale(x), offset.y);\n";
+  src << "    tint = tint * 0.5f + step;\n";
+  src << "  }\n";
+  src << "  Shade(tint, offset * x, GetSwapchainImage());\n";
+  src << "}}\n";
+  return src.str();
+}
+
+struct BenchResult
+{
+  std::string name;
+  size_t iterations_count;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+};
+
+struct BenchRunner
+{
+  double min_time = 0.5;
+  std::string filter;
+  std::vector<BenchResult> results;
+
+  void Run(const std::string &name, const std::function<void()> &func)
+  {
+    if(!filter.empty() && name.find(filter) == std::string::npos)
+      return;
+    using Clock = std::chrono::steady_clock;
+    func();
+
+    size_t iterations_count = 0;
+    double elapsed_time = 0.0;
+    auto start_counters = GetAllocationCounters();
+    auto start_time = Clock::now();
+    while(elapsed_time < min_time || iterations_count < 3)
+    {
+      func();
+      iterations_count++;
+      elapsed_time = std::chrono::duration<double>(Clock::now() - start_time).count();
+    }
+    auto end_counters = GetAllocationCounters();
+
+    BenchResult result;
+    result.name = name;
+    result.iterations_count = iterations_count;
+    result.ns_per_op = elapsed_time * 1e9 / iterations_count;
+    result.allocs_per_op = double(end_counters.allocations_count - start_counters.allocations_count) / iterations_count;
+    result.bytes_per_op = double(end_counters.allocated_bytes - start_counters.allocated_bytes) / iterations_count;
+    results.push_back(result);
+    PrintResult(result);
+    std::cout << "\n";
+  }
+
+  //every thread makes its own state with make_func and then runs the returned function for min_time, all threads at
+  //the same time. ns/op is the time of one call on one thread, so it stays flat as long as the threads don't contend.
+  //remote frees are frame arena allocations freed on another thread than the one that made them
+  void RunThreads(const std::string &name, size_t threads_count, const std::function<std::function<void()>()> &make_func)
+  {
+    if(!filter.empty() && name.find(filter) == std::string::npos)
+      return;
+    using Clock = std::chrono::steady_clock;
+    struct ThreadResult
+    {
+      size_t iterations_count = 0;
+      double elapsed_time = 0.0;
+      AllocationCounters allocation_counters = {0, 0};
+      size_t remote_frees_count = 0;
+    };
+    std::vector<ThreadResult> thread_results(threads_count);
+    std::atomic<size_t> ready_threads_count = 0;
+    std::vector<std::thread> threads;
+    for(size_t thread_idx = 0; thread_idx < threads_count; thread_idx++)
+    {
+      threads.emplace_back([&, thread_idx](){
+        auto func = make_func();
+        func();
+        ready_threads_count++;
+        while(ready_threads_count < threads_count);
+
+        auto &thread_result = thread_results[thread_idx];
+        auto start_counters = GetAllocationCounters();
+        auto start_remote_frees_count = ls::GetScriptMemoryCounters().arena_remote_frees_count;
+        auto start_time = Clock::now();
+        while(thread_result.elapsed_time < min_time || thread_result.iterations_count < 3)
+        {
+          func();
+          thread_result.iterations_count++;
+          thread_result.elapsed_time = std::chrono::duration<double>(Clock::now() - start_time).count();
+        }
+        auto end_counters = GetAllocationCounters();
+        thread_result.allocation_counters = {end_counters.allocations_count - start_counters.allocations_count, end_counters.allocated_bytes - start_counters.allocated_bytes};
+        thread_result.remote_frees_count = ls::GetScriptMemoryCounters().arena_remote_frees_count - start_remote_frees_count;
+      });
+    }
+    for(auto &thread : threads)
+      thread.join();
+
+    BenchResult result = {name, 0, 0.0, 0.0, 0.0};
+    double elapsed_time = 0.0;
+    size_t remote_frees_count = 0;
+    for(const auto &thread_result : thread_results)
+    {
+      result.iterations_count += thread_result.iterations_count;
+      elapsed_time += thread_result.elapsed_time;
+      result.allocs_per_op += double(thread_result.allocation_counters.allocations_count);
+      result.bytes_per_op += double(thread_result.allocation_counters.allocated_bytes);
+      remote_frees_count += thread_result.remote_frees_count;
+    }
+    result.ns_per_op = elapsed_time * 1e9 / result.iterations_count;
+    result.allocs_per_op /= result.iterations_count;
+    result.bytes_per_op /= result.iterations_count;
+    results.push_back(result);
+    PrintResult(result);
+    std::cout << std::setw(10) << remote_frees_count << " remote frees\n";
+  }
+private:
+  void PrintResult(const BenchResult &result)
+  {
+    std::cout << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(0)
+      << std::setw(14) << result.ns_per_op << " ns/op"
+      << std::setw(12) << result.allocs_per_op << " allocs/op"
+      << std::setw(14) << result.bytes_per_op << " B/op"
+      << std::setw(10) << result.iterations_count << " iters";
+  }
+};
+
+std::string MakeSwapchainInputs(unsigned int width, unsigned int height)
+{
+  return "[{\"name\": \"@swapchain_size\", \"type\": \"uvec2\", \"value\":{\"x\":" + std::to_string(width) + ", \"y\":" + std::to_string(height) + "}}]";
+}
+
+void RunScriptBenchmarks(BenchRunner &runner, const std::string &name, const std::string &source, const ls::Graph *include_graph)
+{
+  {
+    ls::ScriptParser parser;
+    runner.Run("Parse/" + name, [&](){
+      parser.Parse(source);
+    });
+  }
+  if(include_graph)
+  {
+    runner.Run("FlattenGraph/" + name, [&](){
+      ls::FlattenGraph(*include_graph);
+    });
+  }
+  {
+    ls::LegitScript script;
+    runner.Run("LoadScript/" + name, [&](){
+      script.LoadScript(source);
+    });
+  }
+  {
+    ls::LegitScript script;
+    script.LoadScript(source);
+    std::vector<ls::ContextInput> context_inputs = {{"@swapchain_size", ls::uvec2{1920, 1080}}};
+    runner.Run("RunScript/" + name, [&](){
+      script.RunScript(context_inputs);
+    });
+  }
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.optimize_byte_code = true;
+    script.SetOptions(options);
+    script.LoadScript(source);
+    std::vector<ls::ContextInput> context_inputs = {{"@swapchain_size", ls::uvec2{1920, 1080}}};
+    runner.Run("RunScriptOptimized/" + name, [&](){
+      script.RunScript(context_inputs);
+    });
+  }
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.use_frame_arena = true;
+    script.SetOptions(options);
+    script.LoadScript(source);
+    std::vector<ls::ContextInput> context_inputs = {{"@swapchain_size", ls::uvec2{1920, 1080}}};
+    runner.Run("RunScriptArena/" + name, [&](){
+      script.RunScript(context_inputs);
+    });
+  }
+  runner.Run("JsonLoadScript/" + name, [&](){
+    ls::LoadScript(source);
+  });
+  {
+    ls::LoadScript(source);
+    std::string context_inputs = MakeSwapchainInputs(1920, 1080);
+    runner.Run("JsonRunScript/" + name, [&](){
+      ls::RunScript(context_inputs);
+    });
+  }
+}
+
+//one script instance per thread, with and without the frame arena
+void RunThreadedBenchmarks(BenchRunner &runner, const std::string &name, const std::string &source)
+{
+  size_t max_threads_count = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+  for(bool use_frame_arena : {false, true})
+  {
+    for(size_t threads_count : {size_t(1), std::min<size_t>(max_threads_count, 8)})
+    {
+      std::string bench_name = std::string(use_frame_arena ? "RunScriptArenaThreads/" : "RunScriptThreads/") + name + "/" + std::to_string(threads_count);
+      runner.RunThreads(bench_name, threads_count, [&]() -> std::function<void()>{
+        auto script = std::make_shared<ls::LegitScript>();
+        ls::ScriptOptions options;
+        options.use_frame_arena = use_frame_arena;
+        script->SetOptions(options);
+        script->LoadScript(source);
+        std::vector<ls::ContextInput> context_inputs = {{"@swapchain_size", ls::uvec2{1920, 1080}}};
+        return [script, context_inputs](){
+          script->RunScript(context_inputs);
+        };
+      });
+    }
+  }
+}
+
+//loading an instance next to one that keeps the engine alive, and the memory every instance keeps once loaded, with an
+//engine of its own and with a shared one. the shared engine's registrations are counted once over all the instances
+void RunSharedEngineBenchmarks(BenchRunner &runner, const std::string &name, const std::string &source, size_t instances_count)
+{
+  for(bool share_script_engine : {false, true})
+  {
+    std::string mode_name = share_script_engine ? "shared" : "own";
+    ls::ScriptOptions options;
+    options.share_script_engine = share_script_engine;
+    {
+      ls::LegitScript engine_keeper;
+      engine_keeper.SetOptions(options);
+      engine_keeper.LoadScript(source);
+      runner.Run("LoadInstance/" + name + "/" + mode_name, [&](){
+        ls::LegitScript script;
+        script.SetOptions(options);
+        script.LoadScript(source);
+      });
+      //bindings of the shared engine look up their instance on every call, own engines capture it
+      std::vector<ls::ContextInput> context_inputs = {{"@swapchain_size", ls::uvec2{1920, 1080}}};
+      runner.Run("RunInstance/" + name + "/" + mode_name, [&](){
+        engine_keeper.RunScript(context_inputs);
+      });
+    }
+    std::string memory_name = "InstanceMemory/" + name + "/" + mode_name;
+    if(!runner.filter.empty() && memory_name.find(runner.filter) == std::string::npos)
+      continue;
+    size_t start_live_bytes = GetLiveBytes();
+    {
+      std::vector<std::unique_ptr<ls::LegitScript>> scripts;
+      for(size_t instance_idx = 0; instance_idx < instances_count; instance_idx++)
+      {
+        scripts.emplace_back(new ls::LegitScript());
+        scripts.back()->SetOptions(options);
+        scripts.back()->LoadScript(source);
+      }
+      double bytes_per_instance = double(GetLiveBytes() - start_live_bytes) / instances_count;
+      std::cout << std::left << std::setw(40) << memory_name << std::right << std::fixed << std::setprecision(0)
+        << std::setw(14) << bytes_per_instance << " live B/instance" << std::setw(10) << instances_count << " instances\n";
+    }
+  }
+}
+
+void WriteResults(const std::vector<BenchResult> &results, const std::string &filename)
+{
+  using json = nlohmann::json;
+  auto arr = json::array();
+  for(const auto &result : results)
+  {
+    arr.push_back(json::object({
+      {"name", result.name},
+      {"iterations", result.iterations_count},
+      {"ns_per_op", result.ns_per_op},
+      {"allocs_per_op", result.allocs_per_op},
+      {"bytes_per_op", result.bytes_per_op}
+    }));
+  }
+  std::ofstream file_stream(filename);
+  file_stream << json::object({{"benchmarks", arr}}).dump(2) << "\n";
+}
+
+void CompareResults(const std::vector<BenchResult> &results, const std::string &baseline_filename)
+{
+  using json = nlohmann::json;
+  std::ifstream file_stream(baseline_filename);
+  if(!file_stream)
+  {
+    std::cout << "Can't open baseline " << baseline_filename << "\n";
+    return;
+  }
+  json baseline = json::parse(file_stream);
+  std::map<std::string, json> baseline_results;
+  for(const auto &result : baseline["benchmarks"])
+    baseline_results[result["name"]] = result;
+
+  std::cout << "\nComparison with " << baseline_filename << ":\n";
+  for(const auto &result : results)
+  {
+    auto it = baseline_results.find(result.name);
+    if(it == baseline_results.end())
+      continue;
+    auto relative_change = [](double curr, double prev){ return prev > 0.0 ? (curr / prev - 1.0) * 100.0 : 0.0; };
+    std::cout << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(1)
+      << std::setw(10) << relative_change(result.ns_per_op, it->second["ns_per_op"]) << "% time"
+      << std::setw(10) << relative_change(result.allocs_per_op, it->second["allocs_per_op"]) << "% allocs"
+      << std::setw(10) << relative_change(result.bytes_per_op, it->second["bytes_per_op"]) << "% bytes\n";
+  }
+}
+
+int main(int argc, char **argv)
+{
+  BenchRunner runner;
+  std::string json_filename;
+  std::string baseline_filename;
+  std::string script_filename = "../data/Scripts/main.ls";
+  for(int arg_idx = 1; arg_idx < argc; arg_idx++)
+  {
+    std::string arg = argv[arg_idx];
+    bool has_value = arg_idx + 1 < argc;
+    if(arg == "--json" && has_value) json_filename = argv[++arg_idx];
+    else if(arg == "--compare" && has_value) baseline_filename = argv[++arg_idx];
+    else if(arg == "--filter" && has_value) runner.filter = argv[++arg_idx];
+    else if(arg == "--min-time" && has_value) runner.min_time = std::atof(argv[++arg_idx]);
+    else if(arg == "--script" && has_value) script_filename = argv[++arg_idx];
+    else
+    {
+      std::cout << "Usage: LegitScriptBench [--json out.json] [--compare baseline.json] [--filter substr] [--min-time seconds] [--script file.ls]\n";
+      return 1;
+    }
+  }
+
+  std::vector<SyntheticScriptParams> synthetic_params = {
+    {"small", 4, 4, 4, 3, 10},
+    {"passes", 4, 128, 4, 1, 10},
+    {"sliders", 4, 4, 256, 1, 10},
+    {"diamonds", 4, 8, 4, 10, 10},
+    {"long_bodies", 16, 16, 4, 3, 500},
+    {"large", 64, 64, 64, 6, 100}
+  };
+  try
+  {
+    for(const auto &params : synthetic_params)
+    {
+      auto script = GenerateScript(params);
+      RunScriptBenchmarks(runner, params.name, script.source, &script.include_graph);
+    }
+
+    RunScriptBenchmarks(runner, "vector_math", GenerateVectorMathScript(1000), nullptr);
+    RunThreadedBenchmarks(runner, "passes", GenerateScript(synthetic_params[1]).source);
+    RunSharedEngineBenchmarks(runner, "small", GenerateScript(synthetic_params[0]).source, 100);
+    RunSharedEngineBenchmarks(runner, "passes", GenerateScript(synthetic_params[1]).source, 100);
+    RunSharedEngineBenchmarks(runner, "sliders", GenerateScript(synthetic_params[2]).source, 100);
+
+    std::ifstream file_stream(script_filename);
+    if(file_stream)
+    {
+      std::stringstream string_stream;
+      string_stream << file_stream.rdbuf();
+      RunScriptBenchmarks(runner, "main.ls", string_stream.str(), nullptr);
+    }
+    else
+    {
+      std::cout << "Skipping " << script_filename << ": file not found\n";
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Exception: " << e.what() << "\n";
+    return 1;
+  }
+
+  if(!json_filename.empty())
+    WriteResults(runner.results, json_filename);
+  if(!baseline_filename.empty())
+    CompareResults(runner.results, baseline_filename);
+  return 0;
+}
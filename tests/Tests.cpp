@@ -1,8 +1,12 @@
 #include <LegitScript.h>
 #include <LegitScriptJsonApi.h>
+#include <json.hpp>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <map>
+#include <algorithm>
+#include <thread>
 
 void PrintShaderDesc(const ls::ShaderDesc &shader_desc)
 {
@@ -13,6 +17,9 @@ void PrintShaderDesc(const ls::ShaderDesc &shader_desc)
   std::cout << "  Samplers:\n";
   for(const auto &sampler : shader_desc.samplers)
     std::cout << "    " << sampler.type << " " << sampler.name << "\n";
+  std::cout << "  Images:\n";
+  for(const auto &image : shader_desc.images)
+    std::cout << "    " << image.type << " " << image.name << "\n";
   std::cout << "  Render targets:\n";
   for(const auto &out : shader_desc.outs)
     std::cout << "    " << out.type << " " << out.name << "\n";
@@ -48,6 +55,9 @@ void PrintRequest(const ls::LoadedImageRequest req)
 void PrintRequest(const ls::CachedImageRequest req)
 {
 }
+void PrintRequest(const ls::PersistentImageRequest req)
+{
+}
 
 void PrintScriptEvents(const ls::ScriptEvents script_events)
 {
@@ -115,9 +125,2259 @@ void RunTestJson()
   }
 }
 
+size_t FindLine(const std::string &script_source, const std::string &marker)
+{
+  size_t pos = script_source.find(marker);
+  size_t line = 1;
+  for(size_t i = 0; i < pos && i < script_source.size(); i++)
+    if(script_source[i] == '\n') line++;
+  return line;
+}
+
+bool RunLineProfilerTest()
+{
+  std::string script_source = R"(
+[rendergraph]
+void RenderGraphMain()
+{{
+  float acc = 0.0f;
+  for(int i = 0; i < 1000; i++)
+  {
+    acc = acc + float(i); //hot
+  }
+  Text("acc: " + acc);
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.profile_lines = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    auto script_events = script.RunScript({});
+    if(!script_events.profile)
+    {
+      std::cout << "Line profiler test failed: no profile\n";
+      return false;
+    }
+    size_t hot_line = FindLine(script_source, "//hot");
+    size_t text_line = FindLine(script_source, "Text(");
+    size_t hot_hits_count = 0;
+    size_t text_hits_count = 0;
+    for(const auto &line : script_events.profile->lines)
+    {
+      if(line.line == hot_line) hot_hits_count = line.hits_count;
+      if(line.line == text_line) text_hits_count = line.hits_count;
+    }
+    if(hot_hits_count != 1000 || text_hits_count != 1)
+    {
+      std::cout << "Line profiler test failed: hot line hits " << hot_hits_count << ", text line hits " << text_hits_count << "\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Line profiler test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Line profiler test passed\n";
+  return true;
+}
+
+std::vector<ls::CachedImageRequest> GetCachedImageRequests(const ls::ScriptEvents &script_events)
+{
+  std::vector<ls::CachedImageRequest> image_requests;
+  for(const auto &request : script_events.context_requests)
+  {
+    if(std::holds_alternative<ls::CachedImageRequest>(request))
+      image_requests.push_back(std::get<ls::CachedImageRequest>(request));
+  }
+  return image_requests;
+}
+
+bool RunStableImageIdsTest()
+{
+  std::string script_source = R"(
+[rendergraph]
+void RenderGraphMain()
+{{
+  if(Checkbox("Extra image", false))
+  {
+    Image extra_img = GetImage(uvec2(64, 64), rgba8);
+  }
+  uint size = uint(SliderInt("Size", 1, 1024, 128));
+  for(int i = 0; i < 2; i++)
+  {
+    Image img = GetImage(uvec2(size, size), rgba16f);
+  }
+}}
+)";
+  ls::LegitScript script;
+  try
+  {
+    script.LoadScript(script_source);
+    auto first_requests = GetCachedImageRequests(script.RunScript({}));
+    auto second_events = script.RunScript({{"Extra image", 1}, {"Size", 256}});
+    auto second_requests = GetCachedImageRequests(second_events);
+    if(first_requests.size() != 2 || second_requests.size() != 3)
+    {
+      std::cout << "Stable image ids test failed: unexpected image requests count\n";
+      return false;
+    }
+    bool is_stable = first_requests[0].id == second_requests[1].id && first_requests[1].id == second_requests[2].id;
+    bool is_distinct = first_requests[0].id != first_requests[1].id && second_requests[0].id != first_requests[0].id && second_requests[0].id != first_requests[1].id;
+    if(!is_stable || !is_distinct)
+    {
+      std::cout << "Stable image ids test failed: image ids changed between frames\n";
+      return false;
+    }
+    if(second_events.image_invalidations.size() != 2 || second_events.image_invalidations[0].id != first_requests[0].id || second_events.image_invalidations[0].prev_size.x != 128)
+    {
+      std::cout << "Stable image ids test failed: resized images were not invalidated\n";
+      return false;
+    }
+    std::vector<ls::Image::Id> released_ids;
+    for(size_t frame = 0; frame < 70; frame++)
+    {
+      auto unused_events = script.RunScript({{"Extra image", 0}, {"Size", 256}});
+      released_ids.insert(released_ids.end(), unused_events.released_image_ids.begin(), unused_events.released_image_ids.end());
+    }
+    if(released_ids.size() != 1 || released_ids[0] != second_requests[0].id)
+    {
+      std::cout << "Stable image ids test failed: unused image id was not released\n";
+      return false;
+    }
+    auto reused_events = script.RunScript({{"Extra image", 1}, {"Size", 256}});
+    auto reused_requests = GetCachedImageRequests(reused_events);
+    if(reused_requests.size() != 3 || reused_requests[0].id != released_ids[0] || !reused_events.image_invalidations.empty())
+    {
+      std::cout << "Stable image ids test failed: released image id was not reused\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Stable image ids test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Stable image ids test passed\n";
+  return true;
+}
+
+bool RunAliasingPlanTest()
+{
+  std::string script_source = R"(
+void Fill(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image img0 = GetImage(uvec2(64, 64), rgba8);
+  Image img1 = GetImage(uvec2(64, 64), rgba8);
+  Image img2 = GetImage(uvec2(64, 64), rgba8);
+  Image unused_img = GetImage(uvec2(64, 64), rgba8);
+  Fill(img0);
+  Blit(img0, img1);
+  Blit(img1, img2);
+  Blit(img2, GetSwapchainImage());
+}}
+)";
+  std::string feedback_source = R"(
+void Fill(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image trail = GetImage(uvec2(64, 64), rgba8);
+  Image tmp0 = GetImage(uvec2(64, 64), rgba8);
+  Image tmp1 = GetImage(uvec2(64, 64), rgba8);
+  Blit(trail, tmp0);
+  Blit(tmp0, trail);
+  Fill(tmp1);
+  Blit(tmp1, GetSwapchainImage());
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.build_aliasing_plan = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    auto script_events = script.RunScript({});
+    auto image_requests = GetCachedImageRequests(script_events);
+    if(!script_events.aliasing_plan)
+    {
+      std::cout << "Aliasing plan test failed: no plan\n";
+      return false;
+    }
+    const auto &plan = script_events.aliasing_plan.value();
+    size_t image_bytes = 64 * 64 * 4;
+    //img0 is dead once img1 is written, so img2 can take its memory
+    if(plan.image_lifetimes.size() != 3 || plan.slots.size() != 2 || plan.unaliased_bytes != 3 * image_bytes || plan.aliased_bytes != 2 * image_bytes)
+    {
+      std::cout << "Aliasing plan test failed: " << plan.slots.size() << " slots, " << plan.aliased_bytes << " aliased bytes\n";
+      return false;
+    }
+    if(plan.image_lifetimes[0].slot_idx != plan.image_lifetimes[2].slot_idx || plan.image_lifetimes[0].id != image_requests[0].id || plan.image_lifetimes[2].id != image_requests[2].id)
+    {
+      std::cout << "Aliasing plan test failed: img0 and img2 do not share a slot\n";
+      return false;
+    }
+
+    //images carried into the next frame keep their memory: cached images while invocation reuse is tracked, and
+    //images read before the frame writes them
+    ls::ScriptOptions reuse_options = options;
+    reuse_options.track_invocation_reuse = true;
+    ls::LegitScript reuse_script;
+    reuse_script.SetOptions(reuse_options);
+    reuse_script.LoadScript(script_source);
+    if(!reuse_script.RunScript({}).aliasing_plan->image_lifetimes.empty())
+    {
+      std::cout << "Aliasing plan test failed: images carried by invocation reuse are aliased\n";
+      return false;
+    }
+    ls::LegitScript feedback_script;
+    feedback_script.SetOptions(options);
+    feedback_script.LoadScript(feedback_source);
+    auto feedback_events = feedback_script.RunScript({});
+    auto feedback_requests = GetCachedImageRequests(feedback_events);
+    const auto &feedback_plan = feedback_events.aliasing_plan.value();
+    bool is_trail_aliased = false;
+    for(const auto &lifetime : feedback_plan.image_lifetimes)
+      is_trail_aliased |= lifetime.id == feedback_requests[0].id;
+    if(is_trail_aliased || feedback_plan.image_lifetimes.size() != 2 || feedback_plan.slots.size() != 1)
+    {
+      std::cout << "Aliasing plan test failed: an image read before it's written is aliased\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Aliasing plan test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Aliasing plan test passed\n";
+  return true;
+}
+
+bool RunDependencyGraphTest()
+{
+  std::string script_source = R"(
+void Fill(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image b = GetImage(uvec2(64, 64), rgba8);
+  Image mipped = GetMippedImage(uvec2(64, 64), rgba8);
+  Fill(a);
+  Fill(b);
+  Fill(mipped.GetMip(0));
+  Blit(mipped.GetMip(0), mipped.GetMip(1));
+  Blit(a, mipped.GetMip(2));
+  Blit(b, GetSwapchainImage());
+  Fill(a);
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.build_dependency_graph = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    auto script_events = script.RunScript({});
+    if(!script_events.dependency_graph)
+    {
+      std::cout << "Dependency graph test failed: no graph\n";
+      return false;
+    }
+    const auto &graph = script_events.dependency_graph.value();
+    //writing mip 2 does not depend on the writes to mips 0 and 1
+    std::vector<std::vector<size_t>> expected_dependencies = {{}, {}, {}, {2}, {0}, {1}, {4}};
+    std::vector<std::vector<size_t>> expected_levels = {{0, 1, 2}, {3, 4, 5}, {6}};
+    if(graph.dependencies != expected_dependencies || graph.levels != expected_levels || graph.critical_path_length != 3)
+    {
+      std::cout << "Dependency graph test failed: unexpected dependencies\n";
+      return false;
+    }
+    if(graph.barriers.size() != 4 || graph.barriers[0].mip != 0 || graph.barriers[0].dst_invocation != 3 || graph.barriers[3].hazard_type != ls::HazardTypes::write_after_read)
+    {
+      std::cout << "Dependency graph test failed: unexpected barriers\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Dependency graph test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Dependency graph test passed\n";
+  return true;
+}
+
+bool RunCullingTest()
+{
+  std::string passes_source = R"(
+void Fill(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+)";
+  std::string branches_source = passes_source + R"(
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image b = GetImage(uvec2(64, 64), rgba8);
+  Image debug_img = GetImage(uvec2(64, 64), rgba8);
+  Image external_img = GetImage(uvec2(64, 64), rgba8);
+  Image unused_img = GetImage(uvec2(64, 64), rgba8);
+  Fill(a);
+  Fill(debug_img);
+  Blit(a, b);
+  Fill(GetSwapchainImage());
+  Blit(b, GetSwapchainImage());
+  Fill(external_img);
+  MarkExternalOutput(external_img);
+}}
+)";
+  std::string mips_source = passes_source + R"(
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image mipped = GetMippedImage(uvec2(64, 64), rgba8);
+  Fill(mipped.GetMip(0));
+  Blit(mipped.GetMip(0), mipped.GetMip(1));
+  Blit(mipped.GetMip(1), mipped.GetMip(2));
+  Blit(mipped.GetMip(1), GetSwapchainImage());
+}}
+)";
+  ls::ScriptOptions options;
+  options.cull_unused = true;
+  try
+  {
+    ls::LegitScript branches_script;
+    branches_script.SetOptions(options);
+    branches_script.LoadScript(branches_source);
+    auto branches_events = branches_script.RunScript({});
+    auto branches_requests = GetCachedImageRequests(branches_events);
+    std::vector<size_t> expected_invocations = {1, 3};
+    if(!branches_events.culling || branches_events.culling->removed_invocations != expected_invocations || branches_events.script_shader_invocations.size() != 4)
+    {
+      std::cout << "Culling test failed: unexpected invocations removed from branches\n";
+      return false;
+    }
+    //debug_img and unused_img are gone, a, b and external_img are kept
+    if(branches_events.culling->removed_image_ids.size() != 2 || branches_requests.size() != 3 || branches_requests[2].id != branches_events.external_output_ids[0])
+    {
+      std::cout << "Culling test failed: unexpected images removed from branches\n";
+      return false;
+    }
+
+    ls::LegitScript mips_script;
+    mips_script.SetOptions(options);
+    mips_script.LoadScript(mips_source);
+    auto mips_events = mips_script.RunScript({});
+    expected_invocations = {2};
+    if(!mips_events.culling || mips_events.culling->removed_invocations != expected_invocations || !mips_events.culling->removed_image_ids.empty())
+    {
+      std::cout << "Culling test failed: unexpected invocations removed from mip chain\n";
+      return false;
+    }
+
+    //invocation reuse tracking carries cached images into the next frame, so their writes are never dead
+    ls::ScriptOptions reuse_options = options;
+    reuse_options.track_invocation_reuse = true;
+    ls::LegitScript reuse_script;
+    reuse_script.SetOptions(reuse_options);
+    reuse_script.LoadScript(branches_source);
+    for(size_t frame = 0; frame < 2; frame++)
+    {
+      auto reuse_events = reuse_script.RunScript({});
+      expected_invocations = {3};
+      if(!reuse_events.culling || reuse_events.culling->removed_invocations != expected_invocations || !reuse_events.culling->removed_image_ids.empty())
+      {
+        std::cout << "Culling test failed: unexpected invocations removed with invocation reuse in frame " << frame << "\n";
+        return false;
+      }
+      //Fill(debug_img) survived the first frame, so the second one reuses it
+      if(reuse_events.script_shader_invocations.size() != 5 || reuse_events.script_shader_invocations[1].is_reusable != (frame == 1))
+      {
+        std::cout << "Culling test failed: debug_img is not reused in frame " << frame << "\n";
+        return false;
+      }
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Culling test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Culling test passed\n";
+  return true;
+}
+
+//computes a fingerprint of every image mip's contents as if the invocations were executed in the given order
+std::map<std::pair<ls::Image::Id, int>, size_t> SimulateInvocations(const std::vector<ls::ShaderInvocation> &invocations, const ls::ShaderDescs &shader_descs)
+{
+  std::map<std::pair<ls::Image::Id, int>, size_t> mip_contents;
+  auto combine = [](size_t seed, size_t value){ return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2)); };
+  for(const auto &invocation : invocations)
+  {
+    size_t output = std::hash<std::string>()(invocation.shader_name);
+    for(uint8_t byte : invocation.uniform_data)
+      output = combine(output, byte);
+    for(const auto &sampler_binding : invocation.image_sampler_bindings)
+    {
+      for(int mip = sampler_binding.mip_range.x; mip < sampler_binding.mip_range.y; mip++)
+        output = combine(output, mip_contents[{sampler_binding.id, mip}]);
+    }
+    bool is_blended = false;
+    for(const auto &desc : shader_descs)
+      if(desc.name == invocation.shader_name) is_blended = desc.blend_mode != ls::BlendModes::opaque;
+    for(const auto &attachment : invocation.color_attachments)
+    {
+      auto &contents = mip_contents[{attachment.id, attachment.mip_range.x}];
+      contents = is_blended ? combine(output, contents) : output;
+    }
+  }
+  return mip_contents;
+}
+
+bool RunRenderPassScheduleTest()
+{
+  std::string script_source = R"(
+void Fill(vec4 fill_color, out vec4 color)
+{{
+  color = fill_color;
+}}
+[blendmode: additive]
+void Add(vec4 add_color, out vec4 color)
+{{
+  color = add_color;
+}}
+void Combine(sampler2D tex0, sampler2D tex1, out vec4 color)
+{{
+  color = texelFetch(tex0, ivec2(gl_FragCoord.xy), 0) + texelFetch(tex1, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image b = GetImage(uvec2(64, 64), rgba8);
+  Fill(vec4(1.0f), a);
+  Fill(vec4(2.0f), b);
+  Add(vec4(3.0f), a);
+  Add(vec4(4.0f), b);
+  Combine(a, b, GetSwapchainImage());
+}}
+)";
+  try
+  {
+    ls::LegitScript original_script;
+    auto script_contents = original_script.LoadScript(script_source);
+    auto original_events = original_script.RunScript({});
+
+    ls::LegitScript scheduled_script;
+    ls::ScriptOptions options;
+    options.schedule_render_passes = true;
+    scheduled_script.SetOptions(options);
+    scheduled_script.LoadScript(script_source);
+    auto scheduled_events = scheduled_script.RunScript({});
+    if(!scheduled_events.render_pass_schedule)
+    {
+      std::cout << "Render pass schedule test failed: no schedule\n";
+      return false;
+    }
+    const auto &schedule = scheduled_events.render_pass_schedule.value();
+    std::vector<size_t> expected_indices = {0, 2, 1, 3, 4};
+    if(schedule.original_indices != expected_indices || schedule.render_passes.size() != 3 || schedule.unscheduled_render_passes_count != 5)
+    {
+      std::cout << "Render pass schedule test failed: " << schedule.render_passes.size() << " render passes\n";
+      return false;
+    }
+    auto original_contents = SimulateInvocations(original_events.script_shader_invocations, script_contents.shader_descs);
+    auto scheduled_contents = SimulateInvocations(scheduled_events.script_shader_invocations, script_contents.shader_descs);
+    if(original_contents != scheduled_contents)
+    {
+      std::cout << "Render pass schedule test failed: scheduled invocations produce different images\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Render pass schedule test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Render pass schedule test passed\n";
+  return true;
+}
+
+bool RunAttachmentOpsTest()
+{
+  std::string script_source = R"(
+void Fill(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+[blendmode: additive]
+void Add(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image mipped = GetMippedImage(uvec2(64, 64), rgba8);
+  Image scratch = GetImage(uvec2(64, 64), rgba8);
+  Fill(a);
+  Add(a);
+  Blit(a, mipped.GetMip(0));
+  Fill(scratch);
+  Blit(mipped, GetSwapchainImage());
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.infer_attachment_ops = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    auto script_events = script.RunScript({});
+    using L = ls::LoadOps;
+    using S = ls::StoreOps;
+    std::vector<std::pair<L, S>> expected_ops = {{L::dont_care, S::store}, {L::load, S::store}, {L::dont_care, S::store}, {L::dont_care, S::dont_care}, {L::dont_care, S::store}};
+    const auto &invocations = script_events.script_shader_invocations;
+    for(size_t invocation_idx = 0; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      const auto &ops = invocations[invocation_idx].color_attachment_ops;
+      if(ops.size() != 1 || ops[0].load_op != expected_ops[invocation_idx].first || ops[0].store_op != expected_ops[invocation_idx].second)
+      {
+        std::cout << "Attachment ops test failed: unexpected ops for invocation " << invocation_idx << "\n";
+        return false;
+      }
+    }
+    auto image_requests = GetCachedImageRequests(script_events);
+    if(!image_requests[0].usage || !image_requests[1].usage || !image_requests[2].usage)
+    {
+      std::cout << "Attachment ops test failed: image usage is missing\n";
+      return false;
+    }
+    const auto &a_usage = image_requests[0].usage.value();
+    const auto &mipped_usage = image_requests[1].usage.value();
+    const auto &scratch_usage = image_requests[2].usage.value();
+    if(!a_usage.is_sampled || !a_usage.is_render_target || a_usage.is_mip_sampled || !mipped_usage.is_mip_sampled || scratch_usage.is_sampled || !scratch_usage.is_render_target)
+    {
+      std::cout << "Attachment ops test failed: unexpected image usage\n";
+      return false;
+    }
+    ls::LegitScript plain_script;
+    plain_script.LoadScript(script_source);
+    auto plain_requests = GetCachedImageRequests(plain_script.RunScript({}));
+    if(plain_requests.empty() || plain_requests[0].usage)
+    {
+      std::cout << "Attachment ops test failed: image usage reported without infer_attachment_ops\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Attachment ops test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Attachment ops test passed\n";
+  return true;
+}
+
+std::vector<ls::PersistentImageRequest> GetPersistentImageRequests(const ls::ScriptEvents &script_events)
+{
+  std::vector<ls::PersistentImageRequest> image_requests;
+  for(const auto &request : script_events.context_requests)
+  {
+    if(std::holds_alternative<ls::PersistentImageRequest>(request))
+      image_requests.push_back(std::get<ls::PersistentImageRequest>(request));
+  }
+  return image_requests;
+}
+
+bool RunPersistentImagesTest()
+{
+  std::string script_source = R"(
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  uint size = uint(SliderInt("Size", 1, 1024, 64));
+  Image accum = GetPersistentImage("accum", uvec2(size, size), rgba16f);
+  Image history = GetHistoryImage("accum");
+  Image single = GetPersistentImage("single", uvec2(16, 16), rgba8);
+  Blit(history, accum);
+  Blit(accum, GetSwapchainImage());
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.cull_unused = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    std::vector<std::vector<ls::PersistentImageRequest>> frames_requests;
+    for(size_t frame = 0; frame < 3; frame++)
+    {
+      auto script_events = script.RunScript({});
+      if(script_events.culling->removed_invocations.size() != 0)
+      {
+        std::cout << "Persistent images test failed: persistent image writes were culled\n";
+        return false;
+      }
+      frames_requests.push_back(GetPersistentImageRequests(script_events));
+    }
+    //requests are accum, its history and single
+    for(const auto &requests : frames_requests)
+    {
+      if(requests.size() != 3 || requests[0].is_history || !requests[1].is_history || requests[2].id != frames_requests[0][2].id)
+      {
+        std::cout << "Persistent images test failed: unexpected requests\n";
+        return false;
+      }
+    }
+    bool is_swapped =
+      frames_requests[1][0].id == frames_requests[0][1].id && frames_requests[1][1].id == frames_requests[0][0].id &&
+      frames_requests[2][0].id == frames_requests[0][0].id;
+    //single is never written, so it never gets a version
+    bool is_versioned =
+      frames_requests[0][0].version == 1 && frames_requests[0][1].version == 0 &&
+      frames_requests[2][0].version == 3 && frames_requests[2][1].version == 2 && frames_requests[2][2].version == 0;
+    if(!is_swapped || !is_versioned)
+    {
+      std::cout << "Persistent images test failed: history copies are not swapped every frame\n";
+      return false;
+    }
+    auto resized_events = script.RunScript({{"Size", 128}});
+    auto resized_requests = GetPersistentImageRequests(resized_events);
+    if(resized_events.image_invalidations.size() != 2 || resized_requests[0].version != 4 || resized_requests[1].version != 0)
+    {
+      std::cout << "Persistent images test failed: resized copies were not invalidated\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Persistent images test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Persistent images test passed\n";
+  return true;
+}
+
+bool RunInvocationReuseTest()
+{
+  std::string script_source = R"(
+void Fill(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+[blendmode: additive]
+void Add(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+void Scale(float scale, sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0) * scale;
+}}
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image lut = GetImage(uvec2(64, 64), rgba8);
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image b = GetImage(uvec2(64, 64), rgba8);
+  Image c = GetImage(uvec2(64, 64), rgba8);
+  Image d = GetImage(uvec2(64, 64), rgba8);
+  Fill(lut);
+  Scale(SliderFloat("S", 0.0f, 1.0f, 0.5f), lut, a);
+  Blit(a, b);
+  Fill(c);
+  Scale(SliderFloat("T", 0.0f, 1.0f, 0.5f), c, d);
+  Add(c);
+  Blit(b, GetSwapchainImage());
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.track_invocation_reuse = true;
+  script.SetOptions(options);
+  auto get_reusable = [](const ls::ScriptEvents &script_events)
+  {
+    std::vector<bool> is_reusable;
+    for(const auto &invocation : script_events.script_shader_invocations)
+      is_reusable.push_back(invocation.is_reusable);
+    return is_reusable;
+  };
+  try
+  {
+    script.LoadScript(script_source);
+    //nothing is reusable until the images were written once. the swapchain write never is
+    std::vector<std::vector<ls::ContextInput>> frames_inputs = {{}, {}, {{"T", 0.25f}}, {{"S", 0.25f}, {"T", 0.25f}}};
+    std::vector<std::vector<bool>> expected_reusable = {
+      {false, false, false, false, false, false, false},
+      {true, true, true, true, true, true, false},
+      //d reads c before Add() blends into it, so the whole chain of c has to run again
+      {true, true, true, false, false, false, false},
+      {true, false, false, true, true, true, false}
+    };
+    for(size_t frame = 0; frame < frames_inputs.size(); frame++)
+    {
+      auto script_events = script.RunScript(frames_inputs[frame]);
+      if(get_reusable(script_events) != expected_reusable[frame])
+      {
+        std::cout << "Invocation reuse test failed: unexpected reusable invocations in frame " << frame << "\n";
+        return false;
+      }
+      if(frame == 3)
+      {
+        //lut was written once, a changed in the first and the last frame
+        auto lut_id = script_events.script_shader_invocations[0].color_attachments[0].id;
+        auto a_id = script_events.script_shader_invocations[1].color_attachments[0].id;
+        for(const auto &content_version : script_events.invocation_reuse->image_content_versions)
+        {
+          if((content_version.id == lut_id && content_version.version != 1) || (content_version.id == a_id && content_version.version != 2))
+          {
+            std::cout << "Invocation reuse test failed: unexpected content versions\n";
+            return false;
+          }
+        }
+      }
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Invocation reuse test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Invocation reuse test passed\n";
+  return true;
+}
+
+bool RunFrameMemoizationTest()
+{
+  std::string script_source = R"(
+void Fill(vec4 fill_color, out vec4 color)
+{{
+  color = fill_color;
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  float brightness = SliderFloat("Brightness", 0.0f, 1.0f, 0.5f);
+  if(Checkbox("Count frames", false))
+  {
+    ContextInt("frames_count") += 1;
+  }
+  Fill(vec4(brightness), GetSwapchainImage());
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.memoize_frames = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    //the script never reads the time, so it does not matter that it changes
+    std::vector<std::vector<ls::ContextInput>> frames_inputs = {
+      {{"@time", 0.0f}},
+      {{"@time", 1.0f}},
+      {{"@time", 2.0f}, {"Brightness", 0.75f}},
+      {{"@time", 3.0f}},
+      {{"Count frames", 1}},
+      {{"Count frames", 1}}
+    };
+    //a script writing to its context has to run every frame
+    std::vector<bool> expected_memoized = {false, true, false, true, false, false};
+    for(size_t frame = 0; frame < frames_inputs.size(); frame++)
+    {
+      auto script_events = script.RunScript(frames_inputs[frame]);
+      if(script_events.is_memoized != expected_memoized[frame] || script_events.script_shader_invocations.size() != 1)
+      {
+        std::cout << "Frame memoization test failed: unexpected memoization in frame " << frame << "\n";
+        return false;
+      }
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Frame memoization test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Frame memoization test passed\n";
+  return true;
+}
+
+bool RunStaticFramesTest()
+{
+  std::string passes_source = R"(
+void Fill(float value, out vec4 color)
+{{
+  color = vec4(value);
+}}
+void Blit(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+)";
+  std::string static_source = passes_source + R"(
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image half_res = GetImage(GetSwapchainImage().GetSize() / 2, rgba8);
+  Fill(1.0f, half_res);
+  Blit(half_res, GetSwapchainImage());
+}}
+)";
+  //the slider is only reached through another function
+  std::string dynamic_source = passes_source + R"(
+[declaration: "helpers"]
+{{
+  float GetValue()
+  {
+    return SliderFloat("Value", 0.0f, 1.0f, 0.5f);
+  }
+}}
+[rendergraph]
+[include: "helpers"]
+void RenderGraphMain()
+{{
+  Fill(GetValue(), GetSwapchainImage());
+}}
+)";
+  ls::ScriptOptions options;
+  options.cache_frames_by_inputs = true;
+  try
+  {
+    ls::LegitScript dynamic_script;
+    dynamic_script.SetOptions(options);
+    if(dynamic_script.LoadScript(dynamic_source).is_static_render_graph)
+    {
+      std::cout << "Static frames test failed: a graph reading a slider is static\n";
+      return false;
+    }
+    //frames of a graph reading a slider are cached per slider value
+    std::vector<float> values = {0.25f, 0.75f, 0.25f, 0.75f, 0.5f};
+    std::vector<bool> expected_dynamic_memoized = {false, false, true, true, false};
+    for(size_t frame = 0; frame < values.size(); frame++)
+    {
+      auto script_events = dynamic_script.RunScript({{"Value", values[frame]}});
+      float value = *(float*)script_events.script_shader_invocations[0].uniform_data.data();
+      if(script_events.is_memoized != expected_dynamic_memoized[frame] || value != values[frame])
+      {
+        std::cout << "Static frames test failed: unexpected events of the dynamic graph in frame " << frame << "\n";
+        return false;
+      }
+    }
+    //filling the cache drops the least recently served values first
+    for(size_t value_idx = 0; value_idx < 16; value_idx++)
+    {
+      dynamic_script.RunScript({{"Value", 0.01f * float(value_idx + 1)}});
+      dynamic_script.RunScript({{"Value", 0.25f}});
+    }
+    bool is_recent_kept = dynamic_script.RunScript({{"Value", 0.25f}}).is_memoized && dynamic_script.RunScript({{"Value", 0.02f}}).is_memoized;
+    bool is_old_dropped = !dynamic_script.RunScript({{"Value", 0.01f}}).is_memoized;
+    if(!is_recent_kept || !is_old_dropped)
+    {
+      std::cout << "Static frames test failed: cached frames are not evicted in the order of use\n";
+      return false;
+    }
+
+    ls::LegitScript static_script;
+    static_script.SetOptions(options);
+    if(!static_script.LoadScript(static_source).is_static_render_graph)
+    {
+      std::cout << "Static frames test failed: static graph not detected\n";
+      return false;
+    }
+    std::vector<unsigned int> swapchain_widths = {512, 1024, 512, 1024};
+    std::vector<bool> expected_memoized = {false, false, true, true};
+    for(size_t frame = 0; frame < swapchain_widths.size(); frame++)
+    {
+      auto script_events = static_script.RunScript({{"@swapchain_size", ls::uvec2{swapchain_widths[frame], 256}}});
+      auto image_requests = GetCachedImageRequests(script_events);
+      bool is_size_matching = image_requests.size() == 1 && image_requests[0].size.x == swapchain_widths[frame] / 2;
+      if(script_events.is_memoized != expected_memoized[frame] || !is_size_matching || (frame > 0 && script_events.image_invalidations.size() != 1))
+      {
+        std::cout << "Static frames test failed: unexpected events in frame " << frame << "\n";
+        return false;
+      }
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Static frames test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Static frames test passed\n";
+  return true;
+}
+
+bool RunComputePassTest()
+{
+  std::string script_source = R"(
+[numthreads(8, 8, 1)]
+void Reduce(sampler2D src, float scale)
+{{
+  float val = texelFetch(src, ivec2(gl_GlobalInvocationID.xy), 0).r * scale;
+}}
+[numthreads(8, 8, 1)]
+void Fill(writeonly image2D<rgba16f> dst)
+{{
+  imageStore(dst, ivec2(gl_GlobalInvocationID.xy), vec4(1.0f));
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image img = GetImage(uvec2(100, 60), rgba16f);
+  Fill(img);
+  Reduce(img.GetMip(0), 1.0f, uvec3(2, 3, 4));
+  if(Checkbox("Implicit reduce", false))
+    Reduce(img, 1.0f);
+}}
+)";
+  ls::LegitScript script;
+  try
+  {
+    auto script_contents = script.LoadScript(script_source);
+    const auto &desc = script_contents.shader_descs[0];
+    if(desc.pass_type != ls::PassTypes::compute || desc.workgroup_size.x != 8 || desc.workgroup_size.y != 8 || desc.workgroup_size.z != 1)
+    {
+      std::cout << "Compute pass test failed: unexpected shader desc\n";
+      return false;
+    }
+    auto script_events = script.RunScript({});
+    const auto &invocations = script_events.script_shader_invocations;
+    if(invocations.size() != 2 || !invocations[0].groups_count || !invocations[1].groups_count)
+    {
+      std::cout << "Compute pass test failed: dispatches expected\n";
+      return false;
+    }
+    auto implicit_count = invocations[0].groups_count.value();
+    auto explicit_count = invocations[1].groups_count.value();
+    if(implicit_count.x != 13 || implicit_count.y != 8 || implicit_count.z != 1 || explicit_count.x != 2 || explicit_count.y != 3 || explicit_count.z != 4)
+    {
+      std::cout << "Compute pass test failed: unexpected groups count\n";
+      return false;
+    }
+    //a pass that only samples doesn't know its domain
+    try
+    {
+      script.RunScript({{"Implicit reduce", 1}});
+      std::cout << "Compute pass test failed: a dispatch without storage images and groups count was accepted\n";
+      return false;
+    }
+    catch(const ls::ScriptException &)
+    {
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Compute pass test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Compute pass test passed\n";
+  return true;
+}
+
+bool RunStorageImagesTest()
+{
+  std::string script_source = R"(
+[numthreads(8, 8, 1)]
+void Clear(writeonly image2D<rgba16f> state)
+{{
+  imageStore(state, ivec2(gl_GlobalInvocationID.xy), vec4(1.0f));
+}}
+[numthreads(8, 8, 1)]
+void Decay(readwrite image2D<rgba16f> state, float factor)
+{{
+  ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+  imageStore(state, pixel, imageLoad(state, pixel) * factor);
+}}
+void Show(sampler2D tex, out vec4 color)
+{{
+  color = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image state = GetImage(uvec2(64, 32), rgba16f);
+  Clear(state);
+  Decay(state, 0.9f);
+  Decay(state, 0.9f);
+  Show(state, GetSwapchainImage());
+  if(Checkbox("Wrong format", false))
+    Decay(GetImage(uvec2(64, 32), rgba8), 0.9f);
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.build_dependency_graph = true;
+  options.infer_attachment_ops = true;
+  script.SetOptions(options);
+  try
+  {
+    auto script_contents = script.LoadScript(script_source);
+    const auto &decay_images = script_contents.shader_descs[1].images;
+    if(decay_images.size() != 1 || decay_images[0].type != "image2D" || decay_images[0].pixel_format != ls::PixelFormats::rgba16f || decay_images[0].access_qualifier != ls::AccessQualifiers::readwrite)
+    {
+      std::cout << "Storage images test failed: unexpected shader desc images\n";
+      return false;
+    }
+    auto script_events = script.RunScript({});
+    const auto &invocations = script_events.script_shader_invocations;
+    auto groups_count = invocations[1].groups_count.value();
+    if(invocations[0].storage_image_bindings.size() != 1 || invocations[0].storage_image_bindings[0].access_qualifier != ls::AccessQualifiers::writeonly || groups_count.x != 8 || groups_count.y != 4)
+    {
+      std::cout << "Storage images test failed: unexpected storage bindings\n";
+      return false;
+    }
+    //every pass depends on the previous one through the single image
+    const auto &graph = script_events.dependency_graph.value();
+    for(size_t invocation_idx = 1; invocation_idx < invocations.size(); invocation_idx++)
+    {
+      const auto &dependencies = graph.dependencies[invocation_idx];
+      if(std::find(dependencies.begin(), dependencies.end(), invocation_idx - 1) == dependencies.end())
+      {
+        std::cout << "Storage images test failed: missing dependency of invocation " << invocation_idx << "\n";
+        return false;
+      }
+    }
+    auto image_requests = GetCachedImageRequests(script_events);
+    if(image_requests.size() != 1 || !image_requests[0].usage || !image_requests[0].usage->is_storage || !image_requests[0].usage->is_sampled)
+    {
+      std::cout << "Storage images test failed: unexpected image usage\n";
+      return false;
+    }
+    try
+    {
+      script.RunScript({{"Wrong format", 1}});
+      std::cout << "Storage images test failed: an rgba8 image was bound as image2D<rgba16f>\n";
+      return false;
+    }
+    catch(const ls::ScriptException &)
+    {
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Storage images test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Storage images test passed\n";
+  return true;
+}
+
+bool RunInvocationBatchingTest()
+{
+  std::string script_source = R"(
+void Tint(vec4 tint, out vec4 color)
+{{
+  color = tint;
+}}
+void Blur(sampler2D src, float radius, out vec4 color)
+{{
+  color = textureLod(src, gl_FragCoord.xy / vec2(textureSize(src, 0)), radius);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image b = GetImage(uvec2(64, 64), rgba8);
+  Image c = GetImage(uvec2(64, 64), rgba8);
+  Tint(vec4(1.0f, 1.0f, 1.0f, 1.0f), a);
+  Tint(vec4(0.5f, 0.5f, 0.5f, 1.0f), b);
+  Tint(vec4(0.25f, 0.25f, 0.25f, 1.0f), c);
+  Blur(a, 1.0f, b);
+  Blur(b, 2.0f, c);
+  Blur(c, 1.0f, GetSwapchainImage());
+}}
+)";
+  std::string compute_source = R"(
+[numthreads(8, 8, 1)]
+void Clear(writeonly image2D<rgba8> dst, float value)
+{{
+  imageStore(dst, ivec2(gl_GlobalInvocationID.xy), vec4(value));
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image b = GetImage(uvec2(16, 16), rgba8);
+  Clear(a, 1.0f);
+  Clear(b, 0.5f);
+}}
+)";
+  std::string instanced_source = R"(
+[instanced(6, vec2 offset)]
+void Sprites(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  array<SpritesInstance> sprites(2);
+  sprites[0].offset = vec2(1.0f, 2.0f);
+  sprites[1].offset = vec2(3.0f, 4.0f);
+  Image a = GetImage(uvec2(64, 64), rgba8);
+  Image b = GetImage(uvec2(64, 64), rgba8);
+  Sprites(a, 1, sprites);
+  Sprites(b, 2, sprites);
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.batch_invocations = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    auto script_events = script.RunScript({});
+    //the blurs read what the previous blur wrote, so only the tints end up in a batch
+    const auto &batches = script_events.invocation_batches.value();
+    if(batches.size() != 1 || batches[0].shader_name != "Tint" || batches[0].first_invocation != 0 || batches[0].invocations_count != 3)
+    {
+      std::cout << "Invocation batching test failed: unexpected batches\n";
+      return false;
+    }
+    const auto &batch = batches[0];
+    float last_tint = *(float*)(batch.uniform_data.data() + 2 * batch.uniform_stride);
+    if(batch.uniform_stride != sizeof(ls::vec4) || batch.uniform_data.size() != 3 * sizeof(ls::vec4) || last_tint != 0.25f || batch.color_attachments[2][0].id != 3)
+    {
+      std::cout << "Invocation batching test failed: unexpected item tables\n";
+      return false;
+    }
+
+    //dispatches of one compute shader differ in their storage images and groups counts
+    ls::LegitScript compute_script;
+    compute_script.SetOptions(options);
+    compute_script.LoadScript(compute_source);
+    auto compute_events = compute_script.RunScript({});
+    const auto &compute_batches = compute_events.invocation_batches.value();
+    if(compute_batches.size() != 1 || compute_batches[0].storage_image_bindings.size() != 2 || compute_batches[0].groups_counts.size() != 2 ||
+      compute_batches[0].storage_image_bindings[1][0].image.id != compute_events.script_shader_invocations[1].storage_image_bindings[0].image.id ||
+      compute_batches[0].groups_counts[0].x != 8 || compute_batches[0].groups_counts[1].x != 2)
+    {
+      std::cout << "Invocation batching test failed: unexpected compute batch\n";
+      return false;
+    }
+
+    //every item of an instanced batch draws its own instances
+    ls::LegitScript instanced_script;
+    instanced_script.SetOptions(options);
+    instanced_script.LoadScript(instanced_source);
+    auto instanced_events = instanced_script.RunScript({});
+    const auto &instanced_batches = instanced_events.invocation_batches.value();
+    if(instanced_batches.size() != 1 || instanced_batches[0].instances_counts != std::vector<unsigned int>{1, 2} || instanced_batches[0].instance_data.size() != 2 ||
+      instanced_batches[0].instance_data[0].size() != sizeof(ls::vec2) || instanced_batches[0].instance_data[1] != instanced_events.script_shader_invocations[1].instance_data ||
+      !compute_batches[0].instances_counts.empty())
+    {
+      std::cout << "Invocation batching test failed: unexpected instanced batch\n";
+      return false;
+    }
+    ls::SetOptions("{\"batch_invocations\": true}");
+    ls::LoadScript(compute_source);
+    std::string events_json = ls::RunScript("[]");
+    ls::LoadScript(instanced_source);
+    events_json += ls::RunScript("[]");
+    ls::SetOptions("{\"batch_invocations\": false}");
+    for(const std::string &key : {"\"uniform_data\"", "\"storage_image_bindings\"", "\"groups_counts\"", "\"instances_counts\"", "\"instance_data\""})
+    {
+      if(events_json.find("\"invocation_batches\"") == std::string::npos || events_json.find(key) == std::string::npos)
+      {
+        std::cout << "Invocation batching test failed: " << key << " missing from the json batches\n";
+        return false;
+      }
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Invocation batching test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Invocation batching test passed\n";
+  return true;
+}
+
+bool RunInstancedPassTest()
+{
+  std::string script_source = R"(
+[instanced(6, vec2 offset, float size, vec4 color)]
+[blendmode: alphablend]
+void Sprites(vec2 viewport_size, out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  array<SpritesInstance> sprites;
+  for(int i = 0; i < 4; i++)
+  {
+    SpritesInstance sprite;
+    sprite.offset = vec2(float(i) * 10.0f, 5.0f);
+    sprite.size = 2.0f;
+    sprite.color = vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    sprites.insertLast(sprite);
+  }
+  Sprites(vec2(64.0f, 64.0f), GetSwapchainImage(), 3, sprites);
+}}
+)";
+  ls::LegitScript script;
+  try
+  {
+    auto script_contents = script.LoadScript(script_source);
+    const auto &desc = script_contents.shader_descs[0];
+    if(desc.pass_type != ls::PassTypes::instanced || desc.vertices_per_instance != 6 || desc.instance_stride != 28 || desc.instance_attributes.size() != 3 || desc.instance_attributes[2].offset != 12)
+    {
+      std::cout << "Instanced pass test failed: unexpected shader desc\n";
+      return false;
+    }
+    auto script_events = script.RunScript({});
+    const auto &invocations = script_events.script_shader_invocations;
+    if(invocations.size() != 1 || invocations[0].instances_count != 3 || invocations[0].instance_data.size() != 3 * desc.instance_stride)
+    {
+      std::cout << "Instanced pass test failed: unexpected instance buffer\n";
+      return false;
+    }
+    float last_offset_x = *(float*)(invocations[0].instance_data.data() + 2 * desc.instance_stride);
+    if(last_offset_x != 20.0f)
+    {
+      std::cout << "Instanced pass test failed: unexpected instance data\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Instanced pass test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Instanced pass test passed\n";
+  return true;
+}
+
+bool RunJitTest()
+{
+  std::string script_source = R"(
+void Shade(float a, int b, uint c, vec2 d, out vec4 color)
+{{
+  color = vec4(a, float(b), float(c), d.x + d.y);
+}}
+[declaration: "helpers"]
+{{
+  float Falloff(float dist, float radius)
+  {
+    float t = dist / radius;
+    return t >= 1.0f ? 0.0f : (1.0f - t * t);
+  }
+  int Fold(int v, int div)
+  {
+    return (v / div) ^ (v % div) << 2;
+  }
+}}
+[rendergraph]
+[include: "helpers"]
+void RenderGraphMain()
+{{
+  int cascades = SliderInt("Cascades", 1, 8, 4);
+  float split = SliderFloat("Split", 0.0f, 1.0f, 0.7f);
+  uint mask = 0xf0f0f0f0;
+  double acc = 0.0;
+  for(int cascade = 0; cascade < cascades; cascade++)
+  {
+    float dist = float(cascade * cascade) * split - 0.5f;
+    int folded = Fold(cascade * 37 - 50, cascade * 2 - 3);
+    uint bits = (mask >> uint(cascade)) | uint(cascade) & 0x0f;
+    if(!(dist < 0.0f) && cascade != 2)
+      acc += double(Falloff(dist, 10.0f));
+    else
+      acc -= double(dist) * 0.5;
+    Shade(Falloff(dist, float(cascades)) / (dist != 0.0f ? dist : 1.0f), -folded, bits, vec2(float(acc), float(bits % 7)), GetSwapchainImage());
+  }
+  Text("acc " + to_string(float(acc)));
+}}
+)";
+  std::vector<ls::ScriptEvents> events;
+  for(bool jit_compile : {false, true})
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.jit_compile = jit_compile;
+    script.SetOptions(options);
+    try
+    {
+      auto script_contents = script.LoadScript(script_source);
+#if defined(__x86_64__) && defined(__linux__)
+      if(jit_compile && script_contents.jit_compiled_functions_count == 0)
+      {
+        std::cout << "Jit test failed: no functions were compiled\n";
+        return false;
+      }
+#endif
+      events.push_back(script.RunScript({}));
+    }
+    catch(const std::exception &e)
+    {
+      std::cout << "Jit test failed: " << e.what() << "\n";
+      return false;
+    }
+  }
+  const auto &interpreted_invocations = events[0].script_shader_invocations;
+  const auto &jit_invocations = events[1].script_shader_invocations;
+  if(interpreted_invocations.size() != 4 || jit_invocations.size() != interpreted_invocations.size())
+  {
+    std::cout << "Jit test failed: unexpected invocations count\n";
+    return false;
+  }
+  for(size_t invocation_idx = 0; invocation_idx < jit_invocations.size(); invocation_idx++)
+  {
+    if(jit_invocations[invocation_idx].uniform_data != interpreted_invocations[invocation_idx].uniform_data)
+    {
+      std::cout << "Jit test failed: uniforms of invocation " << invocation_idx << " differ from the interpreter\n";
+      return false;
+    }
+  }
+  const auto &interpreted_text = std::get<ls::TextRequest>(events[0].context_requests.back()).text;
+  const auto &jit_text = std::get<ls::TextRequest>(events[1].context_requests.back()).text;
+  if(jit_text != interpreted_text)
+  {
+    std::cout << "Jit test failed: text differs from the interpreter\n";
+    return false;
+  }
+
+  //script exceptions raised in native code have to be reported like in the interpreter
+  std::string division_source = R"(
+[rendergraph]
+void RenderGraphMain()
+{{
+  int zero = SliderInt("Zero", 0, 1, 0);
+  int v = 10;
+  v = v / zero;
+}}
+)";
+  std::vector<std::string> errors;
+  for(bool jit_compile : {false, true})
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.jit_compile = jit_compile;
+    script.SetOptions(options);
+    try
+    {
+      script.LoadScript(division_source);
+      script.RunScript({});
+    }
+    catch(const std::exception &e)
+    {
+      errors.push_back(e.what());
+    }
+  }
+  if(errors.size() != 2 || errors[0] != errors[1])
+  {
+    std::cout << "Jit test failed: division by zero is reported differently\n";
+    return false;
+  }
+  std::cout << "Jit test passed\n";
+  return true;
+}
+
+bool RunAotTest()
+{
+  //AotTestScript.cpp is generated from the same script by the aot tool, so the default options load it from the registry
+  std::ifstream file_stream("../data/Scripts/aot_test.ls");
+  std::stringstream string_stream;
+  string_stream << file_stream.rdbuf();
+  std::vector<std::vector<ls::ContextInput>> frames_inputs = {{}, {{"Cascades", 6}, {"Split", 0.25f}}, {{"Cascades", 1}}};
+
+  std::vector<std::vector<ls::ScriptEvents>> events;
+  for(bool load_aot_render_graphs : {false, true})
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.load_aot_render_graphs = load_aot_render_graphs;
+    script.SetOptions(options);
+    events.emplace_back();
+    try
+    {
+      auto script_contents = script.LoadScript(string_stream.str());
+      if(script_contents.is_aot_render_graph != load_aot_render_graphs)
+      {
+        std::cout << "Aot test failed: unexpected is_aot_render_graph\n";
+        return false;
+      }
+      for(const auto &frame_inputs : frames_inputs)
+        events.back().push_back(script.RunScript(frame_inputs));
+    }
+    catch(const std::exception &e)
+    {
+      std::cout << "Aot test failed: " << e.what() << "\n";
+      return false;
+    }
+  }
+
+  auto is_same_image = [](const ls::Image &a, const ls::Image &b)
+  {
+    return a.id == b.id && a.mip_range.x == b.mip_range.x && a.mip_range.y == b.mip_range.y;
+  };
+  for(size_t frame_idx = 0; frame_idx < frames_inputs.size(); frame_idx++)
+  {
+    const auto &compiled_events = events[0][frame_idx];
+    const auto &aot_events = events[1][frame_idx];
+    if(aot_events.script_shader_invocations.size() != compiled_events.script_shader_invocations.size() ||
+      aot_events.context_requests.size() != compiled_events.context_requests.size())
+    {
+      std::cout << "Aot test failed: frame " << frame_idx << " has unexpected events count\n";
+      return false;
+    }
+    for(size_t invocation_idx = 0; invocation_idx < aot_events.script_shader_invocations.size(); invocation_idx++)
+    {
+      const auto &compiled_invocation = compiled_events.script_shader_invocations[invocation_idx];
+      const auto &aot_invocation = aot_events.script_shader_invocations[invocation_idx];
+      bool is_same = 
+        aot_invocation.shader_name == compiled_invocation.shader_name &&
+        aot_invocation.uniform_data == compiled_invocation.uniform_data &&
+        aot_invocation.color_attachments.size() == compiled_invocation.color_attachments.size() &&
+        aot_invocation.image_sampler_bindings.size() == compiled_invocation.image_sampler_bindings.size();
+      for(size_t attachment_idx = 0; is_same && attachment_idx < aot_invocation.color_attachments.size(); attachment_idx++)
+        is_same &= is_same_image(aot_invocation.color_attachments[attachment_idx], compiled_invocation.color_attachments[attachment_idx]);
+      for(size_t binding_idx = 0; is_same && binding_idx < aot_invocation.image_sampler_bindings.size(); binding_idx++)
+        is_same &= is_same_image(aot_invocation.image_sampler_bindings[binding_idx], compiled_invocation.image_sampler_bindings[binding_idx]);
+      if(!is_same)
+      {
+        std::cout << "Aot test failed: invocation " << invocation_idx << " of frame " << frame_idx << " differs from the compiled script\n";
+        return false;
+      }
+    }
+    const auto &compiled_text = std::get<ls::TextRequest>(compiled_events.context_requests.back()).text;
+    const auto &aot_text = std::get<ls::TextRequest>(aot_events.context_requests.back()).text;
+    if(aot_text != compiled_text)
+    {
+      std::cout << "Aot test failed: text of frame " << frame_idx << " differs from the compiled script\n";
+      return false;
+    }
+  }
+  std::cout << "Aot test passed\n";
+  return true;
+}
+
+bool RunByteCodeOptimizerTest()
+{
+  std::string script_source = R"(
+void Shade(vec4 a, vec3 b, vec2 c, ivec3 d, float e, int f, out vec4 color)
+{{
+  color = a + vec4(b, c.x) * c.y + vec4(float(d.x + d.y + d.z), e, float(f), 1.0f);
+}}
+[declaration: "helpers"]
+{{
+  float Scale(float x) { return x * 2.5f; }
+  float Sum(float a, float b) { return a + b; }
+  int Mix(int a, int b) { return a ^ b; }
+  float Ratio(float a, float b) { return a / b; }
+}}
+[rendergraph]
+[include: "helpers"]
+void RenderGraphMain()
+{{
+  int count = SliderInt("Count", 1, 8, 5);
+  float t = SliderFloat("T", 0.0f, 1.0f, 0.25f);
+  vec4 a = vec4(1.0f, 2.0f, 3.0f, 4.0f);
+  vec3 b = vec3(0.5f);
+  vec2 c;
+  ivec3 d = ivec3(1, 2, 3);
+  for(int i = 0; i < count; i++)
+  {
+    c = vec2(t, i % 2 == 0 ? 1.0f : -1.0f);
+    b = vec3(Scale(t), Sum(t, float(i)), Ratio(t, float(i + 1)));
+    a = a * 0.5f + vec4(0.25f);
+    d = ivec3(Mix(i, count), i, 7);
+    Shade(a, b, c, d, Sum(Scale(t), b.x), Mix(i, 3), GetSwapchainImage());
+  }
+  Text("a " + a + " b " + b);
+}}
+)";
+  struct Config
+  {
+    bool optimize_byte_code;
+    bool jit_compile;
+  };
+  std::vector<ls::ScriptEvents> events;
+  for(auto config : {Config{false, false}, Config{true, false}, Config{true, true}})
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.optimize_byte_code = config.optimize_byte_code;
+    options.jit_compile = config.jit_compile;
+    script.SetOptions(options);
+    try
+    {
+      auto script_contents = script.LoadScript(script_source);
+      if((script_contents.byte_code_rewrites_count > 0) != config.optimize_byte_code)
+      {
+        std::cout << "Byte code optimizer test failed: unexpected rewrites count " << script_contents.byte_code_rewrites_count << "\n";
+        return false;
+      }
+      events.push_back(script.RunScript({{"Count", 6}, {"T", 0.75f}}));
+    }
+    catch(const std::exception &e)
+    {
+      std::cout << "Byte code optimizer test failed: " << e.what() << "\n";
+      return false;
+    }
+  }
+  const auto &reference_events = events[0];
+  if(reference_events.script_shader_invocations.size() != 6)
+  {
+    std::cout << "Byte code optimizer test failed: unexpected invocations count\n";
+    return false;
+  }
+  for(size_t config_idx = 1; config_idx < events.size(); config_idx++)
+  {
+    const auto &optimized_events = events[config_idx];
+    if(optimized_events.script_shader_invocations.size() != reference_events.script_shader_invocations.size())
+    {
+      std::cout << "Byte code optimizer test failed: invocations count differs\n";
+      return false;
+    }
+    for(size_t invocation_idx = 0; invocation_idx < optimized_events.script_shader_invocations.size(); invocation_idx++)
+    {
+      if(optimized_events.script_shader_invocations[invocation_idx].uniform_data != reference_events.script_shader_invocations[invocation_idx].uniform_data)
+      {
+        std::cout << "Byte code optimizer test failed: uniforms of invocation " << invocation_idx << " differ from the unoptimized script\n";
+        return false;
+      }
+    }
+    if(std::get<ls::TextRequest>(optimized_events.context_requests.back()).text != std::get<ls::TextRequest>(reference_events.context_requests.back()).text)
+    {
+      std::cout << "Byte code optimizer test failed: text differs from the unoptimized script\n";
+      return false;
+    }
+  }
+  std::cout << "Byte code optimizer test passed\n";
+  return true;
+}
+
+bool RunStatsTest()
+{
+  std::string script_source = R"(
+void Shade(vec4 tint, float v, out vec4 color)
+{{
+  color = tint * v;
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  float v = SliderFloat("Value", 0.0f, 1.0f, 0.5f);
+  int count = SliderInt("Count", 1, 8, 3);
+  bool is_tinted = Checkbox("Tinted", false);
+  Text("count " + count);
+  Image img = GetImage(uvec2(16, 16), rgba8);
+  for(int i = 0; i < count; i++)
+    Shade(vec4(1.0f), v, img);
+  Shade(is_tinted ? vec4(0.5f) : vec4(1.0f), v, GetSwapchainImage());
+}}
+)";
+  //every invocation uploads a vec4 and a float
+  const size_t invocation_uniform_bytes = sizeof(ls::vec4) + sizeof(float);
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.collect_stats = true;
+  script.SetOptions(options);
+  try
+  {
+    script.LoadScript(script_source);
+    auto stats = script.RunScript({{"Count", 4}}).stats.value();
+    bool is_request_count_matching = stats.float_requests_count == 1 && stats.int_requests_count == 1 && stats.bool_requests_count == 1 &&
+      stats.text_requests_count == 1 && stats.cached_image_requests_count == 1 && stats.color_requests_count == 0 &&
+      stats.loaded_image_requests_count == 0 && stats.persistent_image_requests_count == 0;
+    if(stats.pass_invocations_count != 5 || !is_request_count_matching || stats.uniform_bytes_count != 5 * invocation_uniform_bytes)
+    {
+      std::cout << "Stats test failed: unexpected event counts\n";
+      return false;
+    }
+    //sliders, checkbox, text, both image getters and five pass calls at least
+    if(stats.binding_calls_count < 11 || stats.binding_time_ms <= 0.0 || stats.vm_time_ms < 0.0 || stats.total_time_ms < stats.binding_time_ms + stats.vm_time_ms)
+    {
+      std::cout << "Stats test failed: unexpected vm and binding stats\n";
+      return false;
+    }
+    options.collect_stats = false;
+    script.SetOptions(options);
+    if(script.RunScript({{"Count", 4}}).stats)
+    {
+      std::cout << "Stats test failed: stats reported without collect_stats\n";
+      return false;
+    }
+
+    ls::SetOptions("{\"collect_stats\": true}");
+    ls::LoadScript(script_source);
+    auto events_json = nlohmann::json::parse(ls::RunScript("[{\"name\": \"Count\", \"type\": \"int\", \"value\": 2}]"));
+    ls::SetOptions("{\"collect_stats\": false}");
+    auto plain_events_json = nlohmann::json::parse(ls::RunScript("[]"));
+    if(!events_json.contains("stats") || plain_events_json.contains("stats"))
+    {
+      std::cout << "Stats test failed: collect_stats json option is ignored\n";
+      return false;
+    }
+    const auto &json_stats = events_json["stats"];
+    const auto &json_request_counts = json_stats["context_requests_count"];
+    bool is_json_matching = json_stats["pass_invocations_count"] == 3 && json_stats["uniform_bytes_count"] == 3 * invocation_uniform_bytes &&
+      json_request_counts["FloatRequest"] == 1 && json_request_counts["IntRequest"] == 1 && json_request_counts["BoolRequest"] == 1 &&
+      json_request_counts["TextRequest"] == 1 && json_request_counts["CachedImageRequest"] == 1 && json_request_counts["ColorRequest"] == 0 &&
+      json_stats["binding_calls_count"] >= 9 && json_stats["binding_time_ms"] > 0.0 && json_stats["vm_time_ms"] >= 0.0;
+    if(!is_json_matching)
+    {
+      std::cout << "Stats test failed: unexpected json stats\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Stats test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Stats test passed\n";
+  return true;
+}
+
+bool RunVmStatsTest()
+{
+  std::string script_source = R"(
+void Shade(float v, out vec4 color)
+{{
+  color = vec4(v);
+}}
+[declaration: "helpers"]
+{{
+  float Scale(float x) { return x * 2.5f; }
+}}
+[rendergraph]
+[include: "helpers"]
+void RenderGraphMain()
+{{
+  int count = SliderInt("Count", 1, 8, 5);
+  for(int i = 0; i < count; i++)
+    Shade(Scale(float(i)), GetSwapchainImage());
+}}
+)";
+  ls::LegitScript script;
+  ls::ScriptOptions options;
+  options.collect_stats = true;
+  script.SetOptions(options);
+  std::vector<ls::ScriptStats> frame_stats;
+  try
+  {
+    script.LoadScript(script_source);
+    for(size_t frame_idx = 0; frame_idx < 2; frame_idx++)
+      frame_stats.push_back(script.RunScript({{"Count", 6}}).stats.value());
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Vm stats test failed: " << e.what() << "\n";
+    return false;
+  }
+  auto find_count = [](const std::vector<ls::ScriptStats::VmCount> &counts, const std::string &name) -> size_t
+  {
+    for(const auto &count : counts)
+    {
+      if(count.name.find(name) != std::string::npos)
+        return count.count;
+    }
+    return 0;
+  };
+  for(const auto &stats : frame_stats)
+  {
+#if !LEGIT_SCRIPT_VM_STATS
+    //the hooks are compiled out of the interpreter, nothing is counted
+    if(!stats.opcode_counts.empty() || !stats.registered_call_counts.empty() || !stats.script_call_counts.empty())
+    {
+      std::cout << "Vm stats test failed: counted without LEGIT_SCRIPT_VM_STATS\n";
+      return false;
+    }
+    continue;
+#endif
+    if(stats.opcode_counts.empty() || stats.registered_call_counts.empty() || stats.script_call_counts.empty())
+    {
+      std::cout << "Vm stats test failed: nothing counted with LEGIT_SCRIPT_VM_STATS\n";
+      return false;
+    }
+    if(find_count(stats.script_call_counts, "Scale(") != 6 || find_count(stats.script_call_counts, " main(") != 1)
+    {
+      std::cout << "Vm stats test failed: unexpected script function entries\n";
+      return false;
+    }
+    if(find_count(stats.registered_call_counts, "SliderInt(") != 1)
+    {
+      std::cout << "Vm stats test failed: unexpected registered function calls\n";
+      return false;
+    }
+    if(find_count(stats.opcode_counts, "RET") < 7)
+    {
+      std::cout << "Vm stats test failed: unexpected opcode counts\n";
+      return false;
+    }
+    for(size_t idx = 1; idx < stats.opcode_counts.size(); idx++)
+    {
+      if(stats.opcode_counts[idx - 1].count < stats.opcode_counts[idx].count)
+      {
+        std::cout << "Vm stats test failed: opcode counts are not sorted\n";
+        return false;
+      }
+    }
+  }
+  //counters start over every frame
+  if(frame_stats[0].opcode_counts.size() != frame_stats[1].opcode_counts.size() ||
+    find_count(frame_stats[0].opcode_counts, "RET") != find_count(frame_stats[1].opcode_counts, "RET"))
+  {
+    std::cout << "Vm stats test failed: counts differ between identical frames\n";
+    return false;
+  }
+  std::cout << "Vm stats test passed\n";
+  return true;
+}
+
+bool RunFrameGcTest()
+{
+  std::string script_source = R"(
+void Shade(float v, out vec4 color)
+{{
+  color = vec4(v);
+}}
+[declaration: "nodes"]
+{{
+  class Node
+  {
+    Node @next;
+  }
+}}
+[rendergraph]
+[include: "nodes"]
+void RenderGraphMain()
+{{
+  int count = SliderInt("Count", 1, 100, 50);
+  for(int i = 0; i < count; i++)
+  {
+    Node a;
+    Node b;
+    @a.next = b;
+    @b.next = a;
+  }
+  Shade(1.0f, GetSwapchainImage());
+}}
+)";
+  auto run_frames = [&](double gc_time_budget_ms, size_t gc_full_cycle_objects_count, size_t frames_count, std::vector<ls::ScriptStats> &frame_stats)
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.collect_stats = true;
+    options.gc_time_budget_ms = gc_time_budget_ms;
+    options.gc_full_cycle_objects_count = gc_full_cycle_objects_count;
+    script.SetOptions(options);
+    script.LoadScript(script_source);
+    for(size_t frame_idx = 0; frame_idx < frames_count; frame_idx++)
+      frame_stats.push_back(script.RunScript({{"Count", 50}}).stats.value());
+  };
+  std::vector<ls::ScriptStats> incremental_stats;
+  std::vector<ls::ScriptStats> full_cycle_stats;
+  std::vector<ls::ScriptStats> single_step_stats;
+  try
+  {
+    run_frames(1000.0, 1000000, 20, incremental_stats);
+    run_frames(1000.0, 1, 5, full_cycle_stats);
+    run_frames(0.0, 1000000, 5, single_step_stats);
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Frame gc test failed: " << e.what() << "\n";
+    return false;
+  }
+  //every frame leaves 100 objects in cycles behind. with an unlimited budget the steps keep up with them
+  size_t destroyed_objects_count = 0;
+  for(const auto &stats : incremental_stats)
+  {
+    if(stats.is_gc_full_cycle || stats.gc_steps_count == 0 || stats.gc_objects_count > 300)
+    {
+      std::cout << "Frame gc test failed: incremental collection falls behind (" << stats.gc_objects_count << " objects)\n";
+      return false;
+    }
+    destroyed_objects_count += stats.gc_destroyed_objects_count;
+  }
+  if(destroyed_objects_count < 100 * incremental_stats.size() - 300)
+  {
+    std::cout << "Frame gc test failed: incremental collection destroyed " << destroyed_objects_count << " objects\n";
+    return false;
+  }
+  for(const auto &stats : full_cycle_stats)
+  {
+    if(!stats.is_gc_full_cycle || stats.gc_objects_count != 0 || stats.gc_destroyed_objects_count != 100)
+    {
+      std::cout << "Frame gc test failed: full cycle left " << stats.gc_objects_count << " objects\n";
+      return false;
+    }
+  }
+  //no budget still makes one batch of steps, the collector grows but never runs a full cycle
+  if(single_step_stats.back().is_gc_full_cycle || single_step_stats.back().gc_steps_count != single_step_stats.front().gc_steps_count)
+  {
+    std::cout << "Frame gc test failed: unexpected steps without a budget\n";
+    return false;
+  }
+  std::cout << "Frame gc test passed\n";
+  return true;
+}
+
+bool RunFrameArenaTest()
+{
+  std::string script_source = R"(
+void Shade(float v, out vec4 color)
+{{
+  color = vec4(v);
+}}
+[declaration: "nodes"]
+{{
+  class Node
+  {
+    Node @next;
+    float value;
+  }
+  array<float> history;
+}}
+[rendergraph]
+[include: "nodes"]
+void RenderGraphMain()
+{{
+  int count = SliderInt("Count", 1, 100, 50);
+  Node @head;
+  for(int i = 0; i < count; i++)
+  {
+    Node node;
+    node.value = float(i);
+    @node.next = head;
+    @head = node;
+  }
+  history.insertLast(head.value);
+  Image img = GetImage(GetSwapchainImage().GetSize() / 2, rgba8);
+  Shade(float(history.length()), img);
+  Shade(head.value, GetSwapchainImage());
+  Text("history " + history.length() + " " + history[0]);
+}}
+)";
+  //outputs of every frame, compared between configurations
+  using FrameOutputs = std::vector<std::pair<std::vector<uint8_t>, std::string>>;
+  auto run_frames = [&](bool use_frame_arena, size_t frames_count, FrameOutputs &outputs, size_t &arena_allocations_count)
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.collect_stats = true;
+    options.use_frame_arena = use_frame_arena;
+    script.SetOptions(options);
+    script.LoadScript(script_source);
+    arena_allocations_count = 0;
+    for(size_t frame_idx = 0; frame_idx < frames_count; frame_idx++)
+    {
+      auto events = script.RunScript({{"Count", int(10 + frame_idx)}});
+      arena_allocations_count += events.stats->arena_allocations_count;
+      outputs.push_back({events.script_shader_invocations.back().uniform_data, std::get<ls::TextRequest>(events.context_requests.back()).text});
+    }
+  };
+  const size_t frames_count = 20;
+  FrameOutputs heap_outputs;
+  FrameOutputs arena_outputs;
+  size_t heap_arena_allocations_count = 0;
+  size_t arena_allocations_count = 0;
+  //instances on their own threads, the arenas are per thread but the script engine's allocations are shared
+  const size_t threads_count = 4;
+  std::vector<FrameOutputs> thread_outputs(threads_count);
+  std::vector<size_t> thread_arena_allocations_counts(threads_count, 0);
+  std::vector<std::string> thread_errors(threads_count);
+  try
+  {
+    run_frames(false, frames_count, heap_outputs, heap_arena_allocations_count);
+    run_frames(true, frames_count, arena_outputs, arena_allocations_count);
+    std::vector<std::thread> threads;
+    for(size_t thread_idx = 0; thread_idx < threads_count; thread_idx++)
+    {
+      threads.emplace_back([&, thread_idx](){
+        try
+        {
+          run_frames(true, frames_count, thread_outputs[thread_idx], thread_arena_allocations_counts[thread_idx]);
+        }
+        catch(const std::exception &e)
+        {
+          thread_errors[thread_idx] = e.what();
+        }
+      });
+    }
+    for(auto &thread : threads)
+      thread.join();
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Frame arena test failed: " << e.what() << "\n";
+    return false;
+  }
+  if(heap_arena_allocations_count != 0 || arena_allocations_count == 0)
+  {
+    std::cout << "Frame arena test failed: unexpected arena allocations count " << heap_arena_allocations_count << " " << arena_allocations_count << "\n";
+    return false;
+  }
+  //the global array and the nodes kept alive by the context outlive their frames
+  if(arena_outputs != heap_outputs || arena_outputs.back().second != "history 20 9")
+  {
+    std::cout << "Frame arena test failed: outputs differ from the heap allocated ones\n";
+    return false;
+  }
+  for(size_t thread_idx = 0; thread_idx < threads_count; thread_idx++)
+  {
+    if(!thread_errors[thread_idx].empty() || thread_outputs[thread_idx] != heap_outputs || thread_arena_allocations_counts[thread_idx] == 0)
+    {
+      std::cout << "Frame arena test failed: outputs of thread " << thread_idx << " differ " << thread_errors[thread_idx] << "\n";
+      return false;
+    }
+  }
+
+  //a global container grows every frame while the frame's temporaries outgrow the smallest block. every frame leaves
+  //a chunk behind in its last block, so blocks have to stay small instead of growing to the largest size
+  std::string growing_source = R"(
+void Shade(float v, out vec4 color)
+{{
+  color = vec4(v);
+}}
+[declaration: "chunks"]
+{{
+  array<array<float>> chunks;
+}}
+[rendergraph]
+[include: "chunks"]
+void RenderGraphMain()
+{{
+  float sum = 0.0f;
+  for(int i = 0; i < 4000; i++)
+  {
+    array<float> tmp = {float(i)};
+    sum += tmp[0];
+  }
+  array<float> chunk(64);
+  chunks.insertLast(chunk);
+  Shade(sum + float(chunks.length()), GetSwapchainImage());
+}}
+)";
+  try
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.collect_stats = true;
+    options.use_frame_arena = true;
+    script.SetOptions(options);
+    script.LoadScript(growing_source);
+    const size_t growing_frames_count = 30;
+    size_t pinned_bytes = 0;
+    for(size_t frame_idx = 0; frame_idx < growing_frames_count; frame_idx++)
+      pinned_bytes = script.RunScript({}).stats->arena_pinned_bytes;
+    if(pinned_bytes == 0 || pinned_bytes > growing_frames_count * 128 * 1024)
+    {
+      std::cout << "Frame arena test failed: a growing global container pins " << pinned_bytes << " bytes\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Frame arena test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Frame arena test passed\n";
+  return true;
+}
+
+bool RunTracingTest()
+{
+  std::string script_source = R"(
+void Fill(out vec4 color)
+{{
+  color = vec4(1.0f);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  ProfileBegin("FillScope");
+  Fill(GetSwapchainImage());
+  ProfileEnd();
+  //left open, closed at the end of the frame
+  ProfileBegin("OpenScope");
+  //cut by the recorder in the middle of the last character
+  ProfileBegin("LongScope_____________________________________________________é");
+  ProfileEnd();
+}}
+)";
+  ls::SetTracingEnabled(true);
+  ls::ClearTrace();
+  bool is_failed = false;
+  auto run_frames = [&]()
+  {
+    try
+    {
+      ls::LegitScript script;
+      script.LoadScript(script_source);
+      for(size_t frame = 0; frame < 10; frame++)
+        script.RunScript({{"@swapchain_size", ls::uvec2{64, 64}}});
+    }
+    catch(const std::exception &e)
+    {
+      std::cout << "Tracing test failed: " << e.what() << "\n";
+      is_failed = true;
+    }
+  };
+  std::thread other_thread(run_frames);
+  other_thread.join();
+  run_frames();
+  std::string trace;
+  try
+  {
+    trace = ls::DumpTrace();
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Tracing test failed: " << e.what() << "\n";
+    is_failed = true;
+  }
+  ls::SetTracingEnabled(false);
+  ls::ClearTrace();
+  if(is_failed)
+    return false;
+  //the recorder is compiled out without LEGIT_SCRIPT_TRACING
+  if(trace.find("\"name\"") == std::string::npos)
+  {
+    std::cout << "Tracing test passed\n";
+    return true;
+  }
+  bool is_complete = trace.find("\"ph\":\"B\"") == std::string::npos && trace.find("\"ph\":\"E\"") == std::string::npos;
+  bool has_scopes = trace.find("\"FillScope\"") != std::string::npos && trace.find("\"OpenScope\"") != std::string::npos && trace.find("\"LongScope") != std::string::npos;
+  bool has_threads = trace.find("\"tid\":1") != std::string::npos && trace.find("\"tid\":2") != std::string::npos;
+  if(!is_complete || !has_scopes || !has_threads)
+  {
+    std::cout << "Tracing test failed: unexpected trace events\n";
+    return false;
+  }
+  std::cout << "Tracing test passed\n";
+  return true;
+}
+
+bool RunSharedScriptEngineTest()
+{
+  std::string blur_source = R"(
+void Shade(float v, out vec4 color)
+{{
+  color = vec4(v);
+}}
+[declaration: "weights"]
+{{
+  class Weights
+  {
+    float center = 0.5f;
+    float Apply(float v) { return v * center; }
+  }
+}}
+[rendergraph]
+[include: "weights"]
+void RenderGraphMain()
+{{
+  Weights weights;
+  float v = weights.Apply(SliderFloat("Radius", 0.0f, 10.0f, 2.0f));
+  Image img = GetImage(GetSwapchainImage().GetSize() / 2, rgba8);
+  Shade(v, img);
+  Shade(v * 2.0f, GetSwapchainImage());
+  Text("blur " + v);
+}}
+)";
+  //a pass with the same name and other arguments, which would clash in a shared global namespace
+  std::string tint_source = R"(
+void Shade(vec2 v, out vec4 color)
+{{
+  color = vec4(v, 0.0f, 1.0f);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  Shade(vec2(GetTime(), 1.0f), GetSwapchainImage());
+  Text("tint");
+}}
+)";
+  std::string broken_source = R"(
+void Shade(float v, out vec4 color)
+{{
+  color = vec4(v);
+}}
+[rendergraph]
+void RenderGraphMain()
+{{
+  float v = 1.0f
+  Shade(v, GetSwapchainImage());
+}}
+)";
+  auto make_script = [](bool share_script_engine, const std::string &source)
+  {
+    std::unique_ptr<ls::LegitScript> script(new ls::LegitScript());
+    ls::ScriptOptions options;
+    options.share_script_engine = share_script_engine;
+    script->SetOptions(options);
+    script->LoadScript(source);
+    return script;
+  };
+  using FrameOutput = std::pair<std::vector<uint8_t>, std::string>;
+  auto run_frame = [](ls::LegitScript &script, float radius)
+  {
+    auto events = script.RunScript({
+      {"@swapchain_size", ls::uvec2{64, 64}},
+      {"@time", 0.25f},
+      {"Radius", radius}});
+    return FrameOutput(events.script_shader_invocations.back().uniform_data, std::get<ls::TextRequest>(events.context_requests.back()).text);
+  };
+  auto load_error = [&](bool share_script_engine)
+  {
+    try
+    {
+      make_script(share_script_engine, broken_source);
+    }
+    catch(const std::exception &e)
+    {
+      return std::string(e.what());
+    }
+    return std::string();
+  };
+  try
+  {
+    auto own_blur = make_script(false, blur_source);
+    auto shared_blur = make_script(true, blur_source);
+    auto shared_tint = make_script(true, tint_source);
+    for(float radius : {1.0f, 4.0f})
+    {
+      if(run_frame(*own_blur, radius) != run_frame(*shared_blur, radius))
+      {
+        std::cout << "Shared script engine test failed: outputs differ from an own engine\n";
+        return false;
+      }
+    }
+    auto tint_output = run_frame(*shared_tint, 0.0f);
+    if(tint_output.second != "tint" || tint_output.first.size() != sizeof(float) * 2)
+    {
+      std::cout << "Shared script engine test failed: unexpected tint output " << tint_output.second << "\n";
+      return false;
+    }
+    //a failed build leaves the shared engine usable and reports the same position as an own engine
+    std::string own_error = load_error(false);
+    std::string shared_error = load_error(true);
+    if(own_error.empty() || shared_error != own_error)
+    {
+      std::cout << "Shared script engine test failed: build errors differ: " << own_error << " vs " << shared_error << "\n";
+      return false;
+    }
+    shared_blur->LoadScript(blur_source);
+    shared_tint.reset();
+    if(run_frame(*own_blur, 3.0f) != run_frame(*shared_blur, 3.0f))
+    {
+      std::cout << "Shared script engine test failed: outputs differ after a reload\n";
+      return false;
+    }
+    //reloads with other pass declarations leave dead namespaces behind until the engine is replaced for new loads,
+    //the instances still on the old engine keep working
+    auto shared_keeper = make_script(true, blur_source);
+    for(size_t reload_idx = 0; reload_idx < 150; reload_idx++)
+    {
+      shared_blur->LoadScript(reload_idx % 2 ? blur_source : tint_source);
+      if(reload_idx % 2 && run_frame(*own_blur, 3.0f) != run_frame(*shared_blur, 3.0f))
+      {
+        std::cout << "Shared script engine test failed: outputs differ after reload " << reload_idx << "\n";
+        return false;
+      }
+    }
+    if(run_frame(*own_blur, 2.0f) != run_frame(*shared_keeper, 2.0f) || make_script(true, tint_source)->RunScript({}).script_shader_invocations.size() != 1)
+    {
+      std::cout << "Shared script engine test failed: outputs differ after the engine was replaced\n";
+      return false;
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Shared script engine test failed: " << e.what() << "\n";
+    return false;
+  }
+  std::cout << "Shared script engine test passed\n";
+  return true;
+}
+
 int main()
 {
   //RunTest();
   RunTestJson();
-  return 0;
+  bool is_passed = true;
+  is_passed &= RunLineProfilerTest();
+  is_passed &= RunStableImageIdsTest();
+  is_passed &= RunAliasingPlanTest();
+  is_passed &= RunDependencyGraphTest();
+  is_passed &= RunCullingTest();
+  is_passed &= RunRenderPassScheduleTest();
+  is_passed &= RunAttachmentOpsTest();
+  is_passed &= RunPersistentImagesTest();
+  is_passed &= RunInvocationReuseTest();
+  is_passed &= RunFrameMemoizationTest();
+  is_passed &= RunStaticFramesTest();
+  is_passed &= RunComputePassTest();
+  is_passed &= RunStorageImagesTest();
+  is_passed &= RunInvocationBatchingTest();
+  is_passed &= RunInstancedPassTest();
+  is_passed &= RunJitTest();
+  is_passed &= RunAotTest();
+  is_passed &= RunByteCodeOptimizerTest();
+  is_passed &= RunStatsTest();
+  is_passed &= RunVmStatsTest();
+  is_passed &= RunFrameGcTest();
+  is_passed &= RunFrameArenaTest();
+  is_passed &= RunSharedScriptEngineTest();
+  is_passed &= RunTracingTest();
+  return is_passed ? 0 : 1;
 }
@@ -0,0 +1,96 @@
+#include <LegitScript.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+//replays a sequence of frames of a script and prints how often the interpreter executed each opcode and called each
+//function. needs the library built with LEGIT_SCRIPT_VM_STATS
+using Counts = std::map<std::string, size_t>;
+
+void AddCounts(Counts &dst, const std::vector<ls::ScriptStats::VmCount> &src)
+{
+  for(const auto &count : src)
+    dst[count.name] += count.count;
+}
+
+void PrintCounts(const char *title, const Counts &counts, size_t max_rows_count)
+{
+  std::vector<std::pair<std::string, size_t>> rows(counts.begin(), counts.end());
+  std::stable_sort(rows.begin(), rows.end(), [](const auto &a, const auto &b){ return a.second > b.second; });
+  size_t total_count = 0;
+  for(const auto &row : rows)
+    total_count += row.second;
+  std::printf("%s: %zu total\n", title, total_count);
+  for(size_t row_idx = 0; row_idx < std::min(rows.size(), max_rows_count); row_idx++)
+  {
+    const auto &row = rows[row_idx];
+    std::printf("  %12zu %6.2f%%  %s\n", row.second, 100.0 * double(row.second) / double(std::max<size_t>(total_count, 1)), row.first.c_str());
+  }
+  std::printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 2 || argc > 4)
+  {
+    std::cout << "Usage: LegitScriptVmStats <script.ls> [frames_count] [--optimize]\n";
+    return 1;
+  }
+  size_t frames_count = argc > 2 ? std::stoul(argv[2]) : 100;
+  bool optimize = argc > 3 && std::string(argv[3]) == "--optimize";
+  std::ifstream script_stream(argv[1]);
+  if(!script_stream)
+  {
+    std::cout << "Can't open " << argv[1] << "\n";
+    return 1;
+  }
+  std::stringstream string_stream;
+  string_stream << script_stream.rdbuf();
+
+  Counts opcode_counts;
+  Counts registered_call_counts;
+  Counts script_call_counts;
+  try
+  {
+    ls::LegitScript script;
+    ls::ScriptOptions options;
+    options.collect_stats = true;
+    options.optimize_byte_code = optimize;
+    //native code skips the interpreter
+    options.load_aot_render_graphs = false;
+    script.SetOptions(options);
+    script.LoadScript(string_stream.str());
+    for(size_t frame_idx = 0; frame_idx < frames_count; frame_idx++)
+    {
+      std::vector<ls::ContextInput> context_inputs = {
+        {"@swapchain_size", ls::uvec2{1920, 1080}},
+        {"@time", float(frame_idx) / 60.0f}
+      };
+      auto script_events = script.RunScript(context_inputs);
+      if(!script_events.stats)
+        continue;
+      AddCounts(opcode_counts, script_events.stats->opcode_counts);
+      AddCounts(registered_call_counts, script_events.stats->registered_call_counts);
+      AddCounts(script_call_counts, script_events.stats->script_call_counts);
+    }
+  }
+  catch(const std::exception &e)
+  {
+    std::cout << "Failed to run " << argv[1] << ": " << e.what() << "\n";
+    return 1;
+  }
+  if(opcode_counts.empty())
+  {
+    std::cout << "No opcodes counted, LegitScript has to be built with LEGIT_SCRIPT_VM_STATS\n";
+    return 1;
+  }
+  std::printf("%zu frames\n\n", frames_count);
+  const size_t max_rows_count = 40;
+  PrintCounts("Opcodes", opcode_counts, max_rows_count);
+  PrintCounts("Registered function calls", registered_call_counts, max_rows_count);
+  PrintCounts("Script function entries", script_call_counts, max_rows_count);
+  return 0;
+}
@@ -30,7 +30,25 @@ std::string LegitScriptFrame(std::string context_inputs) {
   }
 }
 
+std::string LegitScriptSetOptions(std::string options) {
+  using json = nlohmann::json;
+  try
+  {
+    return ls::SetOptions(options);
+  }
+  catch(const std::exception &e)
+  {
+    return json::object({{"Uncaught error: ", e.what()}});
+  }
+}
+
+std::string LegitScriptDumpTrace() {
+  return ls::DumpTrace();
+}
+
 EMSCRIPTEN_BINDINGS(LegitScriptEmscriptenApi) {
   emscripten::function("LegitScriptLoad", LegitScriptLoad);
   emscripten::function("LegitScriptFrame", LegitScriptFrame);
+  emscripten::function("LegitScriptSetOptions", LegitScriptSetOptions);
+  emscripten::function("LegitScriptDumpTrace", LegitScriptDumpTrace);
 };